@@ -0,0 +1,11 @@
+#include "AppSettings.h"
+#include <QCoreApplication>
+#include <QDir>
+
+QString AppSettings::filePath()
+{
+    const QString fromEnv = qEnvironmentVariable("QTCREDIT_CONFIG");
+    if (!fromEnv.isEmpty())
+        return fromEnv;
+    return QDir(QCoreApplication::applicationDirPath()).filePath("QTcredit.ini");
+}
@@ -0,0 +1,12 @@
+#ifndef APPSETTINGS_H
+#define APPSETTINGS_H
+
+#include <QString>
+
+// Location of the QTcredit.ini configuration file.
+// Defaults to the executable directory, QTCREDIT_CONFIG overrides it.
+namespace AppSettings {
+QString filePath();
+}
+
+#endif // APPSETTINGS_H
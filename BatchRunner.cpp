@@ -0,0 +1,348 @@
+#include "BatchRunner.h"
+#include "DatabaseManager.h"
+#include "ReportGenerator.h"
+#include "StatementGenerator.h"
+#include "CsvExporter.h"
+#include "StatusRules.h"
+#include "OrderArchive.h"
+#include "OrderCodes.h"
+#include "OrderShards.h"
+#include "QueryPlanCheck.h"
+#include <QCommandLineParser>
+#include <QFile>
+#include <QFuture>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QProcess>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+namespace {
+const QStringList JobCommands = {"export-month", "export-clients", "stats", "statements", "export-csv", "rules", "counters", "archive"};
+
+QMutex s_outputMutex;
+
+void printLine(const QString &line, bool error = false)
+{
+    QMutexLocker locker(&s_outputMutex);
+    QTextStream stream(error ? stderr : stdout);
+    stream << line << Qt::endl;
+}
+}
+
+bool BatchRunner::isBatchInvocation(int argc, char *argv[])
+{
+    if (argc < 2)
+        return false;
+    const QString command = QString::fromLocal8Bit(argv[1]);
+    return JobCommands.contains(command) || command == "batch" || command == "check-plans" || command == "--help-batch";
+}
+
+void BatchRunner::printUsage()
+{
+    printLine("Usage:\n"
+              "  QTcredit export-month [--month yyyy-MM] --out fichier.pdf\n"
+              "  QTcredit export-clients --out fichier.pdf\n"
+              "  QTcredit stats [--year yyyy] [--out fichier.csv|fichier.pdf]\n"
+              "  QTcredit statements [--month yyyy-MM] --out dossier\n"
+              "  QTcredit export-csv --what clients|commandes --out fichier.csv|.tsv[.gz]\n"
+              "                      [--from yyyy-MM-dd] [--to yyyy-MM-dd] [--statut S] [--client nom]\n"
+              "  QTcredit rules [--dry-run]   (règles de statut de QTcredit.ini)\n"
+              "  QTcredit counters [--repair]   (compteurs de commandes des clients)\n"
+              "  QTcredit archive [--dry-run]   (commandes plus anciennes que l'horizon de QTcredit.ini)\n"
+              "  QTcredit check-plans [--clients N] [--orders N]   (index utilisés par les requêtes clés,\n"
+              "                      sur une base SQLite générée)\n"
+              "  QTcredit batch jobs.txt [--jobs N]\n"
+              "      jobs.txt: une commande ci-dessus par ligne (sans 'QTcredit'), '#' pour commenter");
+}
+
+int BatchRunner::run(const QStringList &arguments)
+{
+    if (arguments.isEmpty() || arguments.first() == "--help-batch") {
+        printUsage();
+        return arguments.isEmpty() ? 2 : 0;
+    }
+
+    // Works on its own generated database, not the configured one
+    if (arguments.first() == "check-plans")
+        return runPlanCheck(arguments);
+
+    // Create missing tables/indexes once, before any worker connection exists
+    {
+        DatabaseConfig config = DatabaseConfig::load();
+        config.connectionName = "batch_setup";
+        DatabaseManager setup(config);
+        if (!setup.open()) {
+            printLine("Connexion à la base de données impossible", true);
+            return 1;
+        }
+    }
+
+    if (arguments.first() == "batch")
+        return runJobFile(arguments);
+    return runJob(arguments, 0);
+}
+
+int BatchRunner::runPlanCheck(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    parser.addOption({"clients", "Nombre de clients générés", "N", "2000"});
+    parser.addOption({"orders", "Nombre de commandes générées", "N", "50000"});
+    if (!parser.parse(QStringList{"QTcredit"} + arguments.mid(1))) {
+        printLine("check-plans: " + parser.errorText(), true);
+        return 2;
+    }
+
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        printLine("check-plans: dossier temporaire impossible", true);
+        return 1;
+    }
+
+    int failures = 0;
+    {
+        DatabaseConfig config;
+        config.driver = "QSQLITE";
+        config.databaseName = dir.filePath("plans.db");
+        config.connectionName = "plan_check";
+        DatabaseManager db(config);
+        if (!db.open()
+            || !QueryPlanCheck::generateSample(db, qMax(1, parser.value("clients").toInt()),
+                                               qMax(1, parser.value("orders").toInt()))) {
+            printLine("check-plans: génération de la base impossible", true);
+            return 1;
+        }
+
+        for (const QueryPlanCheck::Outcome &outcome : QueryPlanCheck::run(db)) {
+            printLine(QString("%1 %2").arg(outcome.ok() ? "OK   " : "ÉCHEC", outcome.query), !outcome.ok());
+            if (!outcome.ok()) {
+                ++failures;
+                printLine("      " + outcome.problem, true);
+            }
+            for (const QString &step : outcome.plan)
+                printLine("      | " + step, !outcome.ok());
+        }
+    }
+    printLine(QString("check-plans: %1 échec(s)").arg(failures));
+    return failures == 0 ? 0 : 1;
+}
+
+int BatchRunner::runJobFile(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    parser.addPositionalArgument("jobs", "Fichier de tâches");
+    parser.addOption({"jobs", "Nombre de tâches en parallèle", "N",
+                      QString::number(QThread::idealThreadCount())});
+    parser.parse(QStringList{"QTcredit"} + arguments.mid(1));
+
+    if (parser.positionalArguments().isEmpty()) {
+        printUsage();
+        return 2;
+    }
+
+    QFile file(parser.positionalArguments().first());
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        printLine("Fichier de tâches illisible: " + file.fileName(), true);
+        return 2;
+    }
+
+    QList<QStringList> jobs;
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        const QString line = in.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith('#'))
+            continue;
+        jobs << QProcess::splitCommand(line);
+    }
+
+    // Each job opens its own connection, so they run independently
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, parser.value("jobs").toInt()));
+
+    QList<QFuture<int>> futures;
+    for (int i = 0; i < jobs.size(); ++i) {
+        const QStringList job = jobs.at(i);
+        futures << QtConcurrent::run(&pool, [job, i]() { return runJob(job, i + 1); });
+    }
+
+    int failures = 0;
+    for (QFuture<int> &future : futures) {
+        if (future.result() != 0)
+            failures++;
+    }
+
+    printLine(QString("%1 tâche(s), %2 échec(s)").arg(jobs.size()).arg(failures));
+    return failures == 0 ? 0 : 1;
+}
+
+int BatchRunner::runJob(const QStringList &arguments, int jobIndex)
+{
+    const QString command = arguments.value(0);
+    if (!JobCommands.contains(command)) {
+        printLine("Commande inconnue: " + command, true);
+        return 2;
+    }
+
+    QCommandLineParser parser;
+    parser.addOption({"out", "Fichier de sortie", "fichier"});
+    parser.addOption({"month", "Mois (yyyy-MM)", "mois", QDate::currentDate().toString("yyyy-MM")});
+    parser.addOption({"year", "Année", "année", QString::number(QDate::currentDate().year())});
+    parser.addOption({"what", "clients ou commandes", "table", "commandes"});
+    parser.addOption({"from", "Date de début (yyyy-MM-dd)", "date"});
+    parser.addOption({"to", "Date de fin (yyyy-MM-dd)", "date"});
+    parser.addOption({"statut", "Statut", "statut"});
+    parser.addOption({"client", "Nom du client", "nom"});
+    parser.addOption({"dry-run", "Compter sans modifier"});
+    parser.addOption({"repair", "Corriger les écarts"});
+    if (!parser.parse(QStringList{"QTcredit"} + arguments.mid(1))) {
+        printLine(command + ": " + parser.errorText(), true);
+        return 2;
+    }
+
+    const QString out = parser.value("out");
+    if (out.isEmpty() && command != "stats" && command != "rules" && command != "counters"
+        && command != "archive") {
+        printLine(command + ": --out est obligatoire", true);
+        return 2;
+    }
+
+    DatabaseConfig config = DatabaseConfig::load();
+    config.connectionName = QString("batch_job_%1").arg(jobIndex);
+    config.manageSchema = false;
+    DatabaseManager db(config);
+    if (!db.open()) {
+        printLine(command + ": connexion à la base de données impossible", true);
+        return 1;
+    }
+    // Reports and exports are the bulk of the read load: off the primary if possible
+    db.attachReadReplica(ReadReplicaConfig::load());
+    const ShardConfig shardConfig = ShardConfig::load();
+    QString shardError;
+    if (shardConfig.enabled && !db.attachShards(shardConfig, &shardError)) {
+        printLine(command + ": " + shardError, true);
+        return 1;
+    }
+
+    if (command == "rules") {
+        const StatusRulesConfig rulesConfig = StatusRulesConfig::load();
+        const bool dryRun = parser.isSet("dry-run");
+        bool ok = true;
+        for (const StatusRulesEngine::Outcome &outcome : StatusRulesEngine::run(db, rulesConfig, dryRun)) {
+            ok = ok && outcome.ok;
+            printLine(QString("%1: %2 -> %3 concernée(s), %4 modifiée(s)%5")
+                          .arg(command, outcome.rule)
+                          .arg(outcome.matched)
+                          .arg(outcome.updated)
+                          .arg(outcome.ok ? QString() : QString(" (erreur)")));
+        }
+        return ok ? 0 : 1;
+    }
+
+    if (command == "archive") {
+        const ArchiveConfig archiveConfig = ArchiveConfig::load();
+        const OrderArchiver::Outcome outcome = OrderArchiver::run(db, archiveConfig, parser.isSet("dry-run"));
+        printLine(QString("%1: %2 commande(s) avant le %3, %4 archivée(s)%5")
+                      .arg(command)
+                      .arg(outcome.archivable)
+                      .arg(archiveConfig.cutoff().date().toString("dd/MM/yyyy"))
+                      .arg(outcome.moved)
+                      .arg(outcome.ok ? QString() : QString(" (erreur)")));
+        return outcome.ok ? 0 : 1;
+    }
+
+    if (command == "counters") {
+        bool ok = false;
+        const QList<int> mismatched = db.checkClientCounters(&ok);
+        if (!ok) {
+            printLine(command + ": vérification impossible", true);
+            return 1;
+        }
+        printLine(QString("%1: %2 client(s) avec des compteurs incorrects").arg(command).arg(mismatched.size()));
+        if (mismatched.isEmpty() || !parser.isSet("repair"))
+            return mismatched.isEmpty() ? 0 : 1;
+        if (!db.rebuildClientCounters(mismatched)) {
+            printLine(command + ": correction impossible", true);
+            return 1;
+        }
+        printLine(QString("%1: %2 client(s) corrigé(s)").arg(command).arg(mismatched.size()));
+        return 0;
+    }
+
+    ReportGenerator::Result result;
+    if (command == "export-month") {
+        const QDate month = QDate::fromString(parser.value("month") + "-01", "yyyy-MM-dd");
+        if (!month.isValid()) {
+            printLine(command + ": mois invalide " + parser.value("month"), true);
+            return 2;
+        }
+        result = ReportGenerator::exportCommandesMonthPDF(db, month, out);
+    } else if (command == "export-clients") {
+        result = ReportGenerator::exportClientsPDF(db, out);
+    } else if (command == "export-csv") {
+        const CsvExporter::Options options = CsvExporter::optionsForFile(out);
+        CsvExporter::Result csv;
+        if (parser.value("what") == "clients") {
+            csv = CsvExporter::exportClients(db, out, options);
+        } else {
+            CommandeFilter filter;
+            filter.clientName = parser.value("client");
+            filter.statut = OrderCodes::statut(parser.value("statut"));
+            if (parser.isSet("statut") && filter.statut.isEmpty()) {
+                printLine(command + ": statut inconnu " + parser.value("statut"), true);
+                return 2;
+            }
+            filter.fromDate = QDate::fromString(parser.value("from"), Qt::ISODate);
+            filter.toDate = QDate::fromString(parser.value("to"), Qt::ISODate);
+            csv = CsvExporter::exportCommandes(db, filter, out, options);
+        }
+        result.ok = csv.ok;
+        result.rows = static_cast<int>(csv.rows);
+        result.error = csv.error;
+    } else if (command == "statements") {
+        const QDate month = QDate::fromString(parser.value("month") + "-01", "yyyy-MM-dd");
+        if (!month.isValid()) {
+            printLine(command + ": mois invalide " + parser.value("month"), true);
+            return 2;
+        }
+        // Progress every 10 %, reported from the rendering threads
+        QAtomicInt lastDecile = 0;
+        const StatementGenerator::Summary summary = StatementGenerator::generate(
+            db, month, month.addMonths(1).addDays(-1), out,
+            [&lastDecile, command](int done, int total) {
+                const int decile = total > 0 ? done * 10 / total : 10;
+                int previous = lastDecile.loadRelaxed();
+                while (decile > previous) {
+                    if (lastDecile.testAndSetRelaxed(previous, decile)) {
+                        printLine(QString("%1: %2 %").arg(command).arg(decile * 10));
+                        break;
+                    }
+                    previous = lastDecile.loadRelaxed();
+                }
+            });
+        result.ok = summary.ok;
+        result.rows = summary.clients;
+        result.error = summary.error;
+    } else {
+        const int year = parser.value("year").toInt();
+        if (out.isEmpty()) {
+            MonthlyStats stats;
+            QString error;
+            if (!MonthlyStats::load(db, year, stats, &error)) {
+                printLine(command + ": " + error, true);
+                return 1;
+            }
+            printLine(ReportGenerator::statisticsText(stats).trimmed());
+            return 0;
+        }
+        result = ReportGenerator::exportStatistics(db, year, out);
+    }
+
+    if (!result.ok) {
+        printLine(command + ": " + result.error, true);
+        return 1;
+    }
+    printLine(QString("%1: %2 ligne(s) -> %3").arg(command).arg(result.rows).arg(out));
+    return 0;
+}
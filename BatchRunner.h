@@ -0,0 +1,30 @@
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include <QStringList>
+
+// Headless command-line mode, e.g. for overnight scheduled reports:
+//   QTcredit export-month [--month 2025-09] --out commandes.pdf
+//   QTcredit export-clients --out clients.pdf
+//   QTcredit stats [--year 2025] [--out stats.csv|stats.pdf]
+//   QTcredit statements [--month 2025-09] --out releves/   (one PDF per client)
+//   QTcredit export-csv --what commandes --from 2025-01-01 --to 2025-03-31 --out q1.csv.gz
+//   QTcredit rules [--dry-run]   (status rules of QTcredit.ini)
+//   QTcredit counters [--repair]   (client order counters against the orders)
+//   QTcredit check-plans   (key queries still use their indexes; exit code 1 otherwise)
+//   QTcredit batch jobs.txt [--jobs 4]   (one of the above per line, run in parallel)
+class BatchRunner
+{
+public:
+    static bool isBatchInvocation(int argc, char *argv[]);
+    // arguments without the program name
+    static int run(const QStringList &arguments);
+
+private:
+    static int runJob(const QStringList &arguments, int jobIndex);
+    static int runJobFile(const QStringList &arguments);
+    static int runPlanCheck(const QStringList &arguments);
+    static void printUsage();
+};
+
+#endif // BATCHRUNNER_H
@@ -0,0 +1,260 @@
+#include "ChangeFeed.h"
+#include "AppSettings.h"
+#include <QDebug>
+#include <QSet>
+#include <QSettings>
+
+namespace {
+const char *StampFormat = "yyyy-MM-ddTHH:mm:ss.zzz";
+
+// updated_at is a QDateTime on MySQL and ISO text on SQLite; keep one text form
+QString toStamp(const QVariant &value)
+{
+    if (value.metaType().id() == QMetaType::QDateTime)
+        return value.toDateTime().toString(StampFormat);
+    return value.toString();
+}
+}
+
+ChangeFeedConfig ChangeFeedConfig::load(const QString &group)
+{
+    ChangeFeedConfig config;
+    QSettings settings(AppSettings::filePath(), QSettings::IniFormat);
+    settings.beginGroup(group);
+    config.enabled = settings.value("enabled", config.enabled).toBool();
+    config.intervalMs = qMax(500, settings.value("interval_ms", config.intervalMs).toInt());
+    config.overlapSeconds = qMax(0, settings.value("overlap_s", config.overlapSeconds).toInt());
+    config.maxRows = qMax(1, settings.value("max_rows", config.maxRows).toInt());
+    settings.endGroup();
+    return config;
+}
+
+bool ChangeSet::isEmpty() const
+{
+    return !reloadAll && clients.isEmpty() && commandes.isEmpty() && deletedClients.isEmpty()
+        && deletedCommandes.isEmpty();
+}
+
+QList<int> ChangeSet::clientIds() const
+{
+    QSet<int> ids;
+    for (const ClientRow &row : clients)
+        ids.insert(row.idClient);
+    for (const CommandeRow &row : commandes)
+        ids.insert(row.idClient);
+    return QList<int>(ids.cbegin(), ids.cend());
+}
+
+// ---- ChangeFeedWorker ----
+ChangeFeedWorker::ChangeFeedWorker(const DatabaseConfig &databaseConfig, const ChangeFeedConfig &feedConfig)
+    : m_databaseConfig(databaseConfig), m_feedConfig(feedConfig)
+{
+    m_databaseConfig.connectionName = "change_feed";
+    m_databaseConfig.manageSchema = false;
+}
+
+void ChangeFeedWorker::start()
+{
+    // The connection is created here so it belongs to the feed thread
+    m_db = new DatabaseManager(m_databaseConfig, this);
+    if (!m_db->open() || !readWatermarks()) {
+        emit failed("Connexion du suivi des modifications impossible");
+        return;
+    }
+
+    m_timer = new QTimer(this);
+    m_timer->setInterval(m_feedConfig.intervalMs);
+    connect(m_timer, &QTimer::timeout, this, &ChangeFeedWorker::poll);
+    m_timer->start();
+}
+
+// Everything up to now is already on screen. After a reload the overlap
+// window is not re-read either: the reported ids are gone and the rows of
+// the bulk write would overflow again.
+bool ChangeFeedWorker::readWatermarks(bool reloaded)
+{
+    QSqlQuery q(m_db->getDatabase());
+    if (!q.exec("SELECT MAX(updated_at) FROM client") || !q.next())
+        return false;
+    const QString clients = toStamp(q.value(0));
+    m_clients = Watermark{clients, {}, reloaded ? clients : QString()};
+    if (!q.exec("SELECT MAX(updated_at) FROM commande") || !q.next())
+        return false;
+    const QString commandes = toStamp(q.value(0));
+    m_commandes = Watermark{commandes, {}, reloaded ? commandes : QString()};
+    if (!q.exec("SELECT COALESCE(MAX(id), 0) FROM deleted_row") || !q.next())
+        return false;
+    m_lastDeletion = q.value(0).toLongLong();
+    return true;
+}
+
+QVariant ChangeFeedWorker::stampParam(const QString &stamp, int secondsBack) const
+{
+    QDateTime value = QDateTime::fromString(stamp, StampFormat);
+    if (!value.isValid())
+        value = QDateTime(QDate(1970, 1, 1), QTime(0, 0));
+    value = value.addSecs(-secondsBack);
+
+    if (m_db->isSqlite())
+        return value.toString(StampFormat);
+    return value;
+}
+
+// Rewinds by the overlap window like the replica pull: rows stamped just
+// before the last poll may have committed after it
+template <typename Row>
+bool ChangeFeedWorker::pullRows(const QString &sql, const QString &keyColumn, Watermark &mark, QVector<Row> &rows,
+                                bool &overflow)
+{
+    QSqlQuery q(m_db->getDatabase());
+    q.setForwardOnly(true);
+    q.prepare(sql.arg(m_feedConfig.maxRows + 1));
+    const QString rewound = QDateTime::fromString(mark.highWater, StampFormat)
+                                .addSecs(-m_feedConfig.overlapSeconds)
+                                .toString(StampFormat);
+    if (!mark.floor.isEmpty() && rewound < mark.floor)
+        q.bindValue(":stamp", stampParam(mark.floor, 0));
+    else
+        q.bindValue(":stamp", stampParam(mark.highWater, m_feedConfig.overlapSeconds));
+    if (!q.exec()) {
+        qWarning() << "Change feed pull failed:" << keyColumn << q.lastError().text();
+        return false;
+    }
+
+    const QSqlRecord record = q.record();
+    const int keyIndex = record.indexOf(keyColumn);
+    const int stampIndex = record.indexOf("updated_at");
+    const typename Row::Columns columns = Row::resolve(record);
+    int read = 0;
+    while (q.next()) {
+        if (++read > m_feedConfig.maxRows) {
+            overflow = true;
+            return true;
+        }
+        const int id = q.value(keyIndex).toInt();
+        const QString stamp = toStamp(q.value(stampIndex));
+        if (stamp > mark.highWater)
+            mark.highWater = stamp;
+        if (mark.reported.value(id) == stamp)
+            continue;
+        mark.reported.insert(id, stamp);
+        Row row;
+        Row::read(q, columns, row);
+        rows << row;
+    }
+
+    // Rows older than the window are never re-read
+    const QString oldest = QDateTime::fromString(mark.highWater, StampFormat)
+                               .addSecs(-m_feedConfig.overlapSeconds)
+                               .toString(StampFormat);
+    for (auto it = mark.reported.begin(); it != mark.reported.end();) {
+        if (it.value() < oldest)
+            it = mark.reported.erase(it);
+        else
+            ++it;
+    }
+    return true;
+}
+
+void ChangeFeedWorker::poll()
+{
+    ChangeSet changes;
+    bool overflow = false;
+    const bool ok =
+        pullRows(QString("SELECT * FROM client WHERE updated_at > :stamp ORDER BY updated_at LIMIT %1"),
+                 "id_client", m_clients, changes.clients, overflow)
+        && !overflow
+        && pullRows(QString("SELECT co.*, c.nom, c.prenom FROM commande co JOIN client c ON c.id_client = co.id_client "
+                            "WHERE co.updated_at > :stamp ORDER BY co.updated_at LIMIT %1"),
+                    "id_commande", m_commandes, changes.commandes, overflow)
+        && !overflow
+        && pullDeletions(changes);
+
+    if (overflow) {
+        // A bulk write elsewhere: cheaper to reload than to merge row by row
+        if (!readWatermarks(true)) {
+            emit failed("Suivi des modifications interrompu");
+            return;
+        }
+        emit changed(ChangeSet{{}, {}, {}, {}, true});
+        return;
+    }
+    if (!ok) {
+        emit failed("Suivi des modifications interrompu");
+        return;
+    }
+    if (!changes.isEmpty())
+        emit changed(changes);
+}
+
+bool ChangeFeedWorker::pullDeletions(ChangeSet &changes)
+{
+    QSqlDatabase db = m_db->getDatabase();
+    QSqlQuery q(db);
+    q.setForwardOnly(true);
+    q.prepare("SELECT id, table_name, row_id FROM deleted_row WHERE id > :lastId ORDER BY id");
+    q.bindValue(":lastId", m_lastDeletion);
+    if (!q.exec()) {
+        qWarning() << "Change feed deletion pull failed:" << q.lastError().text();
+        return false;
+    }
+    QList<int> commandes;
+    while (q.next()) {
+        if (q.value(1).toString() == "client")
+            changes.deletedClients << q.value(2).toInt();
+        else
+            commandes << q.value(2).toInt();
+        m_lastDeletion = q.value(0).toLongLong();
+    }
+
+    // Archiving leaves a tombstone too, but the order still exists
+    QSet<int> archived;
+    for (int start = 0; start < commandes.size(); start += DatabaseManager::BulkChunkSize) {
+        const QList<int> chunk = commandes.mid(start, DatabaseManager::BulkChunkSize);
+        QStringList placeholders;
+        for (int i = 0; i < chunk.size(); ++i)
+            placeholders << "?";
+        QSqlQuery archive(db);
+        archive.setForwardOnly(true);
+        archive.prepare("SELECT id_commande FROM commande_archive WHERE id_commande IN (" + placeholders.join(", ") + ")");
+        for (int id : chunk)
+            archive.addBindValue(id);
+        if (!archive.exec()) {
+            qWarning() << "Change feed archive lookup failed:" << archive.lastError().text();
+            return false;
+        }
+        while (archive.next())
+            archived.insert(archive.value(0).toInt());
+    }
+    for (int id : std::as_const(commandes)) {
+        if (!archived.contains(id))
+            changes.deletedCommandes << id;
+    }
+    return true;
+}
+
+// ---- ChangeFeed ----
+ChangeFeed::ChangeFeed(const DatabaseConfig &databaseConfig, const ChangeFeedConfig &feedConfig, QObject *parent)
+    : QObject(parent),
+    m_worker(new ChangeFeedWorker(databaseConfig, feedConfig))
+{
+    qRegisterMetaType<ChangeSet>();
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::started, m_worker, &ChangeFeedWorker::start);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    connect(m_worker, &ChangeFeedWorker::changed, this, &ChangeFeed::changed);
+    connect(m_worker, &ChangeFeedWorker::failed, this, [](const QString &error) {
+        qWarning() << "Change feed:" << error;
+    });
+}
+
+ChangeFeed::~ChangeFeed()
+{
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void ChangeFeed::start()
+{
+    m_thread.start();
+}
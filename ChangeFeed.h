@@ -0,0 +1,95 @@
+#ifndef CHANGEFEED_H
+#define CHANGEFEED_H
+
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QHash>
+#include "DatabaseManager.h"
+
+// Settings of the [change_feed] group of QTcredit.ini
+struct ChangeFeedConfig
+{
+    bool enabled = false;
+    int intervalMs = 3000;    // delay between two polls
+    int overlapSeconds = 5;   // re-read window for transactions that committed late
+    int maxRows = 5000;       // above this, the views reload instead of merging
+
+    static ChangeFeedConfig load(const QString &group = "change_feed");
+};
+
+// Rows written or deleted since the previous poll, by any instance
+struct ChangeSet
+{
+    QVector<ClientRow> clients;     // with their counters
+    QVector<CommandeRow> commandes; // with their client name
+    QList<int> deletedClients;      // their orders are gone too
+    QList<int> deletedCommandes;    // archived orders are not listed
+    bool reloadAll = false;         // too many changes to merge, rows left empty
+
+    bool isEmpty() const;
+    // Clients whose row or order totals changed
+    QList<int> clientIds() const;
+};
+Q_DECLARE_METATYPE(ChangeSet)
+
+// Runs in the feed thread with its own connection. Reads the updated_at
+// columns and the deleted_row log written by every instance; nothing is
+// reported for the changes made before start().
+class ChangeFeedWorker : public QObject
+{
+    Q_OBJECT
+public:
+    ChangeFeedWorker(const DatabaseConfig &databaseConfig, const ChangeFeedConfig &feedConfig);
+
+public slots:
+    void start();
+    void poll();
+
+signals:
+    void changed(const ChangeSet &changes);
+    void failed(const QString &error);
+
+private:
+    // High-water mark of one table, plus the rows already reported inside
+    // the overlap window so re-reading it does not report them again
+    struct Watermark {
+        QString highWater;
+        QHash<int, QString> reported; // id -> updated_at
+        QString floor;                // set by a reload: never rewind below it
+    };
+
+    template <typename Row>
+    bool pullRows(const QString &sql, const QString &keyColumn, Watermark &mark, QVector<Row> &rows, bool &overflow);
+    bool pullDeletions(ChangeSet &changes);
+    bool readWatermarks(bool reloaded = false);
+    QVariant stampParam(const QString &stamp, int secondsBack) const;
+
+    DatabaseConfig m_databaseConfig;
+    ChangeFeedConfig m_feedConfig;
+    DatabaseManager *m_db = nullptr;
+    QTimer *m_timer = nullptr;
+    Watermark m_clients;
+    Watermark m_commandes;
+    qint64 m_lastDeletion = 0;
+};
+
+// Polls for other instances' writes in a background thread
+class ChangeFeed : public QObject
+{
+    Q_OBJECT
+public:
+    ChangeFeed(const DatabaseConfig &databaseConfig, const ChangeFeedConfig &feedConfig, QObject *parent = nullptr);
+    ~ChangeFeed();
+
+    void start();
+
+signals:
+    void changed(const ChangeSet &changes);
+
+private:
+    QThread m_thread;
+    ChangeFeedWorker *m_worker;
+};
+
+#endif // CHANGEFEED_H
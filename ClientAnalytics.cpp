@@ -0,0 +1,230 @@
+#include "ClientAnalytics.h"
+#include "DatabaseManager.h"
+#include "PerfMonitor.h"
+#include <QDebug>
+#include <QSqlRecord>
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace {
+const QString CacheName = "clientAnalytics";
+}
+
+QString ClientMetrics::rfm() const
+{
+    if (orderCount == 0)
+        return "-";
+    return QString("%1%2%3").arg(recencyScore).arg(frequencyScore).arg(monetaryScore);
+}
+
+ClientAnalytics::ClientAnalytics(DatabaseManager *db, QObject *parent)
+    : QObject(parent), m_db(db)
+{
+    connect(m_db, &DatabaseManager::clientsChanged, this, &ClientAnalytics::reloadClients);
+}
+
+bool ClientAnalytics::refresh()
+{
+    m_metrics.clear();
+    m_loaded = loadMetrics(QList<int>());
+    m_scoresDirty = true;
+    emit updated();
+    return m_loaded;
+}
+
+void ClientAnalytics::reloadClients(const QList<int> &clientIds)
+{
+    // Nothing cached yet: the first read does the full scan anyway
+    if (!m_loaded || clientIds.isEmpty())
+        return;
+
+    for (int start = 0; start < clientIds.size(); start += DatabaseManager::BulkChunkSize) {
+        const QList<int> chunk = clientIds.mid(start, DatabaseManager::BulkChunkSize);
+        for (int id : chunk)
+            m_metrics.remove(id);
+        loadMetrics(chunk);
+    }
+    m_scoresDirty = true;
+    emit updated();
+}
+
+bool ClientAnalytics::loadMetrics(const QList<int> &clientIds)
+{
+    if (m_db->orderShards())
+        return loadShardedMetrics(clientIds);
+
+    QSqlQuery query = m_db->getClientMetrics(clientIds);
+    if (!query.isActive())
+        return false;
+
+    m_metrics.reserve(m_metrics.size() + (clientIds.isEmpty() ? 1024 : clientIds.size()));
+    while (query.next()) {
+        ClientMetrics metrics;
+        metrics.idClient = query.value(0).toInt();
+        metrics.nom = query.value(1).toString();
+        metrics.prenom = query.value(2).toString();
+        metrics.orderCount = query.value(3).toInt();
+        metrics.revenue = query.value(4).toDouble();
+        metrics.firstOrder = query.value(5).toDateTime();
+        metrics.lastOrder = query.value(6).toDateTime();
+        m_metrics.insert(metrics.idClient, metrics);
+    }
+    return true;
+}
+
+// Names from client, order totals summed on the shards owning the orders
+bool ClientAnalytics::loadShardedMetrics(const QList<int> &clientIds)
+{
+    bool read = false;
+    const QHash<int, DatabaseManager::ClientTotals> totals = m_db->shardClientTotals(clientIds, &read);
+    if (!read)
+        return false;
+    QSqlQuery query = clientIds.isEmpty() ? m_db->getClientsWithCommandCount(true) : m_db->getClientsByIds(clientIds);
+    if (!query.isActive())
+        return false;
+
+    const QSqlRecord record = query.record();
+    const int iClient = record.indexOf("id_client");
+    const int iNom = record.indexOf("nom");
+    const int iPrenom = record.indexOf("prenom");
+    m_metrics.reserve(m_metrics.size() + (clientIds.isEmpty() ? 1024 : clientIds.size()));
+    while (query.next()) {
+        ClientMetrics metrics;
+        metrics.idClient = query.value(iClient).toInt();
+        metrics.nom = query.value(iNom).toString();
+        metrics.prenom = query.value(iPrenom).toString();
+        const DatabaseManager::ClientTotals clientTotals = totals.value(metrics.idClient);
+        metrics.orderCount = clientTotals.count;
+        metrics.revenue = clientTotals.total;
+        metrics.firstOrder = clientTotals.firstOrder.toDateTime();
+        metrics.lastOrder = clientTotals.lastOrder.toDateTime();
+        m_metrics.insert(metrics.idClient, metrics);
+    }
+    return true;
+}
+
+const ClientMetrics *ClientAnalytics::metrics(int idClient)
+{
+    if (!m_loaded) {
+        PerfMonitor::cacheMiss(CacheName);
+        refresh();
+    } else {
+        PerfMonitor::cacheHit(CacheName);
+    }
+    ensureScores();
+
+    auto it = m_metrics.constFind(idClient);
+    return it == m_metrics.constEnd() ? nullptr : &it.value();
+}
+
+// Quintile of each client with orders on recency, frequency and revenue
+void ClientAnalytics::ensureScores()
+{
+    if (!m_scoresDirty)
+        return;
+
+    std::vector<ClientMetrics *> active;
+    active.reserve(m_metrics.size());
+    for (ClientMetrics &metrics : m_metrics) {
+        metrics.recencyScore = metrics.frequencyScore = metrics.monetaryScore = 0;
+        if (metrics.orderCount > 0)
+            active.push_back(&metrics);
+    }
+
+    const qsizetype count = qsizetype(active.size());
+    auto score = [&active, count](auto key, int ClientMetrics::*field) {
+        std::sort(active.begin(), active.end(),
+                  [&key](const ClientMetrics *a, const ClientMetrics *b) { return key(*a) < key(*b); });
+        for (qsizetype rank = 0; rank < count; ++rank)
+            active[rank]->*field = int(1 + rank * 5 / count);
+    };
+    score([](const ClientMetrics &m) { return m.lastOrder.toMSecsSinceEpoch(); }, &ClientMetrics::recencyScore);
+    score([](const ClientMetrics &m) { return m.orderCount; }, &ClientMetrics::frequencyScore);
+    score([](const ClientMetrics &m) { return m.revenue; }, &ClientMetrics::monetaryScore);
+
+    m_scoresDirty = false;
+}
+
+double ClientAnalytics::value(const ClientMetrics &metrics, Metric metric)
+{
+    switch (metric) {
+    case Metric::Revenue:
+        return metrics.revenue;
+    case Metric::OrderCount:
+        return metrics.orderCount;
+    case Metric::AverageBasket:
+        return metrics.averageBasket();
+    case Metric::LastOrder:
+        return metrics.lastOrder.isValid() ? double(metrics.lastOrder.toMSecsSinceEpoch())
+                                           : std::numeric_limits<double>::lowest();
+    case Metric::Rfm:
+        return metrics.rfmTotal();
+    }
+    return 0.0;
+}
+
+QString ClientAnalytics::metricName(Metric metric)
+{
+    switch (metric) {
+    case Metric::Revenue:
+        return "Chiffre d'affaires";
+    case Metric::OrderCount:
+        return "Nombre de commandes";
+    case Metric::AverageBasket:
+        return "Panier moyen";
+    case Metric::LastOrder:
+        return "Dernière commande";
+    case Metric::Rfm:
+        return "Score RFM";
+    }
+    return QString();
+}
+
+QList<ClientMetrics> ClientAnalytics::top(int n, Metric metric)
+{
+    return select(n, metric, true);
+}
+
+QList<ClientMetrics> ClientAnalytics::bottom(int n, Metric metric)
+{
+    return select(n, metric, false);
+}
+
+// Bounded heap: O(clients * log n) instead of sorting every client
+QList<ClientMetrics> ClientAnalytics::select(int n, Metric metric, bool highest)
+{
+    if (!m_loaded)
+        refresh();
+    ensureScores();
+    if (n <= 0)
+        return {};
+
+    // "a ranks before b"; the heap front is the weakest of the kept clients
+    auto before = [metric, highest](const ClientMetrics *a, const ClientMetrics *b) {
+        const double va = value(*a, metric);
+        const double vb = value(*b, metric);
+        return highest ? va > vb : va < vb;
+    };
+
+    std::vector<const ClientMetrics *> heap;
+    heap.reserve(size_t(n));
+    for (const ClientMetrics &metrics : std::as_const(m_metrics)) {
+        if (heap.size() < size_t(n)) {
+            heap.push_back(&metrics);
+            std::push_heap(heap.begin(), heap.end(), before);
+        } else if (before(&metrics, heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), before);
+            heap.back() = &metrics;
+            std::push_heap(heap.begin(), heap.end(), before);
+        }
+    }
+    std::sort_heap(heap.begin(), heap.end(), before);
+
+    QList<ClientMetrics> result;
+    result.reserve(qsizetype(heap.size()));
+    for (const ClientMetrics *metrics : heap)
+        result << *metrics;
+    return result;
+}
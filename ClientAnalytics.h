@@ -0,0 +1,77 @@
+#ifndef CLIENTANALYTICS_H
+#define CLIENTANALYTICS_H
+
+#include <QObject>
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QVector>
+
+class DatabaseManager;
+
+// Order statistics of one client plus its RFM scores (1 = lowest quintile,
+// 5 = highest; 0 for a client without orders)
+struct ClientMetrics
+{
+    int idClient = 0;
+    QString nom;
+    QString prenom;
+    int orderCount = 0;
+    double revenue = 0.0;
+    QDateTime firstOrder;
+    QDateTime lastOrder;
+
+    int recencyScore = 0;
+    int frequencyScore = 0;
+    int monetaryScore = 0;
+
+    double averageBasket() const { return orderCount > 0 ? revenue / orderCount : 0.0; }
+    int rfmTotal() const { return recencyScore + frequencyScore + monetaryScore; }
+    QString rfm() const;
+};
+
+// Metrics of every client, loaded with one grouped scan and kept in memory.
+// Writes reported by DatabaseManager::clientsChanged() reload only the
+// clients concerned; the scores are recomputed on the next read.
+class ClientAnalytics : public QObject
+{
+    Q_OBJECT
+public:
+    enum class Metric { Revenue, OrderCount, AverageBasket, LastOrder, Rfm };
+
+    explicit ClientAnalytics(DatabaseManager *db, QObject *parent = nullptr);
+
+    bool refresh();
+    bool isLoaded() const { return m_loaded; }
+    int clientCount() const { return m_metrics.size(); }
+
+    // nullptr if the client is unknown
+    const ClientMetrics *metrics(int idClient);
+
+    // Best / worst n clients for a metric, best first (resp. worst first)
+    QList<ClientMetrics> top(int n, Metric metric);
+    QList<ClientMetrics> bottom(int n, Metric metric);
+
+    static QString metricName(Metric metric);
+
+signals:
+    void updated();
+
+public slots:
+    // Reloads the cached metrics of these clients only
+    void reloadClients(const QList<int> &clientIds);
+
+private:
+    bool loadMetrics(const QList<int> &clientIds);
+    bool loadShardedMetrics(const QList<int> &clientIds);
+    void ensureScores();
+    QList<ClientMetrics> select(int n, Metric metric, bool highest);
+    static double value(const ClientMetrics &metrics, Metric metric);
+
+    DatabaseManager *m_db;
+    QHash<int, ClientMetrics> m_metrics;
+    bool m_loaded = false;
+    bool m_scoresDirty = true;
+};
+
+#endif // CLIENTANALYTICS_H
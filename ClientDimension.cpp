@@ -0,0 +1,160 @@
+#include "ClientDimension.h"
+#include "DatabaseManager.h"
+#include "PerfMonitor.h"
+#include <QDebug>
+#include <QSqlQuery>
+#include <QSqlError>
+
+namespace {
+const char *CacheName = "Dimension client";
+const int OverlapSeconds = 5;
+
+// updated_at is a DATETIME on MySQL and ISO text on SQLite
+QVariant stampParam(const QSqlDatabase &db, const QDateTime &stamp)
+{
+    if (db.driverName() == "QSQLITE")
+        return stamp.toString("yyyy-MM-ddTHH:mm:ss.zzz");
+    return stamp;
+}
+}
+
+bool ClientDimension::refresh(const QSqlDatabase &db)
+{
+    QSqlQuery q(db);
+    q.setForwardOnly(true);
+    if (!m_loaded) {
+        m_names.clear();
+        m_pool.clear();
+        m_stale = 0;
+        q.prepare("SELECT id_client, nom, prenom, updated_at FROM client");
+    } else {
+        // idx_client_updated: usually an empty range
+        q.prepare("SELECT id_client, nom, prenom, updated_at FROM client WHERE updated_at > ?");
+        q.addBindValue(stampParam(db, m_highWater.addSecs(-OverlapSeconds)));
+    }
+    if (!q.exec()) {
+        qWarning() << "Client dimension refresh failed:" << q.lastError().text();
+        return false;
+    }
+
+    while (q.next()) {
+        upsert(q.value(0).toInt(), q.value(1).toString(), q.value(2).toString());
+        const QDateTime stamp = q.value(3).toDateTime();
+        if (stamp.isValid() && (!m_highWater.isValid() || stamp > m_highWater))
+            m_highWater = stamp;
+    }
+    m_loaded = true;
+    // Renamed and deleted clients leave their strings behind
+    if (m_stale > m_names.size() / 4)
+        prunePool();
+    return true;
+}
+
+void ClientDimension::clear()
+{
+    m_names.clear();
+    m_pool.clear();
+    m_stale = 0;
+    m_highWater = QDateTime();
+    m_loaded = false;
+}
+
+QString ClientDimension::intern(const QString &text)
+{
+    const auto it = m_pool.constFind(text);
+    if (it != m_pool.constEnd())
+        return *it;
+    m_pool.insert(text);
+    return text;
+}
+
+// Keeps only the strings still used by a client
+void ClientDimension::prunePool()
+{
+    QSet<QString> pool;
+    pool.reserve(m_names.size());
+    for (const Names &names : std::as_const(m_names)) {
+        pool.insert(names.nom);
+        pool.insert(names.prenom);
+    }
+    m_pool.swap(pool);
+    m_stale = 0;
+}
+
+void ClientDimension::upsert(int idClient, const QString &nom, const QString &prenom)
+{
+    auto it = m_names.find(idClient);
+    if (it == m_names.end()) {
+        m_names.insert(idClient, Names{intern(nom), intern(prenom)});
+        return;
+    }
+    if (it->nom != nom || it->prenom != prenom) {
+        *it = Names{intern(nom), intern(prenom)};
+        ++m_stale;
+    }
+}
+
+void ClientDimension::remove(int idClient)
+{
+    if (m_names.remove(idClient))
+        ++m_stale;
+}
+
+bool ClientDimension::fetch(const QSqlDatabase &db, const QList<int> &ids)
+{
+    for (int start = 0; start < ids.size(); start += DatabaseManager::BulkChunkSize) {
+        const QList<int> chunk = ids.mid(start, DatabaseManager::BulkChunkSize);
+        QSqlQuery q(db);
+        q.setForwardOnly(true);
+        q.prepare("SELECT id_client, nom, prenom FROM client WHERE id_client IN ("
+                  + QStringList(chunk.size(), "?").join(", ") + ")");
+        for (int id : chunk)
+            q.addBindValue(id);
+        if (!q.exec()) {
+            qWarning() << "Client dimension lookup failed:" << q.lastError().text();
+            return false;
+        }
+        while (q.next())
+            upsert(q.value(0).toInt(), q.value(1).toString(), q.value(2).toString());
+    }
+    return true;
+}
+
+void ClientDimension::fill(const QSqlDatabase &db, CommandeRow &row)
+{
+    auto it = m_names.constFind(row.idClient);
+    if (it == m_names.constEnd()) {
+        PerfMonitor::cacheMiss(CacheName);
+        fetch(db, {row.idClient});
+        it = m_names.constFind(row.idClient);
+        if (it == m_names.constEnd())
+            return;
+    } else {
+        PerfMonitor::cacheHit(CacheName);
+    }
+    row.nom = it->nom;
+    row.prenom = it->prenom;
+}
+
+// Unknown clients are read in one batch first, then the rows are filled
+void ClientDimension::fill(const QSqlDatabase &db, QVector<CommandeRow> &rows)
+{
+    QSet<int> missing;
+    for (const CommandeRow &row : std::as_const(rows)) {
+        if (!m_names.contains(row.idClient))
+            missing.insert(row.idClient);
+    }
+    if (rows.size() > missing.size())
+        PerfMonitor::cacheHit(CacheName, rows.size() - missing.size());
+    if (!missing.isEmpty()) {
+        PerfMonitor::cacheMiss(CacheName, missing.size());
+        fetch(db, QList<int>(missing.cbegin(), missing.cend()));
+    }
+    for (CommandeRow &row : rows) {
+        const auto it = m_names.constFind(row.idClient);
+        if (it != m_names.constEnd()) {
+            row.nom = it->nom;
+            row.prenom = it->prenom;
+        }
+    }
+}
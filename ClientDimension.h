@@ -0,0 +1,50 @@
+#ifndef CLIENTDIMENSION_H
+#define CLIENTDIMENSION_H
+
+#include <QHash>
+#include <QSet>
+#include <QSqlDatabase>
+#include <QDateTime>
+#include "RowCursor.h"
+
+// id_client -> nom / prenom of every client, so the order lists read only
+// commande columns and get the names from memory. Equal names share one
+// string. Loaded on first use, then kept fresh by the writes of this
+// manager and by an updated_at delta read before each order list.
+// One per DatabaseManager, used from its thread only.
+class ClientDimension
+{
+public:
+    struct Names {
+        QString nom;
+        QString prenom;
+    };
+
+    // Everything the first time, then the clients stamped since the last
+    // call (minus an overlap for transactions that committed late)
+    bool refresh(const QSqlDatabase &db);
+    void clear();
+
+    void upsert(int idClient, const QString &nom, const QString &prenom);
+    void remove(int idClient);
+
+    // Names of row.idClient; a client unknown here (created elsewhere since
+    // the last refresh) is read from db
+    void fill(const QSqlDatabase &db, CommandeRow &row);
+    void fill(const QSqlDatabase &db, QVector<CommandeRow> &rows);
+
+    int size() const { return m_names.size(); }
+
+private:
+    QString intern(const QString &text);
+    void prunePool();
+    bool fetch(const QSqlDatabase &db, const QList<int> &ids);
+
+    QHash<int, Names> m_names;
+    QSet<QString> m_pool;        // interned nom / prenom strings
+    int m_stale = 0;             // names replaced or removed since the last prune
+    QDateTime m_highWater;       // latest updated_at read
+    bool m_loaded = false;
+};
+
+#endif // CLIENTDIMENSION_H
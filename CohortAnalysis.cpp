@@ -0,0 +1,397 @@
+#include "CohortAnalysis.h"
+#include "OrderShards.h"
+#include <QDebug>
+#include <QFuture>
+#include <QThread>
+#include <QtConcurrent>
+#include <utility>
+
+namespace {
+// Rows read before the shards get to work on them; the next batch is read meanwhile
+const int BatchSize = 65536;
+
+int monthIndex(const QDate &date)
+{
+    return date.year() * 12 + date.month() - 1;
+}
+
+QDate monthStart(int month)
+{
+    return QDate(month / 12, month % 12 + 1, 1);
+}
+}
+
+QDate CohortMatrix::cohortDate(int cohort) const
+{
+    return monthStart(firstMonth + cohort);
+}
+
+double CohortMatrix::retention(int cohort, int offset) const
+{
+    const int size = cohortSize.value(cohort);
+    if (size == 0 || offset < 0 || offset >= offsets(cohort))
+        return 0.0;
+    return double(active.at(cohort * months + offset)) / size;
+}
+
+double CohortMatrix::lifetimeValue(int cohort, int offset) const
+{
+    const int size = cohortSize.value(cohort);
+    if (size == 0 || offset < 0)
+        return 0.0;
+    double total = 0.0;
+    for (int o = 0; o <= offset && o < offsets(cohort); ++o)
+        total += revenue.at(cohort * months + o);
+    return total / size;
+}
+
+CohortAnalysis::CohortAnalysis(const DatabaseConfig &config)
+    : m_config(config)
+{
+    m_config.connectionName = "cohort_analysis";
+    m_config.manageSchema = false;
+}
+
+CohortMatrix CohortAnalysis::matrix() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_matrix;
+}
+
+bool CohortAnalysis::lastRunIncremental() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_incremental;
+}
+
+qint64 CohortAnalysis::lastRunOrders() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_orders;
+}
+
+bool CohortAnalysis::compute(QString *error)
+{
+    bool ok = false;
+    {
+        // Connection opened and closed in the calling thread
+        DatabaseManager db(m_config);
+        if (!db.open()) {
+            if (error)
+                *error = "Connexion à la base de données impossible";
+            return false;
+        }
+
+        const ShardConfig shardConfig = ShardConfig::load();
+        QString shardError;
+        if (shardConfig.enabled && !db.attachShards(shardConfig, &shardError)) {
+            if (error)
+                *error = "Partitions de commandes inaccessibles: " + shardError;
+            return false;
+        }
+
+        // The shards have no change tracking: always a full run there
+        const int currentMonth = monthIndex(QDate::currentDate());
+        if (db.orderShards())
+            ok = fullCompute(db, error);
+        else if (m_valid && m_latestMonth == currentMonth && historyUnchanged(db, currentMonth))
+            ok = incrementalCompute(db, error);
+        else
+            ok = fullCompute(db, error);
+    }
+    return ok;
+}
+
+// Watermarks are read before the data: a write racing with the scan makes
+// the next run a full one rather than being missed
+bool CohortAnalysis::readWatermarks(DatabaseManager &db)
+{
+    QSqlQuery q(db.getDatabase());
+    if (!q.exec("SELECT MAX(updated_at) FROM commande") || !q.next())
+        return false;
+    m_updatedStamp = q.value(0);
+    if (!q.exec("SELECT COALESCE(MAX(id), 0) FROM deleted_row") || !q.next())
+        return false;
+    m_lastDeletion = q.value(0).toLongLong();
+    return true;
+}
+
+// No order dated before the latest month was written or deleted since the last run
+bool CohortAnalysis::historyUnchanged(DatabaseManager &db, int monthStartIndex)
+{
+    if (m_updatedStamp.isNull())
+        return false;
+
+    QSqlQuery q(db.getDatabase());
+    q.prepare("SELECT COUNT(*) FROM commande WHERE updated_at > :stamp AND date_commande < :start");
+    q.bindValue(":stamp", m_updatedStamp);
+    q.bindValue(":start", QDateTime(monthStart(monthStartIndex), QTime(0, 0)));
+    if (!q.exec() || !q.next() || q.value(0).toInt() > 0)
+        return false;
+
+    // Deleting a client removes its orders too
+    q.prepare("SELECT COUNT(*) FROM deleted_row WHERE id > :last");
+    q.bindValue(":last", m_lastDeletion);
+    if (!q.exec() || !q.next() || q.value(0).toInt() > 0)
+        return false;
+
+    // Orders dated after the matrix would need more columns
+    if (!q.exec("SELECT MAX(date_commande) FROM commande") || !q.next())
+        return false;
+    const QDateTime latest = q.value(0).toDateTime();
+    return !latest.isValid() || monthIndex(latest.date()) < m_matrix.firstMonth + m_matrix.months;
+}
+
+qint64 CohortAnalysis::streamOrders(QSqlQuery &query, const QHash<int, int> &clientCohort, int firstMonth, int months,
+                                    QVector<Shard> &shards)
+{
+    const int shardCount = shards.size();
+    QVector<QVector<OrderPoint>> filling(shardCount);
+    QVector<QVector<OrderPoint>> processing(shardCount);
+    QList<int> shardIndexes;
+    for (int s = 0; s < shardCount; ++s) {
+        shardIndexes << s;
+        filling[s].reserve(BatchSize / shardCount + 1);
+    }
+
+    // Each shard only sees its own clients, so its active-client set is exact
+    auto process = [&](int s) {
+        Shard &shard = shards[s];
+        for (const OrderPoint &point : std::as_const(processing[s])) {
+            const int cohort = clientCohort.value(point.client, -1);
+            const int row = cohort - firstMonth;
+            const int offset = point.month - cohort;
+            if (cohort < 0 || row < 0 || offset < 0 || row + offset >= months)
+                continue;
+            const int cell = row * months + offset;
+            shard.revenue[cell] += point.amount;
+            const qint64 key = (qint64(point.client) << 16) | (row + offset);
+            if (!shard.seen.contains(key)) {
+                shard.seen.insert(key);
+                shard.active[cell]++;
+            }
+        }
+    };
+
+    QFuture<void> running;
+    auto dispatch = [&]() {
+        running.waitForFinished();
+        std::swap(filling, processing);
+        for (QVector<OrderPoint> &buffer : filling)
+            buffer.resize(0);
+        running = QtConcurrent::map(shardIndexes, process);
+    };
+
+    qint64 rows = 0;
+    int pending = 0;
+    while (query.next()) {
+        const int client = query.value(0).toInt();
+        filling[client % shardCount].append(OrderPoint{client, query.value(1).toInt(), query.value(2).toDouble()});
+        ++rows;
+        if (++pending == BatchSize) {
+            dispatch();
+            pending = 0;
+        }
+    }
+    dispatch();
+    running.waitForFinished();
+    return rows;
+}
+
+// Orders sorted by client then date: the first row of a client gives its
+// cohort, and a client counts once more as active whenever the month changes
+bool CohortAnalysis::readPass(QSqlDatabase db, const QString &orderSource, Pass &pass, QSqlError &error)
+{
+    const QString monthExpr = DatabaseManager::monthIndexExpression(db, "date_commande");
+    QSqlQuery q(db);
+    q.setForwardOnly(true);
+    if (!q.exec(QString("SELECT id_client, %1, montant_total FROM %2 co ORDER BY id_client, date_commande")
+                    .arg(monthExpr, orderSource))) {
+        error = q.lastError();
+        return false;
+    }
+
+    int client = -1;
+    int cohort = 0;
+    int month = -1;
+    while (q.next()) {
+        const int rowClient = q.value(0).toInt();
+        const int rowMonth = q.value(1).toInt();
+        const bool firstOrder = rowClient != client;
+        if (firstOrder) {
+            client = rowClient;
+            cohort = rowMonth;
+            pass.clientCohort.insert(client, cohort);
+        }
+        Cell &cell = pass.cells[(qint64(cohort) << 32) | rowMonth];
+        if (firstOrder || rowMonth != month)
+            cell.active++;
+        cell.revenue += q.value(2).toDouble();
+        month = rowMonth;
+        pass.lastMonth = qMax(pass.lastMonth, rowMonth);
+        ++pass.rows;
+    }
+    if (q.lastError().isValid()) {
+        error = q.lastError();
+        return false;
+    }
+    return true;
+}
+
+bool CohortAnalysis::fullCompute(DatabaseManager &db, QString *error)
+{
+    const int currentMonth = monthIndex(QDate::currentDate());
+
+    OrderShards *shards = db.orderShards();
+    if (!shards && !readWatermarks(db)) {
+        if (error)
+            *error = "Lecture de l'état des commandes impossible";
+        return false;
+    }
+
+    Pass pass;
+    QSqlError readError;
+    if (shards) {
+        // All the orders of a client are on one shard, so the passes add up
+        QVector<Pass> parts(shards->count());
+        QVector<QSqlError> errors(shards->count());
+        shards->scatter([&parts, &errors](int shard, QSqlDatabase connection) {
+            readPass(connection, "commande", parts[shard], errors[shard]);
+        });
+        for (int shard = 0; shard < shards->count() && !readError.isValid(); ++shard) {
+            const Pass &part = parts.at(shard);
+            readError = errors.at(shard);
+            pass.clientCohort.insert(part.clientCohort);
+            for (auto it = part.cells.cbegin(); it != part.cells.cend(); ++it) {
+                Cell &cell = pass.cells[it.key()];
+                cell.active += it.value().active;
+                cell.revenue += it.value().revenue;
+            }
+            pass.lastMonth = qMax(pass.lastMonth, part.lastMonth);
+            pass.rows += part.rows;
+        }
+    } else {
+        // Archived orders are the oldest ones, so they decide most cohorts
+        readPass(db.getDatabase(), db.ordersSource(QDate(), QDate()), pass, readError);
+    }
+    if (readError.isValid()) {
+        if (error)
+            *error = "Lecture des commandes impossible: " + readError.text();
+        return false;
+    }
+
+    int firstMonth = currentMonth;
+    for (int cohort : std::as_const(pass.clientCohort))
+        firstMonth = qMin(firstMonth, cohort);
+
+    CohortMatrix matrix;
+    matrix.firstMonth = firstMonth;
+    matrix.months = qMax(currentMonth, pass.lastMonth) - firstMonth + 1;
+    matrix.cohortSize.fill(0, matrix.months);
+    matrix.active.fill(0, matrix.months * matrix.months);
+    matrix.revenue.fill(0.0, matrix.months * matrix.months);
+    for (int cohort : std::as_const(pass.clientCohort))
+        matrix.cohortSize[cohort - firstMonth]++;
+    for (auto it = pass.cells.cbegin(); it != pass.cells.cend(); ++it) {
+        const int row = int(it.key() >> 32) - firstMonth;
+        const int offset = int(it.key() & 0xffffffff) - firstMonth - row;
+        if (offset < 0 || row + offset >= matrix.months)
+            continue;
+        matrix.active[row * matrix.months + offset] += it.value().active;
+        matrix.revenue[row * matrix.months + offset] += it.value().revenue;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_matrix = std::move(matrix);
+    m_clientCohort = std::move(pass.clientCohort);
+    m_latestMonth = currentMonth;
+    m_valid = true;
+    m_incremental = false;
+    m_orders = pass.rows;
+    return true;
+}
+
+// Recomputes the cells of the latest month (and any later one) only
+bool CohortAnalysis::incrementalCompute(DatabaseManager &db, QString *error)
+{
+    QSqlDatabase sql = db.getDatabase();
+    const QString monthExpr = DatabaseManager::monthIndexExpression(sql, "date_commande");
+    const QDateTime start(monthStart(m_latestMonth), QTime(0, 0));
+
+    if (!readWatermarks(db)) {
+        if (error)
+            *error = "Lecture de l'état des commandes impossible";
+        return false;
+    }
+
+    CohortMatrix matrix = this->matrix();
+    QHash<int, int> clientCohort = m_clientCohort;
+    const int recentRow = m_latestMonth - matrix.firstMonth;
+
+    // Forget what the previous run counted from the latest month on
+    for (int row = 0; row < matrix.months; ++row) {
+        for (int offset = qMax(0, recentRow - row); row + offset < matrix.months; ++offset) {
+            matrix.active[row * matrix.months + offset] = 0;
+            matrix.revenue[row * matrix.months + offset] = 0.0;
+        }
+    }
+    for (int row = recentRow; row < matrix.months; ++row)
+        matrix.cohortSize[row] = 0;
+    for (auto it = clientCohort.begin(); it != clientCohort.end();) {
+        if (it.value() >= m_latestMonth)
+            it = clientCohort.erase(it);
+        else
+            ++it;
+    }
+
+    // Clients without an earlier order start their cohort now
+    QSqlQuery q(sql);
+    q.setForwardOnly(true);
+    q.prepare(QString("SELECT id_client, MIN(%1) FROM commande WHERE date_commande >= :start GROUP BY id_client")
+                  .arg(monthExpr));
+    q.bindValue(":start", start);
+    if (!q.exec()) {
+        if (error)
+            *error = "Calcul des cohortes impossible: " + q.lastError().text();
+        return false;
+    }
+    while (q.next()) {
+        const int client = q.value(0).toInt();
+        if (clientCohort.contains(client))
+            continue;
+        const int cohort = q.value(1).toInt();
+        clientCohort.insert(client, cohort);
+        matrix.cohortSize[cohort - matrix.firstMonth]++;
+    }
+
+    QVector<Shard> shards(qMax(1, QThread::idealThreadCount()));
+    for (Shard &shard : shards) {
+        shard.active.fill(0, matrix.months * matrix.months);
+        shard.revenue.fill(0.0, matrix.months * matrix.months);
+    }
+
+    QSqlQuery orders(sql);
+    orders.setForwardOnly(true);
+    orders.prepare(QString("SELECT id_client, %1, montant_total FROM commande WHERE date_commande >= :start").arg(monthExpr));
+    orders.bindValue(":start", start);
+    if (!orders.exec()) {
+        if (error)
+            *error = "Lecture des commandes impossible: " + orders.lastError().text();
+        return false;
+    }
+    const qint64 rows = streamOrders(orders, clientCohort, matrix.firstMonth, matrix.months, shards);
+
+    for (const Shard &shard : std::as_const(shards)) {
+        for (int cell = 0; cell < matrix.active.size(); ++cell) {
+            matrix.active[cell] += shard.active.at(cell);
+            matrix.revenue[cell] += shard.revenue.at(cell);
+        }
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_matrix = std::move(matrix);
+    m_clientCohort = std::move(clientCohort);
+    m_incremental = true;
+    m_orders = rows;
+    return true;
+}
@@ -0,0 +1,93 @@
+#ifndef COHORTANALYSIS_H
+#define COHORTANALYSIS_H
+
+#include <QDate>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QVariant>
+#include <QVector>
+#include "DatabaseManager.h"
+
+// Clients grouped by the month of their first order (cohort), followed
+// month by month. Month numbers are year * 12 + month - 1.
+struct CohortMatrix
+{
+    int firstMonth = 0;               // month of the first cohort
+    int months = 0;                   // number of cohorts = number of offsets
+    QVector<int> cohortSize;          // [cohort] clients acquired that month
+    QVector<int> active;              // [cohort * months + offset] clients ordering that month
+    QVector<double> revenue;          // [cohort * months + offset]
+
+    bool isEmpty() const { return months == 0; }
+    QDate cohortDate(int cohort) const;
+    // Share of the cohort that ordered `offset` months after acquisition
+    double retention(int cohort, int offset) const;
+    // Cumulative revenue per acquired client up to `offset` (lifetime value curve)
+    double lifetimeValue(int cohort, int offset) const;
+    // Offsets that exist for this cohort (later ones are in the future)
+    int offsets(int cohort) const { return months - cohort; }
+};
+
+// Cohort retention and lifetime value. A full run reads the orders once,
+// sorted by client and date, so the first order of each client gives its
+// cohort on the fly. When only orders of the latest month changed since the
+// previous run, only that month is read again, sharded by client over the
+// thread pool and the per-shard matrices merged. With order shards, each
+// shard makes the full pass over its own orders and the passes are added.
+class CohortAnalysis
+{
+public:
+    explicit CohortAnalysis(const DatabaseConfig &config);
+
+    // Blocking; opens its own connection so it can run in any thread
+    bool compute(QString *error = nullptr);
+
+    CohortMatrix matrix() const;
+    bool lastRunIncremental() const;
+    qint64 lastRunOrders() const;
+
+private:
+    struct OrderPoint {
+        int client;
+        int month;
+        double amount;
+    };
+    struct Shard {
+        QVector<int> active;
+        QVector<double> revenue;
+        QSet<qint64> seen; // (client << 16 | cell month) already counted as active
+    };
+    struct Cell {
+        int active = 0;
+        double revenue = 0.0;
+    };
+    // What one full pass read
+    struct Pass {
+        QHash<int, int> clientCohort;  // client -> cohort month
+        QHash<qint64, Cell> cells;     // (cohort << 32 | month)
+        int lastMonth = -1;            // latest order month
+        qint64 rows = 0;
+    };
+
+    bool fullCompute(DatabaseManager &db, QString *error);
+    bool incrementalCompute(DatabaseManager &db, QString *error);
+    bool historyUnchanged(DatabaseManager &db, int monthStartIndex);
+    bool readWatermarks(DatabaseManager &db);
+    static bool readPass(QSqlDatabase db, const QString &orderSource, Pass &pass, QSqlError &error);
+    qint64 streamOrders(QSqlQuery &query, const QHash<int, int> &clientCohort, int firstMonth, int months,
+                        QVector<Shard> &shards);
+
+    DatabaseConfig m_config;
+    mutable QMutex m_mutex;
+    CohortMatrix m_matrix;
+    QHash<int, int> m_clientCohort; // client -> cohort month
+    QVariant m_updatedStamp;        // MAX(commande.updated_at) at the last run
+    qint64 m_lastDeletion = 0;      // MAX(deleted_row.id) at the last run
+    int m_latestMonth = -1;         // current month at the last run
+    bool m_valid = false;
+    bool m_incremental = false;
+    qint64 m_orders = 0;
+};
+
+#endif // COHORTANALYSIS_H
@@ -0,0 +1,297 @@
+#include "CsvExporter.h"
+#include "DatabaseManager.h"
+#include <QSaveFile>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QSqlError>
+#include <QDateTime>
+
+#ifdef QTCREDIT_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+const qsizetype BufferSize = 1 << 20; // 1 MiB between two writes
+
+// Collects output in a fixed buffer and hands full chunks to the file,
+// through deflate when gzip is requested
+class BufferedSink
+{
+public:
+    BufferedSink(QSaveFile &file, bool gzip) : m_file(file), m_gzip(gzip)
+    {
+        m_buffer.reserve(BufferSize + 4096);
+    }
+
+    ~BufferedSink()
+    {
+#ifdef QTCREDIT_HAVE_ZLIB
+        if (m_streamReady)
+            deflateEnd(&m_stream);
+#endif
+    }
+
+    bool init(QString *error)
+    {
+        if (!m_gzip)
+            return true;
+#ifdef QTCREDIT_HAVE_ZLIB
+        m_stream = z_stream();
+        // 15 + 16: deflate with a gzip header instead of a zlib one
+        if (deflateInit2(&m_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            *error = "Initialisation de la compression gzip impossible";
+            return false;
+        }
+        m_streamReady = true;
+        m_compressed.resize(BufferSize);
+        return true;
+#else
+        *error = "Compression gzip non disponible dans cette version (CONFIG+=qtcredit_zlib)";
+        return false;
+#endif
+    }
+
+    void append(const QByteArray &bytes)
+    {
+        m_buffer.append(bytes);
+        if (m_buffer.size() >= BufferSize)
+            flush(false);
+    }
+
+    void append(char c)
+    {
+        m_buffer.append(c);
+    }
+
+    bool flush(bool finish)
+    {
+        if (!m_ok)
+            return false;
+
+        if (!m_gzip) {
+            if (!m_buffer.isEmpty() && m_file.write(m_buffer) != m_buffer.size())
+                m_ok = false;
+            m_buffer.resize(0);
+            return m_ok;
+        }
+
+#ifdef QTCREDIT_HAVE_ZLIB
+        m_stream.next_in = reinterpret_cast<Bytef *>(m_buffer.data());
+        m_stream.avail_in = static_cast<uInt>(m_buffer.size());
+        int status = Z_OK;
+        do {
+            m_stream.next_out = reinterpret_cast<Bytef *>(m_compressed.data());
+            m_stream.avail_out = static_cast<uInt>(m_compressed.size());
+            status = deflate(&m_stream, finish ? Z_FINISH : Z_NO_FLUSH);
+            const qint64 produced = m_compressed.size() - m_stream.avail_out;
+            if (produced > 0 && m_file.write(m_compressed.constData(), produced) != produced) {
+                m_ok = false;
+                break;
+            }
+        } while (m_stream.avail_out == 0 || (finish && status != Z_STREAM_END));
+#endif
+        m_buffer.resize(0);
+        return m_ok;
+    }
+
+private:
+    QSaveFile &m_file;
+    bool m_gzip;
+    bool m_ok = true;
+    QByteArray m_buffer;
+#ifdef QTCREDIT_HAVE_ZLIB
+    z_stream m_stream;
+    bool m_streamReady = false;
+    QByteArray m_compressed;
+#endif
+};
+
+QByteArray formatValue(const QVariant &value)
+{
+    if (value.isNull())
+        return QByteArray();
+
+    switch (value.metaType().id()) {
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+        return QByteArray::number(value.toLongLong());
+    case QMetaType::Double:
+        return QByteArray::number(value.toDouble(), 'f', 2);
+    case QMetaType::QDateTime:
+        return value.toDateTime().toString("yyyy-MM-dd HH:mm:ss").toLatin1();
+    case QMetaType::QDate:
+        return value.toDate().toString(Qt::ISODate).toLatin1();
+    default:
+        return value.toString().toUtf8();
+    }
+}
+
+void appendField(BufferedSink &sink, const QByteArray &field, CsvExporter::Format format)
+{
+    if (format == CsvExporter::Format::Tsv) {
+        // TSV has no quoting: flatten separators
+        if (field.contains('\t') || field.contains('\n') || field.contains('\r')) {
+            QByteArray flat = field;
+            flat.replace('\t', ' ').replace('\n', ' ').replace('\r', ' ');
+            sink.append(flat);
+        } else {
+            sink.append(field);
+        }
+        return;
+    }
+
+    // RFC 4180 quoting, with ';' as separator for French spreadsheets
+    if (field.contains(';') || field.contains('"') || field.contains('\n') || field.contains('\r')) {
+        QByteArray quoted = field;
+        quoted.replace("\"", "\"\"");
+        sink.append('"');
+        sink.append(quoted);
+        sink.append('"');
+    } else {
+        sink.append(field);
+    }
+}
+}
+
+CsvExporter::Options CsvExporter::optionsForFile(const QString &fileName)
+{
+    Options options;
+    QString name = fileName.toLower();
+    if (name.endsWith(".gz")) {
+        options.gzip = true;
+        name.chop(3);
+    }
+    options.format = name.endsWith(".tsv") ? Format::Tsv : Format::Csv;
+    return options;
+}
+
+bool CsvExporter::gzipAvailable()
+{
+#ifdef QTCREDIT_HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+CsvExporter::Result CsvExporter::exportQuery(QSqlQuery &query, const QString &fileName, const Options &options,
+                                             const QStringList &headers)
+{
+    if (!query.isActive()) {
+        Result result;
+        result.error = "Requête invalide: " + query.lastError().text();
+        return result;
+    }
+
+    const QSqlRecord record = query.record();
+    QStringList columns;
+    for (int c = 0; c < record.count(); ++c)
+        columns << (c < headers.size() ? headers.at(c) : record.fieldName(c));
+
+    return writeRows(fileName, options, columns,
+                     [&query](QVariantList &values) {
+                         if (!query.next())
+                             return false;
+                         for (int c = 0; c < values.size(); ++c)
+                             values[c] = query.value(c);
+                         return true;
+                     },
+                     [&query]() { return query.lastError(); });
+}
+
+CsvExporter::Result CsvExporter::writeRows(const QString &fileName, const Options &options,
+                                           const QStringList &headers, const std::function<bool(QVariantList &)> &next,
+                                           const std::function<QSqlError()> &readError)
+{
+    Result result;
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        result.error = "Impossible d'écrire le fichier " + fileName;
+        return result;
+    }
+
+    BufferedSink sink(file, options.gzip);
+    if (!sink.init(&result.error)) {
+        file.cancelWriting();
+        return result;
+    }
+
+    const char separator = options.format == Format::Tsv ? '\t' : ';';
+    const int columns = headers.size();
+
+    // UTF-8 BOM so spreadsheet applications detect the encoding
+    if (options.format == Format::Csv)
+        sink.append(QByteArray("\xEF\xBB\xBF"));
+
+    for (int c = 0; c < columns; ++c) {
+        if (c > 0)
+            sink.append(separator);
+        appendField(sink, headers.at(c).toUtf8(), options.format);
+    }
+    sink.append('\n');
+
+    QVariantList values(columns);
+    while (next(values)) {
+        for (int c = 0; c < columns; ++c) {
+            if (c > 0)
+                sink.append(separator);
+            appendField(sink, formatValue(values.at(c)), options.format);
+        }
+        sink.append('\n');
+        result.rows++;
+    }
+
+    const QSqlError error = readError();
+    if (error.isValid()) {
+        result.error = "Lecture interrompue: " + error.text();
+        file.cancelWriting();
+        return result;
+    }
+    if (!sink.flush(true) || !file.commit()) {
+        result.error = "Impossible d'écrire le fichier " + fileName;
+        return result;
+    }
+
+    result.ok = true;
+    return result;
+}
+
+CsvExporter::Result CsvExporter::exportClients(DatabaseManager &db, const QString &fileName, const Options &options)
+{
+    QSqlQuery query = db.getClientsWithCommandCount(true);
+    return exportQuery(query, fileName, options);
+}
+
+CsvExporter::Result CsvExporter::exportCommandes(DatabaseManager &db, const CommandeFilter &filter,
+                                                 const QString &fileName, const Options &options)
+{
+    // Start of the name, so idx_client_nom_key is used
+    const QString nameLike = filter.clientName.isEmpty() ? QString() : filter.clientName + "%";
+    if (db.orderShards()) {
+        // Merged from the shards, same columns as the query below
+        RowCursor<CommandeRow> cursor = db.commandesCursor(nameLike, filter.statut, filter.fromDate, filter.toDate,
+                                                           "date_asc", 0, QVariantList(), filter.query);
+        if (!cursor.isActive()) {
+            Result result;
+            result.error = "Requête invalide: " + cursor.lastError().text();
+            return result;
+        }
+        CommandeRow row;
+        return writeRows(fileName, options,
+                         {"id_client", "nom", "prenom", "id_commande", "date_commande", "statut", "montant_total",
+                          "moyen_paiement", "remarque"},
+                         [&cursor, &row](QVariantList &values) {
+                             if (!cursor.next(row))
+                                 return false;
+                             values = {row.idClient, row.nom, row.prenom, row.idCommande, row.dateCommande,
+                                       row.statut, row.montantTotal, row.moyenPaiement, row.remarque};
+                             return true;
+                         },
+                         [&cursor]() { return cursor.lastError(); });
+    }
+    QSqlQuery query = db.searchCommandes(nameLike, filter.statut, filter.fromDate, filter.toDate, "date_asc", true, 0,
+                                         QVariantList(), filter.query);
+    return exportQuery(query, fileName, options);
+}
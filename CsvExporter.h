@@ -0,0 +1,64 @@
+#ifndef CSVEXPORTER_H
+#define CSVEXPORTER_H
+
+#include <QString>
+#include <QStringList>
+#include <QDate>
+#include <QSqlError>
+#include <QVariant>
+#include <functional>
+#include "OrderQuery.h"
+
+class DatabaseManager;
+class QSqlQuery;
+
+// Filters of the order search panel
+struct CommandeFilter
+{
+    QString clientName;   // start of the name, empty = all
+    QString statut;       // exact, empty = all
+    QDate fromDate;       // invalid = open
+    QDate toDate;         // invalid = open
+    OrderQuery query;     // search expression, ANDed with the fields above
+};
+
+// CSV/TSV export streamed from a forward-only cursor into a QSaveFile
+// through a fixed-size buffer, optionally gzip-compressed. Memory use does
+// not depend on the number of rows.
+class CsvExporter
+{
+public:
+    enum class Format { Csv, Tsv };
+
+    struct Options {
+        Format format = Format::Csv;
+        bool gzip = false;
+    };
+
+    struct Result {
+        bool ok = false;
+        qint64 rows = 0;
+        QString error;
+    };
+
+    // Format and compression deduced from the name: .csv, .tsv, optional .gz
+    static Options optionsForFile(const QString &fileName);
+    static bool gzipAvailable();
+
+    static Result exportClients(DatabaseManager &db, const QString &fileName, const Options &options);
+    static Result exportCommandes(DatabaseManager &db, const CommandeFilter &filter,
+                                  const QString &fileName, const Options &options);
+
+    // Writes every row of an executed query; headers default to the column names
+    static Result exportQuery(QSqlQuery &query, const QString &fileName, const Options &options,
+                              const QStringList &headers = QStringList());
+
+private:
+    // headers, then every row next() fills until it returns false; a valid
+    // readError() afterwards cancels the file
+    static Result writeRows(const QString &fileName, const Options &options, const QStringList &headers,
+                            const std::function<bool(QVariantList &)> &next,
+                            const std::function<QSqlError()> &readError);
+};
+
+#endif // CSVEXPORTER_H
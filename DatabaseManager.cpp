@@ -1,135 +1,1609 @@
 #include "DatabaseManager.h"
+#include "AppSettings.h"
+#include "LocalReplica.h"
+#include "OrderCodes.h"
+#include "OrderShards.h"
 #include <QDebug>
+#include <QSettings>
+#include <QElapsedTimer>
 
-DatabaseManager::DatabaseManager(QObject *parent) : QObject(parent)
+namespace {
+// commande and commande_archive, in the same order for INSERT ... SELECT and UNION ALL
+const char *ArchiveColumns = "id_commande, id_client, date_commande, statut, montant_total, moyen_paiement, remarque, updated_at";
+// Least time between two fills of the missing search keys by searchClients()
+const qint64 SearchKeysFillMs = 60 * 1000;
+}
+
+DatabaseConfig DatabaseConfig::load(const QString &group)
+{
+    DatabaseConfig config;
+    QSettings settings(AppSettings::filePath(), QSettings::IniFormat);
+    settings.beginGroup(group);
+    config.driver = settings.value("driver", config.driver).toString().toUpper();
+    config.host = settings.value("host", config.host).toString();
+    config.databaseName = settings.value("name", config.databaseName).toString();
+    config.userName = settings.value("user", config.userName).toString();
+    config.password = settings.value("password", config.password).toString();
+    config.odbcConnection = settings.value("odbc", config.odbcConnection).toString();
+    config.sqliteSynchronous = settings.value("sqlite_synchronous", config.sqliteSynchronous).toString();
+    config.sqliteCacheKb = settings.value("sqlite_cache_kb", config.sqliteCacheKb).toInt();
+    config.sqliteMmapBytes = settings.value("sqlite_mmap_bytes", config.sqliteMmapBytes).toLongLong();
+    config.sqliteBusyTimeoutMs = settings.value("sqlite_busy_timeout_ms", config.sqliteBusyTimeoutMs).toInt();
+    settings.endGroup();
+    return config;
+}
+
+ReadReplicaConfig ReadReplicaConfig::load(const QString &group)
+{
+    ReadReplicaConfig config;
+    config.database = DatabaseConfig::load(group);
+    QSettings settings(AppSettings::filePath(), QSettings::IniFormat);
+    settings.beginGroup(group);
+    config.enabled = settings.value("enabled", config.enabled).toBool();
+    config.stickySeconds = qMax(0, settings.value("sticky_s", config.stickySeconds).toInt());
+    settings.endGroup();
+    return config;
+}
+
+QSqlDatabase DatabaseManager::addConnection(const DatabaseConfig &config, const QString &connectionName)
+{
+    const QString driver = config.driver;
+    QSqlDatabase db = connectionName.isEmpty() ? QSqlDatabase::addDatabase(driver)
+                                               : QSqlDatabase::addDatabase(driver, connectionName);
+
+    if (driver == "QMYSQL") {
+        db.setHostName(config.host);
+        db.setDatabaseName(config.databaseName);
+        db.setUserName(config.userName);
+        db.setPassword(config.password);
+    } else if (driver == "QSQLITE") {
+        // Database file, created on first open
+        db.setDatabaseName(config.databaseName);
+        db.setConnectOptions(QString("QSQLITE_BUSY_TIMEOUT=%1").arg(config.sqliteBusyTimeoutMs));
+    } else {
+        // ODBC connection string - adjust based on your MySQL ODBC driver
+        QString conn = config.odbcConnection;
+        if (conn.isEmpty()) {
+            conn = QString("DRIVER={MySQL ODBC 8.0 Unicode Driver};SERVER=%1;DATABASE=%2;USER=%3;PASSWORD=%4;OPTION=3;")
+                       .arg(config.host, config.databaseName, config.userName, config.password);
+        }
+        db.setDatabaseName(conn);
+    }
+    return db;
+}
+
+QAtomicInteger<qint64> DatabaseManager::s_lastWriteMs = -1;
+
+DatabaseManager::DatabaseManager(QObject *parent)
+    : DatabaseManager(DatabaseConfig::load(), parent)
+{
+}
+
+DatabaseManager::DatabaseManager(const DatabaseConfig &config, QObject *parent)
+    : QObject(parent), m_config(config)
+{
+    // QODBC by default since the QMYSQL driver is not always available
+    m_driver = config.driver;
+    m_db = addConnection(config, config.connectionName);
+}
+
+DatabaseManager::~DatabaseManager()
+{
+    delete m_shards;
+    m_shards = nullptr;
+    if (m_replica) {
+        delete m_replica;
+        m_replica = nullptr;
+    }
+    if (m_replicaDb.isValid()) {
+        const QString replicaConnection = m_replicaDb.connectionName();
+        m_replicaDb.close();
+        m_replicaDb = QSqlDatabase();
+        QSqlDatabase::removeDatabase(replicaConnection);
+    }
+    if (m_readReplicaDb.isValid()) {
+        const QString readConnection = m_readReplicaDb.connectionName();
+        m_readReplicaDb.close();
+        m_readReplicaDb = QSqlDatabase();
+        QSqlDatabase::removeDatabase(readConnection);
+    }
+
+    close();
+
+    // Named connections belong to this instance only
+    if (!m_config.connectionName.isEmpty()) {
+        m_db = QSqlDatabase();
+        QSqlDatabase::removeDatabase(m_config.connectionName);
+    }
+}
+
+bool DatabaseManager::open()
+{
+    if (!m_db.open()) {
+        qCritical() << "DB open error:" << m_db.lastError().text();
+        return false;
+    }
+    qDebug() << "DB opened. Drivers available:" << QSqlDatabase::drivers();
+
+    if (isSqlite())
+        applySqlitePragmas();
+
+    if (m_config.manageSchema && !ensureSchema()) {
+        qCritical() << "DB schema setup failed";
+        return false;
+    }
+    return true;
+}
+
+void DatabaseManager::close()
+{
+    if (m_db.isOpen()) {
+        m_db.close();
+    }
+}
+
+// ---- SCHEMA ----
+void DatabaseManager::applySqlitePragmas()
+{
+    // WAL lets readers run alongside the single writer; NORMAL sync is durable
+    // across application crashes, only a power loss may drop the last commits.
+    const QStringList pragmas = {
+        "PRAGMA journal_mode = WAL",
+        QString("PRAGMA synchronous = %1").arg(m_config.sqliteSynchronous),
+        QString("PRAGMA cache_size = -%1").arg(m_config.sqliteCacheKb), // negative = KiB
+        QString("PRAGMA mmap_size = %1").arg(m_config.sqliteMmapBytes),
+        "PRAGMA temp_store = MEMORY",
+        "PRAGMA foreign_keys = ON"
+    };
+
+    QSqlQuery q(m_db);
+    for (const QString &pragma : pragmas) {
+        if (!q.exec(pragma))
+            qWarning() << "SQLite pragma failed:" << pragma << q.lastError().text();
+    }
+}
+
+bool DatabaseManager::ensureSchema()
+{
+    QStringList ddl;
+    if (isSqlite()) {
+        ddl << "CREATE TABLE IF NOT EXISTS client ("
+               " id_client INTEGER PRIMARY KEY AUTOINCREMENT,"
+               " nom TEXT NOT NULL,"
+               " prenom TEXT NOT NULL,"
+               " email TEXT NOT NULL,"
+               " telephone TEXT,"
+               " adresse TEXT)"
+            << "CREATE TABLE IF NOT EXISTS commande ("
+               " id_commande INTEGER PRIMARY KEY AUTOINCREMENT,"
+               " id_client INTEGER NOT NULL REFERENCES client(id_client) ON DELETE CASCADE,"
+               " date_commande TEXT NOT NULL,"
+               " statut TEXT NOT NULL DEFAULT 'EN_COURS',"
+               " montant_total REAL NOT NULL DEFAULT 0,"
+               " moyen_paiement TEXT,"
+               " remarque TEXT)";
+    } else {
+        ddl << "CREATE TABLE IF NOT EXISTS client ("
+               " id_client INT AUTO_INCREMENT PRIMARY KEY,"
+               " nom VARCHAR(100) NOT NULL,"
+               " prenom VARCHAR(100) NOT NULL,"
+               " email VARCHAR(150) NOT NULL,"
+               " telephone VARCHAR(30),"
+               " adresse TEXT)"
+            << "CREATE TABLE IF NOT EXISTS commande ("
+               " id_commande INT AUTO_INCREMENT PRIMARY KEY,"
+               " id_client INT NOT NULL,"
+               " date_commande DATETIME NOT NULL,"
+               " statut VARCHAR(20) NOT NULL DEFAULT 'EN_COURS',"
+               " montant_total DECIMAL(12,2) NOT NULL DEFAULT 0,"
+               " moyen_paiement VARCHAR(50),"
+               " remarque TEXT,"
+               " FOREIGN KEY (id_client) REFERENCES client(id_client) ON DELETE CASCADE)";
+    }
+
+    QSqlQuery q(m_db);
+    for (const QString &statement : ddl) {
+        if (!q.exec(statement)) {
+            qWarning() << "ensureSchema failed:" << q.lastError().text();
+            return false;
+        }
+    }
+
+    // Same indexes on every backend
+    return ensureIndex("client", "idx_client_nom", "nom, prenom")
+        && ensureIndex("client", "idx_client_email", "email")
+        && ensureIndex("commande", "idx_commande_client_date", "id_client, date_commande")
+        && ensureIndex("commande", "idx_commande_date", "date_commande")
+        && ensureIndex("commande", "idx_commande_statut_date", "statut, date_commande")
+        && ensureChangeTracking()
+        && ensureArchive()
+        && ensureClientCounters()
+        && ensureSearchKeys()
+        && migrateOnce(m_db, "order_codes", [this]() {
+               return normalizeOrderCodes(m_db, "commande") && normalizeOrderCodes(m_db, "commande_archive");
+           });
+}
+
+// Cold storage for the orders older than the archive horizon (see
+// OrderArchive.h). Same columns as commande, keys copied, no triggers:
+// archived rows are never written again.
+bool DatabaseManager::ensureArchive()
+{
+    QSqlQuery q(m_db);
+    const QString ddl = isSqlite()
+        ? "CREATE TABLE IF NOT EXISTS commande_archive ("
+          " id_commande INTEGER PRIMARY KEY,"
+          " id_client INTEGER NOT NULL REFERENCES client(id_client) ON DELETE CASCADE,"
+          " date_commande TEXT NOT NULL,"
+          " statut TEXT NOT NULL,"
+          " montant_total REAL NOT NULL DEFAULT 0,"
+          " moyen_paiement TEXT,"
+          " remarque TEXT,"
+          " updated_at TEXT)"
+        : "CREATE TABLE IF NOT EXISTS commande_archive ("
+          " id_commande INT PRIMARY KEY,"
+          " id_client INT NOT NULL,"
+          " date_commande DATETIME NOT NULL,"
+          " statut VARCHAR(20) NOT NULL,"
+          " montant_total DECIMAL(12,2) NOT NULL DEFAULT 0,"
+          " moyen_paiement VARCHAR(50),"
+          " remarque TEXT,"
+          " updated_at DATETIME(3) NULL,"
+          " FOREIGN KEY (id_client) REFERENCES client(id_client) ON DELETE CASCADE)";
+    if (!q.exec(ddl)) {
+        qWarning() << "ensureArchive failed:" << q.lastError().text();
+        return false;
+    }
+    return ensureIndex("commande_archive", "idx_archive_date", "date_commande")
+        && ensureIndex("commande_archive", "idx_archive_client_date", "id_client, date_commande");
+}
+
+// Order count, revenue and last order date stored on client, so listing
+// clients does not join and group every order
+bool DatabaseManager::ensureClientCounters()
+{
+    const bool existed = m_db.record("client").contains("nb_commandes");
+    const bool added = isSqlite()
+        ? ensureColumn("client", "nb_commandes", "INTEGER NOT NULL DEFAULT 0")
+              && ensureColumn("client", "total_montant", "REAL NOT NULL DEFAULT 0")
+              && ensureColumn("client", "last_order_at", "TEXT")
+        : ensureColumn("client", "nb_commandes", "INT NOT NULL DEFAULT 0")
+              && ensureColumn("client", "total_montant", "DECIMAL(14,2) NOT NULL DEFAULT 0")
+              && ensureColumn("client", "last_order_at", "DATETIME NULL");
+    if (!added)
+        return false;
+
+    // Existing database: fill the new columns once
+    if (!existed && !rebuildClientCounters())
+        return false;
+    return ensureIndex("client", "idx_client_nb_commandes", "nb_commandes");
+}
+
+// Normalized copies of nom, prenom and email, written with the row by
+// EntitySql (EntityTraits<Client>::derived). They are already folded, so
+// NOCASE only lets SQLite use the indexes for LIKE prefixes.
+bool DatabaseManager::ensureSearchKeys()
+{
+    const QString definition = isSqlite() ? "TEXT COLLATE NOCASE" : "VARCHAR(150)";
+    return ensureColumn("client", "nom_key", definition)
+        && ensureColumn("client", "prenom_key", definition)
+        && ensureColumn("client", "email_key", definition)
+        && ensureIndex("client", "idx_client_nom_key", "nom_key")
+        && ensureIndex("client", "idx_client_prenom_key", "prenom_key")
+        && ensureIndex("client", "idx_client_email_key", "email_key")
+        && fillSearchKeys();
+}
+
+// updated_at on both tables and a deleted_row tombstone log, so replicas
+// can pull deltas instead of whole tables
+bool DatabaseManager::ensureChangeTracking()
+{
+    QSqlQuery q(m_db);
+    if (isSqlite()) {
+        // SQLite cannot add a column with a non-constant default; triggers stamp it instead
+        if (!ensureColumn("client", "updated_at", "TEXT")
+            || !ensureColumn("commande", "updated_at", "TEXT"))
+            return false;
+
+        const QString now = nowExpression(m_db);
+        const QStringList ddl = {
+            QString("UPDATE client SET updated_at = %1 WHERE updated_at IS NULL").arg(now),
+            QString("UPDATE commande SET updated_at = %1 WHERE updated_at IS NULL").arg(now),
+            QString("CREATE TRIGGER IF NOT EXISTS trg_client_inserted AFTER INSERT ON client "
+                    "FOR EACH ROW WHEN NEW.updated_at IS NULL BEGIN "
+                    "UPDATE client SET updated_at = %1 WHERE id_client = NEW.id_client; END").arg(now),
+            QString("CREATE TRIGGER IF NOT EXISTS trg_client_updated AFTER UPDATE ON client "
+                    "FOR EACH ROW WHEN NEW.updated_at IS OLD.updated_at BEGIN "
+                    "UPDATE client SET updated_at = %1 WHERE id_client = NEW.id_client; END").arg(now),
+            QString("CREATE TRIGGER IF NOT EXISTS trg_commande_inserted AFTER INSERT ON commande "
+                    "FOR EACH ROW WHEN NEW.updated_at IS NULL BEGIN "
+                    "UPDATE commande SET updated_at = %1 WHERE id_commande = NEW.id_commande; END").arg(now),
+            QString("CREATE TRIGGER IF NOT EXISTS trg_commande_updated AFTER UPDATE ON commande "
+                    "FOR EACH ROW WHEN NEW.updated_at IS OLD.updated_at BEGIN "
+                    "UPDATE commande SET updated_at = %1 WHERE id_commande = NEW.id_commande; END").arg(now),
+            QString("CREATE TABLE IF NOT EXISTS deleted_row ("
+                    " id INTEGER PRIMARY KEY AUTOINCREMENT,"
+                    " table_name TEXT NOT NULL,"
+                    " row_id INTEGER NOT NULL,"
+                    " deleted_at TEXT NOT NULL DEFAULT (%1))").arg(now)
+        };
+        for (const QString &statement : ddl) {
+            if (!q.exec(statement)) {
+                qWarning() << "ensureChangeTracking failed:" << q.lastError().text();
+                return false;
+            }
+        }
+    } else {
+        // MySQL maintains the timestamp itself, including for writes from other tools
+        const QString definition = "DATETIME(3) NOT NULL DEFAULT CURRENT_TIMESTAMP(3) ON UPDATE CURRENT_TIMESTAMP(3)";
+        if (!ensureColumn("client", "updated_at", definition)
+            || !ensureColumn("commande", "updated_at", definition))
+            return false;
+
+        if (!q.exec("CREATE TABLE IF NOT EXISTS deleted_row ("
+                    " id BIGINT AUTO_INCREMENT PRIMARY KEY,"
+                    " table_name VARCHAR(32) NOT NULL,"
+                    " row_id INT NOT NULL,"
+                    " deleted_at DATETIME(3) NOT NULL DEFAULT CURRENT_TIMESTAMP(3))")) {
+            qWarning() << "ensureChangeTracking failed:" << q.lastError().text();
+            return false;
+        }
+    }
+
+    return ensureIndex("client", "idx_client_updated", "updated_at, id_client")
+        && ensureIndex("commande", "idx_commande_updated", "updated_at, id_commande");
+}
+
+bool DatabaseManager::ensureColumn(const QString &table, const QString &column, const QString &definition)
+{
+    if (m_db.record(table).contains(column))
+        return true;
+
+    QSqlQuery q(m_db);
+    if (!q.exec(QString("ALTER TABLE %1 ADD COLUMN %2 %3").arg(table, column, definition))) {
+        qWarning() << "ensureColumn failed:" << table << column << q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+QString DatabaseManager::monthIndexExpression(const QSqlDatabase &db, const QString &column)
+{
+    const QString driver = db.driverName();
+    if (driver == "QMYSQL" || driver == "QODBC")
+        return QString("(YEAR(%1) * 12 + MONTH(%1) - 1)").arg(column);
+    if (driver == "QSQLITE")
+        return QString("(CAST(strftime('%Y', %1) AS INTEGER) * 12 + CAST(strftime('%m', %1) AS INTEGER) - 1)").arg(column);
+    return QString("(EXTRACT(YEAR FROM %1) * 12 + EXTRACT(MONTH FROM %1) - 1)").arg(column);
+}
+
+QStringList DatabaseManager::explainQuery(const QSqlDatabase &db, const QString &sql, const QVariantList &binds)
+{
+    const bool sqlite = db.driverName() == "QSQLITE";
+    QSqlQuery q(db);
+    q.setForwardOnly(true);
+    q.prepare((sqlite ? "EXPLAIN QUERY PLAN " : "EXPLAIN ") + sql);
+    // Same text as the original query, so positions map to the same placeholders
+    for (int i = 0; i < binds.size(); ++i)
+        q.bindValue(i, binds.at(i));
+    if (!q.exec()) {
+        qWarning() << "explainQuery failed:" << q.lastError().text();
+        return {};
+    }
+
+    QStringList plan;
+    while (q.next()) {
+        const QSqlRecord record = q.record();
+        if (sqlite) {
+            plan << q.value(record.indexOf("detail")).toString();
+            continue;
+        }
+        QStringList fields;
+        for (int i = 0; i < record.count(); ++i) {
+            if (!q.value(i).isNull())
+                fields << record.fieldName(i) + "=" + q.value(i).toString();
+        }
+        plan << fields.join(" ");
+    }
+    return plan;
+}
+
+QStringList DatabaseManager::fullScans(const QStringList &plan)
+{
+    // SQLite: "SCAN t" without "USING ... INDEX"; MySQL: access type ALL
+    static const QRegularExpression sqliteScan("^SCAN (\\w+)$");
+    static const QRegularExpression mysqlTable("\\btable=(\\S+)");
+    QStringList tables;
+    for (const QString &step : plan) {
+        const QRegularExpressionMatch scan = sqliteScan.match(step.trimmed());
+        if (scan.hasMatch()) {
+            tables << scan.captured(1);
+        } else if (step.contains(" type=ALL")) {
+            tables << mysqlTable.match(step).captured(1);
+        }
+    }
+    return tables;
+}
+
+void DatabaseManager::capturePlan(const QString &name, const QSqlDatabase &db, const QSqlQuery &query)
+{
+    if (!m_capturePlans)
+        return;
+    const QStringList plan = explainQuery(db, query.lastQuery(), query.boundValues());
+    m_plans.insert(name, plan);
+}
+
+QString DatabaseManager::nowExpression(const QSqlDatabase &db)
+{
+    if (db.driverName() == "QSQLITE")
+        return "strftime('%Y-%m-%dT%H:%M:%f', 'now')";
+    return "CURRENT_TIMESTAMP(3)";
+}
+
+// ---- LOCAL REPLICA ----
+bool DatabaseManager::attachLocalReplica(const ReplicaConfig &replicaConfig)
+{
+    if (m_replica || !replicaConfig.enabled)
+        return false;
+
+    // GUI-thread connection on the replica file, used for reads and to apply our own writes
+    DatabaseConfig localConfig = LocalReplica::localDatabaseConfig(replicaConfig, "local_replica_read");
+    m_replicaDb = QSqlDatabase::addDatabase("QSQLITE", localConfig.connectionName);
+    m_replicaDb.setDatabaseName(localConfig.databaseName);
+    m_replicaDb.setConnectOptions(QString("QSQLITE_BUSY_TIMEOUT=%1").arg(localConfig.sqliteBusyTimeoutMs));
+    if (!m_replicaDb.open()) {
+        qWarning() << "Local replica open failed:" << m_replicaDb.lastError().text();
+        return false;
+    }
+
+    m_replica = new LocalReplica(m_config, replicaConfig, this);
+    m_replica->start();
+    return true;
+}
+
+bool DatabaseManager::shareLocalReplica(const ReplicaConfig &replicaConfig, const LocalReplica *replica)
+{
+    if (m_replica || m_sharedReplica || !replica)
+        return false;
+
+    DatabaseConfig localConfig =
+        LocalReplica::localDatabaseConfig(replicaConfig, m_config.connectionName + "_replica_read");
+    m_replicaDb = QSqlDatabase::addDatabase("QSQLITE", localConfig.connectionName);
+    m_replicaDb.setDatabaseName(localConfig.databaseName);
+    m_replicaDb.setConnectOptions(QString("QSQLITE_BUSY_TIMEOUT=%1").arg(localConfig.sqliteBusyTimeoutMs));
+    if (!m_replicaDb.open()) {
+        qWarning() << "Local replica open failed:" << m_replicaDb.lastError().text();
+        return false;
+    }
+    m_sharedReplica = replica;
+    return true;
+}
+
+bool DatabaseManager::attachReadReplica(const ReadReplicaConfig &replicaConfig)
+{
+    if (m_readReplicaDb.isValid() || !replicaConfig.enabled)
+        return false;
+
+    const QString name = (m_config.connectionName.isEmpty() ? QString("default") : m_config.connectionName)
+                         + "_read_replica";
+    m_readReplicaDb = addConnection(replicaConfig.database, name);
+    if (replicaConfig.database.driver == "QSQLITE")
+        m_readReplicaDb.setConnectOptions(QString("QSQLITE_BUSY_TIMEOUT=%1;QSQLITE_OPEN_READONLY")
+                                              .arg(replicaConfig.database.sqliteBusyTimeoutMs));
+    if (!m_readReplicaDb.open()) {
+        qWarning() << "Read replica open failed, reads stay on the primary:" << m_readReplicaDb.lastError().text();
+        return false;
+    }
+    m_stickyMs = qint64(replicaConfig.stickySeconds) * 1000;
+    return true;
+}
+
+qint64 DatabaseManager::sessionMs()
+{
+    static const QElapsedTimer clock = []() {
+        QElapsedTimer timer;
+        timer.start();
+        return timer;
+    }();
+    return clock.elapsed();
+}
+
+void DatabaseManager::wrote(const QList<int> &clientIds)
+{
+    s_lastWriteMs.storeRelease(sessionMs());
+    emit clientsChanged(clientIds);
+}
+
+// Read-your-own-writes: the replica may not have replayed a recent commit
+QSqlDatabase DatabaseManager::serverReadDb() const
+{
+    if (!m_readReplicaDb.isOpen())
+        return m_db;
+    const qint64 lastWrite = s_lastWriteMs.loadAcquire();
+    if (lastWrite >= 0 && sessionMs() - lastWrite < m_stickyMs)
+        return m_db;
+    return m_readReplicaDb;
+}
+
+// The local replica applies our own writes at once, so it needs no stickiness
+QSqlDatabase DatabaseManager::readDb() const
+{
+    if (m_replica && m_replica->isReady())
+        return m_replicaDb;
+    if (m_sharedReplica && m_sharedReplica->isReady() && m_replicaDb.isOpen())
+        return m_replicaDb;
+    return serverReadDb();
+}
+
+// ---- Order shards ----
+bool DatabaseManager::attachShards(const ShardConfig &shardConfig, QString *error)
+{
+    if (m_shards || !shardConfig.enabled)
+        return false;
+    auto fail = [error](const QString &message) {
+        qWarning() << "Order shards:" << message;
+        if (error)
+            *error = message;
+        return false;
+    };
+
+    const QStringList conflicts = ShardConfig::conflicts();
+    if (!conflicts.isEmpty())
+        return fail("partitions de commandes incompatibles avec [" + conflicts.join("], [") + "]");
+
+    // Orders are not moved to the shards: any left on the primary would
+    // vanish from the lists and the counters
+    QSqlQuery q(m_db);
+    if (!q.exec("SELECT 1 FROM commande UNION ALL SELECT 1 FROM commande_archive LIMIT 1"))
+        return fail("lecture des commandes de la base principale impossible: " + q.lastError().text());
+    if (q.next())
+        return fail("la base principale contient encore des commandes, non migrées vers les partitions");
+
+    const QString owner = m_config.connectionName.isEmpty() ? QString("default") : m_config.connectionName;
+    OrderShards *shards = new OrderShards(shardConfig, owner);
+    if (!shards->open()) {
+        delete shards;
+        return fail("ouverture des partitions de commandes impossible");
+    }
+    m_shards = shards;
+    return true;
+}
+
+// One grouped scan per shard, restricted to the shard's clients when ids are
+// given; a client's orders are all on one shard, so the parts do not overlap
+QHash<int, DatabaseManager::ClientTotals> DatabaseManager::shardClientTotals(const QList<int> &clientIds, bool *ok)
+{
+    const QHash<int, QList<int>> owned = m_shards->byClient(clientIds);
+    const QList<int> shards = clientIds.isEmpty() ? m_shards->allShards() : owned.keys();
+    QVector<QHash<int, ClientTotals>> parts(m_shards->count());
+    QVector<char> read(m_shards->count(), false);
+    m_shards->scatter(shards, [&owned, &parts, &read](int shard, QSqlDatabase db) {
+        const QList<int> ids = owned.value(shard);
+        QList<QList<int>> chunks;
+        for (int start = 0; start < ids.size(); start += BulkChunkSize)
+            chunks << ids.mid(start, BulkChunkSize);
+        if (chunks.isEmpty())
+            chunks << QList<int>();
+
+        for (const QList<int> &chunk : std::as_const(chunks)) {
+            QSqlQuery q(db);
+            q.setForwardOnly(true);
+            q.prepare(QString("SELECT id_client, COUNT(*), SUM(montant_total), MIN(date_commande), MAX(date_commande) "
+                              "FROM commande%1 GROUP BY id_client")
+                          .arg(chunk.isEmpty() ? QString()
+                                               : " WHERE id_client IN (" + QStringList(chunk.size(), "?").join(", ") + ")"));
+            for (int id : chunk)
+                q.addBindValue(id);
+            if (!q.exec()) {
+                qWarning() << "shardClientTotals failed on shard" << shard << q.lastError().text();
+                return;
+            }
+            while (q.next())
+                parts[shard].insert(q.value(0).toInt(),
+                                    ClientTotals{q.value(1).toInt(), q.value(2).toDouble(), q.value(3), q.value(4)});
+        }
+        read[shard] = true;
+    });
+
+    QHash<int, ClientTotals> totals;
+    bool success = true;
+    for (int shard : shards) {
+        success = success && read.at(shard);
+        totals.insert(parts.at(shard));
+    }
+    if (ok)
+        *ok = success;
+    return totals;
+}
+
+bool DatabaseManager::refreshShardedCounters(const QList<int> &clientIds)
+{
+    bool read = false;
+    const QHash<int, ClientTotals> totals = shardClientTotals(clientIds, &read);
+    if (!read)
+        return false;
+
+    QList<int> ids = clientIds;
+    if (ids.isEmpty()) {
+        // Every client: the ones without orders are reset in one statement
+        QSqlQuery reset(m_db);
+        if (!reset.exec("UPDATE client SET nb_commandes = 0, total_montant = 0, last_order_at = NULL")) {
+            qWarning() << "refreshShardedCounters failed:" << reset.lastError().text();
+            return false;
+        }
+        ids = totals.keys();
+    }
+
+    QSqlQuery update(m_db);
+    update.prepare("UPDATE client SET nb_commandes = ?, total_montant = ?, last_order_at = ? WHERE id_client = ?");
+    for (int id : std::as_const(ids)) {
+        const ClientTotals clientTotals = totals.value(id);
+        update.addBindValue(clientTotals.count);
+        update.addBindValue(clientTotals.total);
+        update.addBindValue(clientTotals.lastOrder);
+        update.addBindValue(id);
+        if (!update.exec()) {
+            qWarning() << "refreshShardedCounters failed:" << update.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+// The orders are committed by now: a failure here only leaves the counters
+// behind, checkClientCounters() finds them
+void DatabaseManager::syncShardedCounters(const QList<int> &clientIds)
+{
+    m_db.transaction();
+    if (!refreshShardedCounters(clientIds) || !m_db.commit()) {
+        qWarning() << "Client counters not refreshed after an order write:" << m_db.lastError().text();
+        m_db.rollback();
+    }
+}
+
+QList<int> DatabaseManager::shardedClientIdsOfCommandes(const QList<int> &commandeIds)
+{
+    const QHash<int, QList<int>> owned = m_shards->byCommande(commandeIds);
+    QVector<QList<int>> parts(m_shards->count());
+    m_shards->scatter(owned.keys(), [&owned, &parts](int shard, QSqlDatabase db) {
+        const QList<int> ids = owned.value(shard);
+        for (int start = 0; start < ids.size(); start += BulkChunkSize) {
+            const QList<int> chunk = ids.mid(start, BulkChunkSize);
+            QSqlQuery q(db);
+            q.setForwardOnly(true);
+            q.prepare("SELECT DISTINCT id_client FROM commande WHERE id_commande IN ("
+                      + QStringList(chunk.size(), "?").join(", ") + ")");
+            for (int id : chunk)
+                q.addBindValue(id);
+            if (!q.exec()) {
+                qWarning() << "clientIdsOfCommandes failed on shard" << shard << q.lastError().text();
+                continue;
+            }
+            while (q.next())
+                parts[shard] << q.value(0).toInt();
+        }
+    });
+
+    QList<int> clientIds;
+    for (const QList<int> &part : std::as_const(parts)) {
+        for (int clientId : part) {
+            if (!clientIds.contains(clientId))
+                clientIds << clientId;
+        }
+    }
+    return clientIds;
+}
+
+// In the thread of shard, inside its transaction
+bool DatabaseManager::insertShardCommande(OrderShards *shards, int shard, QSqlDatabase db, Commande &commande)
+{
+    commande.idCommande = shards->nextCommandeId(shard, db);
+    if (commande.idCommande < 0)
+        return false;
+
+    QSqlQuery q(db);
+    q.prepare(EntitySql::insertWithKey<Commande>());
+    EntitySql::bindKey(q, commande);
+    EntitySql::bindFields(q, commande);
+    if (!q.exec()) {
+        qWarning() << "addCommande failed on shard" << shard << q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::saveShardCommandes(QList<Commande> &commandes, QList<int> &clientIds)
+{
+    OrderShards *shards = m_shards;
+    QHash<int, QList<int>> positions; // shard -> indexes in commandes
+    for (int i = 0; i < commandes.size(); ++i) {
+        const Commande &commande = commandes.at(i);
+        const qint64 key = commande.idCommande < 0 ? commande.idClient : commande.idCommande;
+        if (key < 0) {
+            qWarning() << "saveCommande: order without client";
+            return false;
+        }
+        positions[commande.idCommande < 0 ? shards->shardOfClient(key) : shards->shardOfCommande(key)] << i;
+    }
+
+    // Written from the shard threads: detached here, not there
+    QList<Commande> saved = commandes;
+    saved.detach();
+    QVector<QList<int>> owners(shards->count());
+    const bool ok = shards->transact(positions.keys(), [shards, &positions, &saved, &owners](int shard, QSqlDatabase db) {
+        for (int i : positions.value(shard)) {
+            Commande &commande = saved[i];
+            if (commande.idCommande < 0) {
+                if (!insertShardCommande(shards, shard, db, commande))
+                    return false;
+                owners[shard] << int(commande.idClient);
+                continue;
+            }
+
+            // id_client is not updatable: an update counts for the stored client
+            QSqlQuery q(db);
+            q.prepare("SELECT id_client FROM commande WHERE id_commande = ?");
+            q.addBindValue(commande.idCommande);
+            if (!q.exec() || !q.next()) {
+                qWarning() << "updateCommande: order" << commande.idCommande << "not found on shard" << shard
+                           << q.lastError().text();
+                return false;
+            }
+            owners[shard] << q.value(0).toInt();
+            q.prepare(EntitySql::update<Commande>());
+            EntitySql::bindFields(q, commande, true);
+            EntitySql::bindKey(q, commande);
+            if (!q.exec()) {
+                qWarning() << "updateCommande failed on shard" << shard << q.lastError().text();
+                return false;
+            }
+        }
+        return true;
+    });
+    if (!ok)
+        return false;
+
+    commandes = saved;
+    for (const QList<int> &part : std::as_const(owners)) {
+        for (int clientId : part) {
+            if (!clientIds.contains(clientId))
+                clientIds << clientId;
+        }
+    }
+    return true;
+}
+
+void DatabaseManager::deleteShardOrders(const QList<int> &clientIds)
+{
+    const QHash<int, QList<int>> owned = m_shards->byClient(clientIds);
+    const bool ok = m_shards->transact(owned.keys(), [&owned](int shard, QSqlDatabase db) {
+        return execForIds(db, "DELETE FROM commande WHERE id_client IN (%1)", {}, owned.value(shard));
+    });
+    if (!ok)
+        qWarning() << "Orders of the deleted clients left on the shards:" << clientIds;
+}
+
+// Each shard sorts and limits its part, then a k-way merge keeps the first
+// limit rows. A name filter is resolved to client ids on the primary first,
+// so only the shards of those clients are searched, with one query per
+// BulkChunkSize ids. When too many clients match, every shard is read and
+// its rows are filtered on the ids as they stream in.
+RowCursor<CommandeRow> DatabaseManager::shardedCommandes(const QString &clientNameLike, const QString &statut,
+                                                         const QDate &fromDate, const QDate &toDate,
+                                                         const QString &orderBy, int limit, const QVariantList &after,
+                                                         const OrderQuery &query)
+{
+    QStringList conditions;
+    QVariantList binds;
+    if (!statut.isEmpty()) {
+        conditions << "co.statut = ?";
+        binds << statut;
+    }
+    if (fromDate.isValid()) {
+        conditions << "co.date_commande >= ?";
+        binds << QDateTime(fromDate, QTime(0, 0));
+    }
+    if (toDate.isValid()) {
+        conditions << "co.date_commande <= ?";
+        binds << QDateTime(toDate, QTime(23, 59, 59));
+    }
+    if (orderBy == "date_desc" && after.size() == 2) {
+        conditions << "co.date_commande <= ? AND (co.date_commande < ? OR co.id_commande < ?)";
+        binds << after.at(0) << after.at(0) << after.at(1);
+    }
+    conditions += query.orderConditions(binds);
+
+    // The client conditions run on the primary's client table, the shards
+    // then only read the orders of the clients found
+    QStringList clientConditions;
+    QVariantList clientBinds;
+    if (!clientNameLike.isEmpty()) {
+        clientConditions << "nom_key LIKE ?";
+        clientBinds << SearchKey::normalize(clientNameLike);
+    }
+    clientConditions += query.clientConditions(clientBinds);
+
+    const int maxPrunedClients = 10 * BulkChunkSize;
+    QList<int> shards = m_shards->allShards();
+    QHash<int, QList<int>> clients;
+    QSet<int> clientFilter;
+    bool filterRows = false;
+    if (!clientConditions.isEmpty()) {
+        QSqlQuery q(readDb());
+        q.setForwardOnly(true);
+        q.prepare("SELECT id_client FROM client WHERE " + clientConditions.join(" AND "));
+        for (const QVariant &value : std::as_const(clientBinds))
+            q.addBindValue(value);
+        if (!q.exec()) {
+            qWarning() << "searchCommandes failed:" << q.lastError().text();
+            return RowCursor<CommandeRow>(QVector<CommandeRow>(), q.lastError());
+        }
+        QList<int> ids;
+        while (q.next())
+            ids << q.value(0).toInt();
+        if (ids.size() <= maxPrunedClients) {
+            clients = m_shards->byClient(ids);
+            shards = clients.keys();
+        } else {
+            clientFilter = QSet<int>(ids.cbegin(), ids.cend());
+            filterRows = true;
+        }
+    }
+
+    // Same order as the merge below, ties broken by id on every shard
+    const bool byAmount = orderBy == "montant_desc";
+    const bool descending = orderBy == "date_desc";
+    const bool byClient = orderBy == "client_date";
+    QString order;
+    if (descending) order = " ORDER BY co.date_commande DESC, co.id_commande DESC";
+    else if (byAmount) order = " ORDER BY co.montant_total DESC, co.id_commande DESC";
+    else if (byClient) order = " ORDER BY co.id_client, co.date_commande, co.id_commande";
+    else order = " ORDER BY co.date_commande ASC, co.id_commande ASC";
+    auto before = [byAmount, descending, byClient](const CommandeRow &a, const CommandeRow &b) {
+        if (byAmount)
+            return a.montantTotal != b.montantTotal ? a.montantTotal > b.montantTotal : a.idCommande > b.idCommande;
+        if (byClient && a.idClient != b.idClient)
+            return a.idClient < b.idClient;
+        if (a.dateCommande != b.dateCommande)
+            return descending ? a.dateCommande > b.dateCommande : a.dateCommande < b.dateCommande;
+        return descending ? a.idCommande > b.idCommande : a.idCommande < b.idCommande;
+    };
+
+    QVector<QVector<CommandeRow>> parts(m_shards->count());
+    QVector<QSqlError> errors(m_shards->count());
+    m_shards->scatter(shards, [&](int shard, QSqlDatabase db) {
+        // One sorted query, at most limit rows kept
+        auto read = [&](const QString &idList, const QVariantList &ids, QVector<CommandeRow> &rows) {
+            QStringList where = conditions;
+            QVariantList values = ids + binds;
+            if (!idList.isEmpty())
+                where.prepend(idList);
+            QString sql = "SELECT co.id_commande, co.id_client, co.date_commande, co.statut, co.montant_total, "
+                          "co.moyen_paiement, co.remarque FROM commande co";
+            if (!where.isEmpty())
+                sql += " WHERE " + where.join(" AND ");
+            sql += order;
+            if (limit > 0 && !filterRows)
+                sql += QString(" LIMIT %1").arg(limit);
+
+            QSqlQuery q(db);
+            q.setForwardOnly(true);
+            q.prepare(sql);
+            for (const QVariant &value : std::as_const(values))
+                q.addBindValue(value);
+            if (!q.exec()) {
+                errors[shard] = q.lastError();
+                return false;
+            }
+            RowCursor<CommandeRow> cursor(q);
+            CommandeRow row;
+            while ((limit <= 0 || rows.size() < limit) && cursor.next(row)) {
+                if (!filterRows || clientFilter.contains(row.idClient))
+                    rows << row;
+            }
+            return true;
+        };
+
+        const QList<int> ids = clients.value(shard);
+        if (ids.isEmpty()) {
+            read(QString(), QVariantList(), parts[shard]);
+            return;
+        }
+        QVector<QVector<CommandeRow>> chunks;
+        for (int start = 0; start < ids.size(); start += BulkChunkSize) {
+            const QList<int> chunk = ids.mid(start, BulkChunkSize);
+            QVariantList values;
+            for (int id : chunk)
+                values << id;
+            chunks << QVector<CommandeRow>();
+            if (!read("co.id_client IN (" + QStringList(chunk.size(), "?").join(", ") + ")", values, chunks.last()))
+                return;
+        }
+        parts[shard] = mergeSorted(chunks, before, limit);
+    });
+
+    for (int shard : std::as_const(shards)) {
+        if (errors.at(shard).isValid()) {
+            qWarning() << "searchCommandes failed on shard" << shard << errors.at(shard).text();
+            return RowCursor<CommandeRow>(QVector<CommandeRow>(), errors.at(shard));
+        }
+    }
+    QVector<CommandeRow> rows = mergeSorted(parts, before, limit);
+    readClientNames(rows);
+    return RowCursor<CommandeRow>(rows);
+}
+
+RowCursor<CommandeRow> DatabaseManager::shardedCommandesByIds(const QList<int> &ids)
+{
+    const QHash<int, QList<int>> owned = m_shards->byCommande(ids);
+    QVector<QVector<CommandeRow>> parts(m_shards->count());
+    QVector<QSqlError> errors(m_shards->count());
+    m_shards->scatter(owned.keys(), [&owned, &parts, &errors](int shard, QSqlDatabase db) {
+        const QList<int> shardIds = owned.value(shard);
+        for (int start = 0; start < shardIds.size(); start += BulkChunkSize) {
+            const QList<int> chunk = shardIds.mid(start, BulkChunkSize);
+            QSqlQuery q(db);
+            q.setForwardOnly(true);
+            q.prepare("SELECT id_commande, id_client, date_commande, statut, montant_total, moyen_paiement, remarque "
+                      "FROM commande WHERE id_commande IN (" + QStringList(chunk.size(), "?").join(", ") + ")");
+            for (int id : chunk)
+                q.addBindValue(id);
+            if (!q.exec()) {
+                errors[shard] = q.lastError();
+                return;
+            }
+            RowCursor<CommandeRow> cursor(q);
+            CommandeRow row;
+            while (cursor.next(row))
+                parts[shard] << row;
+        }
+    });
+
+    QVector<CommandeRow> rows;
+    for (int shard = 0; shard < parts.size(); ++shard) {
+        if (errors.at(shard).isValid()) {
+            qWarning() << "getCommandesByIds failed on shard" << shard << errors.at(shard).text();
+            return RowCursor<CommandeRow>(QVector<CommandeRow>(), errors.at(shard));
+        }
+        rows += parts.at(shard);
+    }
+    readClientNames(rows);
+    return RowCursor<CommandeRow>(rows);
+}
+
+void DatabaseManager::readClientNames(QVector<CommandeRow> &rows)
+{
+    const QSqlDatabase db = serverReadDb();
+    m_clientNames.refresh(db);
+    m_clientNames.fill(db, rows);
+}
+
+// ---- Archive ----
+// One seek on idx_archive_date; the local replica has no archive, the
+// primary and the read replica do
+bool DatabaseManager::archiveReaches(const QDate &fromDate, const QDate &toDate)
+{
+    QStringList conditions;
+    QVariantList binds;
+    if (fromDate.isValid()) {
+        conditions << "date_commande >= ?";
+        binds << QDateTime(fromDate, QTime(0, 0));
+    }
+    if (toDate.isValid()) {
+        conditions << "date_commande <= ?";
+        binds << QDateTime(toDate, QTime(23, 59, 59));
+    }
+
+    QSqlQuery q(serverReadDb());
+    q.prepare("SELECT 1 FROM commande_archive"
+              + (conditions.isEmpty() ? QString() : " WHERE " + conditions.join(" AND ")) + " LIMIT 1");
+    for (const QVariant &value : binds)
+        q.addBindValue(value);
+    if (!q.exec()) {
+        qWarning() << "archiveReaches failed:" << q.lastError().text();
+        return false;
+    }
+    return q.next();
+}
+
+QString DatabaseManager::ordersSource(const QDate &fromDate, const QDate &toDate, QSqlDatabase *db)
+{
+    if (!archiveReaches(fromDate, toDate)) {
+        if (db)
+            *db = readDb();
+        return "commande";
+    }
+    if (db)
+        *db = serverReadDb();
+    return QString("(SELECT %1 FROM commande UNION ALL SELECT %1 FROM commande_archive)").arg(ArchiveColumns);
+}
+
+QList<int> DatabaseManager::archivableCommandes(const QDateTime &before, int limit)
+{
+    QList<int> ids;
+    QSqlQuery q(m_db);
+    q.setForwardOnly(true);
+    q.prepare(QString("SELECT id_commande FROM commande WHERE date_commande < :before "
+                      "ORDER BY date_commande LIMIT %1").arg(limit));
+    q.bindValue(":before", before);
+    if (!q.exec()) {
+        qWarning() << "archivableCommandes failed:" << q.lastError().text();
+        return ids;
+    }
+    while (q.next())
+        ids << q.value(0).toInt();
+    return ids;
+}
+
+QList<int> DatabaseManager::archivedCommandes(const QList<int> &ids, bool *ok)
+{
+    QList<int> archived;
+    if (ok)
+        *ok = true;
+    for (int start = 0; start < ids.size(); start += BulkChunkSize) {
+        const QList<int> chunk = ids.mid(start, BulkChunkSize);
+        QSqlQuery q(m_db);
+        q.setForwardOnly(true);
+        q.prepare("SELECT id_commande FROM commande_archive WHERE id_commande IN ("
+                  + QStringList(chunk.size(), "?").join(", ") + ")");
+        for (int id : chunk)
+            q.addBindValue(id);
+        if (!q.exec()) {
+            qWarning() << "archivedCommandes failed:" << q.lastError().text();
+            if (ok)
+                *ok = false;
+            return archived;
+        }
+        while (q.next())
+            archived << q.value(0).toInt();
+    }
+    return archived;
+}
+
+// Copy, delete and tombstones in one transaction: replicas drop the rows on
+// their next pull. Client counters include the archive, so they stay as is.
+bool DatabaseManager::archiveCommandes(const QList<int> &ids)
+{
+    if (ids.isEmpty())
+        return true;
+
+    m_db.transaction();
+    const bool ok = execForIds(m_db, QString("INSERT INTO commande_archive (%1) SELECT %1 FROM commande "
+                                             "WHERE id_commande IN (%2)").arg(ArchiveColumns, "%1"), {}, ids)
+        && execForIds(m_db, "DELETE FROM commande WHERE id_commande IN (%1)", {}, ids)
+        && recordDeletions("commande", ids);
+    if (!ok || !m_db.commit()) {
+        qWarning() << "archiveCommandes failed:" << m_db.lastError().text();
+        m_db.rollback();
+        return false;
+    }
+
+    if (m_replica && m_replicaDb.isOpen()) {
+        m_replicaDb.transaction();
+        if (!execForIds(m_replicaDb, "DELETE FROM commande WHERE id_commande IN (%1)", {}, ids) || !m_replicaDb.commit())
+            m_replicaDb.rollback();
+    }
+    return true;
+}
+
+bool DatabaseManager::refreshClientCounters(QSqlDatabase db, const QList<int> &clientIds)
+{
+    // Correlated subqueries walk idx_commande_client_date (and its archive
+    // twin) for each client only. Archived orders still count: archiving
+    // leaves the counters unchanged, and archived orders are all older.
+    const QString sql = "UPDATE client SET "
+                        "nb_commandes = (SELECT COUNT(*) FROM commande co WHERE co.id_client = client.id_client)"
+                        " + (SELECT COUNT(*) FROM commande_archive ca WHERE ca.id_client = client.id_client), "
+                        "total_montant = (SELECT COALESCE(SUM(co.montant_total), 0) FROM commande co "
+                        "WHERE co.id_client = client.id_client)"
+                        " + (SELECT COALESCE(SUM(ca.montant_total), 0) FROM commande_archive ca "
+                        "WHERE ca.id_client = client.id_client), "
+                        "last_order_at = COALESCE((SELECT MAX(co.date_commande) FROM commande co "
+                        "WHERE co.id_client = client.id_client), (SELECT MAX(ca.date_commande) "
+                        "FROM commande_archive ca WHERE ca.id_client = client.id_client))";
+    if (!clientIds.isEmpty())
+        return execForIds(db, sql + " WHERE id_client IN (%1)", {}, clientIds);
+
+    QSqlQuery q(db);
+    if (!q.exec(sql)) {
+        qWarning() << "refreshClientCounters failed:" << q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+// The replica has no archive to count from: the primary's values are copied
+void DatabaseManager::refreshReplicaCounters(const QList<int> &clientIds)
+{
+    if (!m_replica || !m_replicaDb.isOpen() || clientIds.isEmpty())
+        return;
+
+    QSqlQuery update(m_replicaDb);
+    update.prepare("UPDATE client SET nb_commandes = ?, total_montant = ?, last_order_at = ? WHERE id_client = ?");
+    m_replicaDb.transaction();
+    bool ok = true;
+    for (int start = 0; ok && start < clientIds.size(); start += BulkChunkSize) {
+        const QList<int> chunk = clientIds.mid(start, BulkChunkSize);
+        QStringList placeholders;
+        for (int i = 0; i < chunk.size(); ++i)
+            placeholders << "?";
+
+        QSqlQuery q(m_db);
+        q.setForwardOnly(true);
+        q.prepare("SELECT id_client, nb_commandes, total_montant, last_order_at FROM client "
+                  "WHERE id_client IN (" + placeholders.join(", ") + ")");
+        for (int id : chunk)
+            q.addBindValue(id);
+        ok = q.exec();
+        while (ok && q.next()) {
+            update.addBindValue(q.value(1));
+            update.addBindValue(q.value(2));
+            update.addBindValue(q.value(3));
+            update.addBindValue(q.value(0));
+            ok = update.exec();
+        }
+    }
+    if (!ok || !m_replicaDb.commit())
+        m_replicaDb.rollback();
+}
+
+bool DatabaseManager::recordDeletion(const QString &table, int rowId)
+{
+    QSqlQuery q(m_db);
+    q.prepare("INSERT INTO deleted_row (table_name, row_id) VALUES (:table, :rowId)");
+    q.bindValue(":table", table);
+    q.bindValue(":rowId", rowId);
+    if (!q.exec()) {
+        qWarning() << "recordDeletion failed:" << q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::recordDeletions(const QString &table, const QList<int> &rowIds)
+{
+    // Multi-row INSERT, one statement per chunk
+    for (int start = 0; start < rowIds.size(); start += BulkChunkSize) {
+        const QList<int> chunk = rowIds.mid(start, BulkChunkSize);
+        QStringList rows;
+        for (int i = 0; i < chunk.size(); ++i)
+            rows << "(?, ?)";
+
+        QSqlQuery q(m_db);
+        q.prepare("INSERT INTO deleted_row (table_name, row_id) VALUES " + rows.join(", "));
+        for (int rowId : chunk) {
+            q.addBindValue(table);
+            q.addBindValue(rowId);
+        }
+        if (!q.exec()) {
+            qWarning() << "recordDeletions failed:" << q.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+QList<int> DatabaseManager::clientIdsOfCommandes(const QList<int> &commandeIds)
 {
-    // Change to QODBC since QMYSQL driver is not available
-    m_driver = "QODBC"; // Changed from "QMYSQL"
+    if (m_shards)
+        return shardedClientIdsOfCommandes(commandeIds);
 
-    m_db = QSqlDatabase::addDatabase(m_driver);
+    QList<int> clientIds;
+    for (int start = 0; start < commandeIds.size(); start += BulkChunkSize) {
+        const QList<int> chunk = commandeIds.mid(start, BulkChunkSize);
+        QStringList placeholders;
+        for (int i = 0; i < chunk.size(); ++i)
+            placeholders << "?";
 
-    if (m_driver == "QMYSQL") {
-        m_db.setHostName("localhost");
-        m_db.setDatabaseName("credit_db");
-        m_db.setUserName("root");
-        m_db.setPassword(""); // change if you set a password
-    } else {
-        // ODBC connection string - adjust based on your MySQL ODBC driver
-        QString conn = "DRIVER={MySQL ODBC 8.0 Unicode Driver};SERVER=localhost;DATABASE=credit_db;USER=root;PASSWORD=;OPTION=3;";
-        m_db.setDatabaseName(conn);
+        QSqlQuery q(m_db);
+        q.setForwardOnly(true);
+        q.prepare("SELECT DISTINCT id_client FROM commande WHERE id_commande IN (" + placeholders.join(", ") + ")");
+        for (int id : chunk)
+            q.addBindValue(id);
+        if (!q.exec()) {
+            qWarning() << "clientIdsOfCommandes failed:" << q.lastError().text();
+            continue;
+        }
+        while (q.next()) {
+            const int clientId = q.value(0).toInt();
+            if (!clientIds.contains(clientId))
+                clientIds << clientId;
+        }
     }
+    return clientIds;
 }
 
-DatabaseManager::~DatabaseManager()
+bool DatabaseManager::execForIds(QSqlDatabase db, const QString &sql, const QVariantList &binds, const QList<int> &ids)
 {
-    close();
+    for (int start = 0; start < ids.size(); start += BulkChunkSize) {
+        const QList<int> chunk = ids.mid(start, BulkChunkSize);
+        QStringList placeholders;
+        for (int i = 0; i < chunk.size(); ++i)
+            placeholders << "?";
+
+        QSqlQuery q(db);
+        q.prepare(sql.arg(placeholders.join(", ")));
+        for (const QVariant &value : binds)
+            q.addBindValue(value);
+        for (int id : chunk)
+            q.addBindValue(id);
+        if (!q.exec()) {
+            qWarning() << "execForIds failed:" << q.lastError().text();
+            return false;
+        }
+    }
+    return true;
 }
 
-bool DatabaseManager::open()
+// The statement runs over all ids, then the tombstones, in one transaction.
+// The replica gets the same statement once the primary has committed.
+bool DatabaseManager::runBulk(const char *operation, const QString &sql, const QVariantList &binds,
+                              const QList<int> &ids, const QString &tombstoneTable, const QList<int> &counterClients)
 {
-    if (!m_db.open()) {
-        qCritical() << "DB open error:" << m_db.lastError().text();
+    if (ids.isEmpty())
+        return true;
+
+    if (m_shards) {
+        // The statement on the shards of the orders, then tombstones and
+        // counters on the primary
+        const QHash<int, QList<int>> owned = m_shards->byCommande(ids);
+        if (!m_shards->transact(owned.keys(), [&owned, &sql, &binds](int shard, QSqlDatabase db) {
+                return execForIds(db, sql, binds, owned.value(shard));
+            })) {
+            qWarning() << operation << "failed on the order shards";
+            return false;
+        }
+        m_db.transaction();
+        bool ok = tombstoneTable.isEmpty() || recordDeletions(tombstoneTable, ids);
+        if (ok && !counterClients.isEmpty())
+            ok = refreshShardedCounters(counterClients);
+        if (!ok || !m_db.commit()) {
+            qWarning() << operation << "done on the shards, tombstones or counters failed:" << m_db.lastError().text();
+            m_db.rollback();
+            return false;
+        }
+        return true;
+    }
+
+    m_db.transaction();
+    bool ok = execForIds(m_db, sql, binds, ids);
+    if (ok && !tombstoneTable.isEmpty())
+        ok = recordDeletions(tombstoneTable, ids);
+    if (ok && !counterClients.isEmpty())
+        ok = refreshClientCounters(m_db, counterClients);
+    if (!ok || !m_db.commit()) {
+        qWarning() << operation << "failed:" << m_db.lastError().text();
+        m_db.rollback();
         return false;
     }
-    qDebug() << "DB opened. Drivers available:" << QSqlDatabase::drivers();
+
+    if (m_replica && m_replicaDb.isOpen()) {
+        m_replicaDb.transaction();
+        if (!execForIds(m_replicaDb, sql, binds, ids) || !m_replicaDb.commit())
+            m_replicaDb.rollback();
+        refreshReplicaCounters(counterClients);
+    }
     return true;
 }
 
-void DatabaseManager::close()
+// Our own writes land in the replica right away; the next delta pull
+// overwrites them with the primary's timestamps.
+void DatabaseManager::applyToReplica(const QString &sql, const QVariantMap &binds)
 {
-    if (m_db.isOpen()) {
-        m_db.close();
+    if (!m_replica || !m_replicaDb.isOpen())
+        return;
+
+    QSqlQuery q(m_replicaDb);
+    q.prepare(sql);
+    for (auto it = binds.cbegin(); it != binds.cend(); ++it)
+        q.bindValue(":" + it.key(), it.value());
+    if (!q.exec())
+        qWarning() << "applyToReplica failed:" << q.lastError().text();
+}
+
+bool DatabaseManager::ensureIndex(const QString &table, const QString &name, const QString &columns)
+{
+    return ensureIndex(m_db, table, name, columns);
+}
+
+bool DatabaseManager::migrateOnce(QSqlDatabase db, const QString &name, const std::function<bool()> &migrate)
+{
+    QSqlQuery q(db);
+    if (!q.exec("CREATE TABLE IF NOT EXISTS schema_migration (name VARCHAR(64) PRIMARY KEY, applied_at VARCHAR(32))")) {
+        qWarning() << "migrateOnce failed:" << name << q.lastError().text();
+        return false;
+    }
+    q.prepare("SELECT 1 FROM schema_migration WHERE name = ?");
+    q.addBindValue(name);
+    if (!q.exec()) {
+        qWarning() << "migrateOnce failed:" << name << q.lastError().text();
+        return false;
+    }
+    if (q.next())
+        return true;
+
+    db.transaction();
+    QSqlQuery record(db);
+    record.prepare("INSERT INTO schema_migration (name, applied_at) VALUES (?, ?)");
+    record.addBindValue(name);
+    record.addBindValue(QDateTime::currentDateTime().toString(Qt::ISODate));
+    if (!migrate() || !record.exec() || !db.commit()) {
+        qWarning() << "migrateOnce failed:" << name << record.lastError().text();
+        db.rollback();
+        return false;
     }
+    return true;
 }
 
-// ---- CLIENT ----
-bool DatabaseManager::addClient(const QString &nom, const QString &prenom, const QString &email,
-                                const QString &telephone, const QString &adresse, qint64 &outId)
+// One UPDATE per column, the WHERE keeping it to the rows still labelled
+bool DatabaseManager::normalizeOrderCodes(QSqlDatabase db, const QString &table)
+{
+    const QList<QPair<QString, QStringList>> columns = {
+        {"statut", OrderCodes::statuts()}, {"moyen_paiement", OrderCodes::paiements()},
+    };
+    for (const auto &column : columns) {
+        QStringList cases;
+        QStringList placeholders;
+        for (int i = 0; i < column.second.size(); ++i) {
+            cases << "WHEN ? THEN ?";
+            placeholders << "?";
+        }
+        QSqlQuery q(db);
+        q.prepare(QString("UPDATE %1 SET %2 = CASE %2 %3 END WHERE %2 IN (%4)")
+                      .arg(table, column.first, cases.join(' '), placeholders.join(", ")));
+        for (const QString &code : column.second) {
+            q.addBindValue(OrderCodes::label(code));
+            q.addBindValue(code);
+        }
+        for (const QString &code : column.second)
+            q.addBindValue(OrderCodes::label(code));
+        if (!q.exec()) {
+            qWarning() << "normalizeOrderCodes failed:" << table << column.first << q.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DatabaseManager::ensureIndex(QSqlDatabase db, const QString &table, const QString &name, const QString &columns)
+{
+    QSqlQuery q(db);
+    if (db.driverName() == "QSQLITE") {
+        if (!q.exec(QString("CREATE INDEX IF NOT EXISTS %1 ON %2 (%3)").arg(name, table, columns))) {
+            qWarning() << "ensureIndex failed:" << name << q.lastError().text();
+            return false;
+        }
+        return true;
+    }
+
+    // MySQL has no CREATE INDEX IF NOT EXISTS
+    q.prepare("SELECT COUNT(*) FROM information_schema.statistics "
+              "WHERE table_schema = DATABASE() AND table_name = :table AND index_name = :name");
+    q.bindValue(":table", table);
+    q.bindValue(":name", name);
+    if (!q.exec() || !q.next()) {
+        qWarning() << "ensureIndex lookup failed:" << name << q.lastError().text();
+        return false;
+    }
+    if (q.value(0).toInt() > 0)
+        return true;
+
+    if (!q.exec(QString("CREATE INDEX %1 ON %2 (%3)").arg(name, table, columns))) {
+        qWarning() << "ensureIndex failed:" << name << q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+// ---- Entity helpers ----
+// SQL text and bindings come from EntityTraits (Entities.h)
+template <typename Entity>
+bool DatabaseManager::insertEntity(Entity &entity, const char *operation)
 {
     QSqlQuery q(m_db);
-    q.prepare("INSERT INTO client (nom, prenom, email, telephone, adresse) "
-              "VALUES (:nom, :prenom, :email, :telephone, :adresse)");
-    q.bindValue(":nom", nom);
-    q.bindValue(":prenom", prenom);
-    q.bindValue(":email", email);
-    q.bindValue(":telephone", telephone);
-    q.bindValue(":adresse", adresse);
+    q.prepare(EntitySql::insert<Entity>());
+    EntitySql::bindFields(q, entity);
 
     if (!q.exec()) {
-        qWarning() << "addClient failed:" << q.lastError().text();
+        qWarning() << operation << "failed:" << q.lastError().text();
         return false;
     }
     QVariant id = q.lastInsertId();
-    outId = id.isValid() ? id.toLongLong() : -1;
+    entity.*(EntityTraits<Entity>::key.member) = id.isValid() ? id.toLongLong() : -1;
     return true;
 }
 
-bool DatabaseManager::getClient(int id, QSqlRecord &outRecord)
+template <typename Entity>
+bool DatabaseManager::fetchEntity(qint64 id, Entity &outEntity, const char *operation)
 {
-    QSqlQuery q(m_db);
-    q.prepare("SELECT * FROM client WHERE id_client = :id");
-    q.bindValue(":id", id);
+    QSqlDatabase db = readDb();
+    QSqlQuery q(db);
+    q.setForwardOnly(true);
+    q.prepare(EntitySql::selectByKey<Entity>());
+    q.bindValue(QString(":") + QString::fromLatin1(EntityTraits<Entity>::key.column), id);
+    capturePlan(operation, db, q);
     if (!q.exec()) {
-        qWarning() << "getClient exec failed:" << q.lastError().text();
+        qWarning() << operation << "exec failed:" << q.lastError().text();
         return false;
     }
     if (q.next()) {
-        outRecord = q.record();
+        EntitySql::read(q, outEntity);
         return true;
     }
     return false;
 }
 
-bool DatabaseManager::updateClient(int id, const QString &nom, const QString &prenom, const QString &email,
-                                   const QString &telephone, const QString &adresse)
+template <typename Entity>
+bool DatabaseManager::updateEntity(const Entity &entity, const char *operation)
 {
     QSqlQuery q(m_db);
-    q.prepare("UPDATE client SET nom=:nom, prenom=:prenom, email=:email, telephone=:telephone, adresse=:adresse WHERE id_client=:id");
-    q.bindValue(":nom", nom);
-    q.bindValue(":prenom", prenom);
-    q.bindValue(":email", email);
-    q.bindValue(":telephone", telephone);
-    q.bindValue(":adresse", adresse);
-    q.bindValue(":id", id);
+    q.prepare(EntitySql::update<Entity>());
+    EntitySql::bindFields(q, entity, true);
+    EntitySql::bindKey(q, entity);
 
     if (!q.exec()) {
-        qWarning() << "updateClient failed:" << q.lastError().text();
+        qWarning() << operation << "failed:" << q.lastError().text();
         return false;
     }
     return q.numRowsAffected() > 0;
 }
 
+// ---- CLIENT ----
+bool DatabaseManager::addClient(Client &client)
+{
+    if (!insertEntity(client, "addClient"))
+        return false;
+    if (client.idClient > 0)
+        applyToReplica(EntitySql::upsert<Client>(), EntitySql::values(client));
+    m_clientNames.upsert(int(client.idClient), client.nom, client.prenom);
+    wrote({int(client.idClient)});
+    return true;
+}
+
+bool DatabaseManager::getClient(qint64 id, Client &outClient)
+{
+    return fetchEntity(id, outClient, "getClient");
+}
+
+bool DatabaseManager::updateClient(const Client &client)
+{
+    if (!updateEntity(client, "updateClient"))
+        return false;
+    applyToReplica(EntitySql::update<Client>(), EntitySql::values(client, true));
+    m_clientNames.upsert(int(client.idClient), client.nom, client.prenom);
+    wrote({int(client.idClient)});
+    return true;
+}
+
 bool DatabaseManager::deleteClient(int id)
 {
+    // The tombstone commits with the delete so replicas never miss it
+    m_db.transaction();
     QSqlQuery q(m_db);
     q.prepare("DELETE FROM client WHERE id_client = :id");
     q.bindValue(":id", id);
-    if (!q.exec()) {
+    if (!q.exec() || !recordDeletion("client", id) || !m_db.commit()) {
         qWarning() << "deleteClient failed:" << q.lastError().text();
+        m_db.rollback();
         return false;
     }
+
+    if (m_shards)
+        deleteShardOrders({id});
+    applyToReplica("DELETE FROM commande WHERE id_client = :id", {{"id", id}});
+    applyToReplica("DELETE FROM client WHERE id_client = :id", {{"id", id}});
+    m_clientNames.remove(id);
+    wrote({id});
     return true;
 }
 
 // New client analytics methods
-QSqlQuery DatabaseManager::getClientsWithCommandCount()
+QSqlQuery DatabaseManager::getClientsWithCommandCount(bool forwardOnly, int limit, const QVariantList &after)
 {
-    QSqlQuery q(m_db);
-    QString sql = "SELECT c.*, COUNT(co.id_commande) as nb_commandes "
-                  "FROM client c LEFT JOIN commande co ON c.id_client = co.id_client "
-                  "GROUP BY c.id_client, c.nom, c.prenom, c.email, c.telephone, c.adresse "
-                  "ORDER BY nb_commandes DESC";
+    QString sql = "SELECT c.* FROM client c";
+    if (after.size() == 2)
+        sql += " WHERE c.nb_commandes <= ? AND (c.nb_commandes < ? OR c.id_client < ?)";
+    sql += " ORDER BY c.nb_commandes DESC, c.id_client DESC";
+    if (limit > 0)
+        sql += QString(" LIMIT %1").arg(limit);
 
-    if (!q.exec(sql)) {
+    QSqlDatabase db = readDb();
+    QSqlQuery q(db);
+    q.setForwardOnly(forwardOnly);
+    q.prepare(sql);
+    if (after.size() == 2) {
+        q.addBindValue(after.at(0));
+        q.addBindValue(after.at(0));
+        q.addBindValue(after.at(1));
+    }
+    capturePlan("getClientsWithCommandCount", db, q);
+
+    if (!q.exec()) {
         qWarning() << "getClientsWithCommandCount failed:" << q.lastError().text();
     }
     return q;
 }
 
+QSqlQuery DatabaseManager::searchClients(const QString &textLike, bool forwardOnly, int limit,
+                                         const QVariantList &after)
+{
+    // Clients inserted by other tools since the schema setup have no keys yet
+    if (m_keysFilledMs < 0 || sessionMs() - m_keysFilledMs >= SearchKeysFillMs) {
+        m_keysFilledMs = sessionMs();
+        fillSearchKeys();
+    }
+
+    // "%" matches every row: without the LIKEs the first page is a walk of idx_client_nom
+    QStringList conditions;
+    QVariantList binds;
+    if (textLike.startsWith("%@")) {
+        // Email domain, anywhere after the @: no index, a scan of client
+        conditions << "c.email_key LIKE ?";
+        binds << SearchKey::normalize(textLike);
+    } else if (!textLike.isEmpty() && textLike != "%") {
+        const QString keyLike = SearchKey::normalize(textLike);
+        conditions << "(c.nom_key LIKE ? OR c.prenom_key LIKE ? OR c.email_key LIKE ?)";
+        binds << keyLike << keyLike << keyLike;
+    }
+    // The leading nom >= keeps the seek on the index, the rest breaks ties
+    if (after.size() == 3) {
+        conditions << "c.nom >= ? AND (c.nom > ? OR c.prenom > ? OR (c.prenom = ? AND c.id_client > ?))";
+        binds << after.at(0) << after.at(0) << after.at(1) << after.at(1) << after.at(2);
+    }
+
+    QString sql = "SELECT c.* FROM client c";
+    if (!conditions.isEmpty())
+        sql += " WHERE " + conditions.join(" AND ");
+    sql += " ORDER BY c.nom, c.prenom, c.id_client";
+    if (limit > 0)
+        sql += QString(" LIMIT %1").arg(limit);
+
+    QSqlDatabase db = readDb();
+    QSqlQuery q(db);
+    q.setForwardOnly(forwardOnly);
+    q.prepare(sql);
+    for (const QVariant &value : binds)
+        q.addBindValue(value);
+    capturePlan("searchClients", db, q);
+
+    if (!q.exec()) {
+        qWarning() << "searchClients failed:" << q.lastError().text();
+    }
+    return q;
+}
+
+QSqlQuery DatabaseManager::getClientMetrics(const QList<int> &clientIds)
+{
+    // Whole history: the archive is read as soon as it holds any order
+    QSqlDatabase db;
+    const QString orders = ordersSource(QDate(), QDate(), &db);
+    QString sql = "SELECT c.id_client, c.nom, c.prenom, COUNT(co.id_commande) AS nb_commandes, "
+                  "COALESCE(SUM(co.montant_total), 0) AS total_montant, "
+                  "MIN(co.date_commande) AS first_order, MAX(co.date_commande) AS last_order "
+                  "FROM client c LEFT JOIN " + orders + " co ON co.id_client = c.id_client ";
+    if (!clientIds.isEmpty()) {
+        QStringList placeholders;
+        for (int i = 0; i < clientIds.size(); ++i)
+            placeholders << "?";
+        sql += "WHERE c.id_client IN (" + placeholders.join(", ") + ") ";
+    }
+    sql += "GROUP BY c.id_client, c.nom, c.prenom";
+
+    QSqlQuery q(db);
+    q.setForwardOnly(true);
+    q.prepare(sql);
+    for (int id : clientIds)
+        q.addBindValue(id);
+    if (!q.exec()) {
+        qWarning() << "getClientMetrics failed:" << q.lastError().text();
+    }
+    return q;
+}
+
 double DatabaseManager::getTotalRevenueFromClient(int clientId)
 {
-    QSqlQuery q(m_db);
-    q.prepare("SELECT SUM(montant_total) as total_revenue FROM commande WHERE id_client = :clientId");
+    QSqlQuery q(readDb());
+    q.prepare("SELECT total_montant AS total_revenue FROM client WHERE id_client = :clientId");
     q.bindValue(":clientId", clientId);
 
     if (q.exec() && q.next()) {
@@ -140,8 +1614,8 @@ double DatabaseManager::getTotalRevenueFromClient(int clientId)
 
 int DatabaseManager::getClientCommandCount(int clientId)
 {
-    QSqlQuery q(m_db);
-    q.prepare("SELECT COUNT(*) as command_count FROM commande WHERE id_client = :clientId");
+    QSqlQuery q(readDb());
+    q.prepare("SELECT nb_commandes AS command_count FROM client WHERE id_client = :clientId");
     q.bindValue(":clientId", clientId);
 
     if (q.exec() && q.next()) {
@@ -150,159 +1624,635 @@ int DatabaseManager::getClientCommandCount(int clientId)
     return 0;
 }
 
-// ---- COMMANDE ----
-bool DatabaseManager::addCommande(int idClient, const QDateTime &dateCommande, const QString &statut,
-                                  double montantTotal, const QString &moyenPaiement, const QString &remarque, qint64 &outId)
+QList<int> DatabaseManager::checkClientCounters(bool *ok)
 {
+    QList<int> mismatched;
     QSqlQuery q(m_db);
-    q.prepare("INSERT INTO commande (id_client, date_commande, statut, montant_total, moyen_paiement, remarque) "
-              "VALUES (:id_client, :date_commande, :statut, :montant_total, :moyen_paiement, :remarque)");
-    q.bindValue(":id_client", idClient);
-    q.bindValue(":date_commande", dateCommande);
-    q.bindValue(":statut", statut);
-    q.bindValue(":montant_total", montantTotal);
-    q.bindValue(":moyen_paiement", moyenPaiement);
-    q.bindValue(":remarque", remarque);
+    q.setForwardOnly(true);
+    if (m_shards) {
+        bool read = false;
+        const QHash<int, ClientTotals> totals = shardClientTotals(QList<int>(), &read);
+        const bool success =
+            read && q.exec("SELECT id_client, nb_commandes, total_montant, last_order_at FROM client");
+        if (read && !success)
+            qWarning() << "checkClientCounters failed:" << q.lastError().text();
+        while (success && q.next()) {
+            const ClientTotals clientTotals = totals.value(q.value(0).toInt());
+            if (q.value(1).toInt() != clientTotals.count || qAbs(q.value(2).toDouble() - clientTotals.total) > 0.005
+                || q.value(3).toDateTime() != clientTotals.lastOrder.toDateTime())
+                mismatched << q.value(0).toInt();
+        }
+        if (ok)
+            *ok = success;
+        return mismatched;
+    }
 
-    if (!q.exec()) {
-        qWarning() << "addCommande failed:" << q.lastError().text();
+    const bool success = q.exec(
+        "SELECT c.id_client FROM client c LEFT JOIN ("
+        " SELECT id_client, COUNT(*) AS n, SUM(montant_total) AS total, MAX(date_commande) AS last_order"
+        " FROM (SELECT id_client, montant_total, date_commande FROM commande"
+        " UNION ALL SELECT id_client, montant_total, date_commande FROM commande_archive) o"
+        " GROUP BY id_client) agg ON agg.id_client = c.id_client "
+        "WHERE c.nb_commandes <> COALESCE(agg.n, 0)"
+        " OR ABS(c.total_montant - COALESCE(agg.total, 0)) > 0.005"
+        " OR (c.last_order_at IS NULL) <> (agg.last_order IS NULL)"
+        " OR c.last_order_at <> agg.last_order");
+    if (!success)
+        qWarning() << "checkClientCounters failed:" << q.lastError().text();
+    while (success && q.next())
+        mismatched << q.value(0).toInt();
+    if (ok)
+        *ok = success;
+    return mismatched;
+}
+
+bool DatabaseManager::rebuildClientCounters(const QList<int> &clientIds)
+{
+    m_db.transaction();
+    const bool refreshed = m_shards ? refreshShardedCounters(clientIds) : refreshClientCounters(m_db, clientIds);
+    if (!refreshed || !m_db.commit()) {
+        qWarning() << "rebuildClientCounters failed:" << m_db.lastError().text();
+        m_db.rollback();
         return false;
     }
-    QVariant id = q.lastInsertId();
-    outId = id.isValid() ? id.toLongLong() : -1;
+    if (!clientIds.isEmpty())
+        wrote(clientIds);
     return true;
 }
 
-bool DatabaseManager::getCommande(int id, QSqlRecord &outRecord)
+// Each IS NULL is a seek on its key index; the keys are computed here
+// since SQL has no accent folding
+bool DatabaseManager::fillSearchKeys()
 {
-    QSqlQuery q(m_db);
-    q.prepare("SELECT * FROM commande WHERE id_commande = :id");
-    q.bindValue(":id", id);
-    if (!q.exec()) {
-        qWarning() << "getCommande exec failed:" << q.lastError().text();
+    QSqlQuery select(m_db);
+    select.setForwardOnly(true);
+    if (!select.exec("SELECT id_client, nom, prenom, email FROM client "
+                     "WHERE nom_key IS NULL OR prenom_key IS NULL OR email_key IS NULL")) {
+        qWarning() << "fillSearchKeys failed:" << select.lastError().text();
         return false;
     }
-    if (q.next()) {
-        outRecord = q.record();
+    QVector<Client> clients;
+    while (select.next()) {
+        Client client;
+        client.idClient = select.value(0).toLongLong();
+        client.nom = select.value(1).toString();
+        client.prenom = select.value(2).toString();
+        client.email = select.value(3).toString();
+        clients << client;
+    }
+    select.finish();
+    if (clients.isEmpty())
         return true;
+
+    m_db.transaction();
+    QSqlQuery update(m_db);
+    update.prepare("UPDATE client SET nom_key = ?, prenom_key = ?, email_key = ? WHERE id_client = ?");
+    for (const Client &client : std::as_const(clients)) {
+        update.addBindValue(EntityTraits<Client>::nomKey(client));
+        update.addBindValue(EntityTraits<Client>::prenomKey(client));
+        update.addBindValue(EntityTraits<Client>::emailKey(client));
+        update.addBindValue(client.idClient);
+        if (!update.exec()) {
+            qWarning() << "fillSearchKeys failed:" << update.lastError().text();
+            m_db.rollback();
+            return false;
+        }
     }
-    return false;
+    return m_db.commit();
 }
 
-bool DatabaseManager::updateCommande(int id, const QString &statut, double montantTotal, const QString &moyenPaiement, const QString &remarque)
+// ---- COMMANDE ----
+// Each order write refreshes its client's counters in the same transaction
+bool DatabaseManager::addCommande(Commande &commande)
 {
-    QSqlQuery q(m_db);
-    q.prepare("UPDATE commande SET statut=:statut, montant_total=:montant_total, moyen_paiement=:moyen_paiement, remarque=:remarque WHERE id_commande=:id");
-    q.bindValue(":statut", statut);
-    q.bindValue(":montant_total", montantTotal);
-    q.bindValue(":moyen_paiement", moyenPaiement);
-    q.bindValue(":remarque", remarque);
-    q.bindValue(":id", id);
+    const QList<int> clientIds{int(commande.idClient)};
+    if (m_shards) {
+        QList<Commande> commandes{commande};
+        commandes.first().idCommande = -1;
+        QList<int> owners;
+        if (!saveShardCommandes(commandes, owners))
+            return false;
+        commande.idCommande = commandes.first().idCommande;
+        syncShardedCounters(clientIds);
+        wrote(clientIds);
+        return true;
+    }
 
-    if (!q.exec()) {
-        qWarning() << "updateCommande failed:" << q.lastError().text();
+    m_db.transaction();
+    if (!insertEntity(commande, "addCommande") || !refreshClientCounters(m_db, clientIds) || !m_db.commit()) {
+        m_db.rollback();
         return false;
     }
-    return q.numRowsAffected() > 0;
+
+    if (commande.idCommande > 0)
+        applyToReplica(EntitySql::upsert<Commande>(), EntitySql::values(commande));
+    refreshReplicaCounters(clientIds);
+    wrote(clientIds);
+    return true;
+}
+
+bool DatabaseManager::getCommande(qint64 id, Commande &outCommande)
+{
+    if (!m_shards)
+        return fetchEntity(id, outCommande, "getCommande");
+
+    if (id < 0)
+        return false;
+    bool found = false;
+    m_shards->scatter({m_shards->shardOfCommande(id)}, [id, &outCommande, &found](int shard, QSqlDatabase db) {
+        QSqlQuery q(db);
+        q.setForwardOnly(true);
+        q.prepare(EntitySql::selectByKey<Commande>());
+        q.bindValue(":id_commande", id);
+        if (!q.exec()) {
+            qWarning() << "getCommande exec failed on shard" << shard << q.lastError().text();
+            return;
+        }
+        if (q.next()) {
+            EntitySql::read(q, outCommande);
+            found = true;
+        }
+    });
+    return found;
+}
+
+bool DatabaseManager::updateCommande(const Commande &commande)
+{
+    if (m_shards) {
+        QList<Commande> commandes{commande};
+        QList<int> owners;
+        if (commande.idCommande < 0 || !saveShardCommandes(commandes, owners))
+            return false;
+        syncShardedCounters(owners);
+        wrote(owners);
+        return true;
+    }
+
+    // id_client is not updatable: take it from the stored row, not the caller
+    const QList<int> clientIds = clientIdsOfCommandes({int(commande.idCommande)});
+    m_db.transaction();
+    if (!updateEntity(commande, "updateCommande") || !refreshClientCounters(m_db, clientIds) || !m_db.commit()) {
+        m_db.rollback();
+        return false;
+    }
+
+    applyToReplica(EntitySql::update<Commande>(), EntitySql::values(commande, true));
+    refreshReplicaCounters(clientIds);
+    wrote(clientIds);
+    return true;
 }
 
 bool DatabaseManager::deleteCommande(int id)
 {
+    if (m_shards)
+        return deleteCommandes({id});
+
+    const QList<int> clientIds = clientIdsOfCommandes({id});
+    m_db.transaction();
     QSqlQuery q(m_db);
     q.prepare("DELETE FROM commande WHERE id_commande = :id");
     q.bindValue(":id", id);
-    if (!q.exec()) {
+    if (!q.exec() || !recordDeletion("commande", id) || !refreshClientCounters(m_db, clientIds) || !m_db.commit()) {
         qWarning() << "deleteCommande failed:" << q.lastError().text();
+        m_db.rollback();
+        return false;
+    }
+
+    applyToReplica("DELETE FROM commande WHERE id_commande = :id", {{"id", id}});
+    refreshReplicaCounters(clientIds);
+    wrote(clientIds);
+    return true;
+}
+
+// ---- Write-behind batches ----
+bool DatabaseManager::saveBatch(QList<Client> &clients, QList<Commande> &commandes, bool *commandesWritten)
+{
+    if (commandesWritten)
+        *commandesWritten = false;
+    QList<int> counterClients;
+    bool shardsWritten = false;
+    m_db.transaction();
+    bool ok = true;
+    for (int i = 0; ok && i < clients.size(); ++i) {
+        Client &client = clients[i];
+        ok = client.idClient < 0 ? insertEntity(client, "saveBatch") : updateEntity(client, "saveBatch");
+        if (!counterClients.contains(int(client.idClient)))
+            counterClients << int(client.idClient);
+    }
+    if (m_shards) {
+        // The shards commit inside the primary's transaction: a shard failure
+        // still rolls the clients back. A primary commit failing after them
+        // leaves the orders written.
+        if (ok && !commandes.isEmpty()) {
+            shardsWritten = saveShardCommandes(commandes, counterClients);
+            ok = shardsWritten && refreshShardedCounters(counterClients);
+        }
+    } else {
+        for (int i = 0; ok && i < commandes.size(); ++i) {
+            Commande &commande = commandes[i];
+            // id_client is not updatable: an update counts for the stored client
+            const QList<int> owners = commande.idCommande < 0 ? QList<int>{int(commande.idClient)}
+                                                              : clientIdsOfCommandes({int(commande.idCommande)});
+            ok = commande.idCommande < 0 ? insertEntity(commande, "saveBatch") : updateEntity(commande, "saveBatch");
+            for (int owner : owners) {
+                if (!counterClients.contains(owner))
+                    counterClients << owner;
+            }
+        }
+        if (ok && !commandes.isEmpty())
+            ok = refreshClientCounters(m_db, counterClients);
+    }
+    if (!ok || !m_db.commit()) {
+        qWarning() << "saveBatch failed:" << m_db.lastError().text();
+        m_db.rollback();
+        if (shardsWritten)
+            qWarning() << "saveBatch: orders written on the shards, clients and counters rolled back";
+        if (commandesWritten)
+            *commandesWritten = shardsWritten;
+        return false;
+    }
+
+    for (const Client &client : std::as_const(clients)) {
+        applyToReplica(EntitySql::upsert<Client>(), EntitySql::values(client));
+        m_clientNames.upsert(int(client.idClient), client.nom, client.prenom);
+    }
+    if (!m_shards) {
+        for (const Commande &commande : std::as_const(commandes))
+            applyToReplica(EntitySql::upsert<Commande>(), EntitySql::values(commande));
+    }
+    if (!commandes.isEmpty())
+        refreshReplicaCounters(counterClients);
+    wrote(counterClients);
+    return true;
+}
+
+QSqlQuery DatabaseManager::getClientsByIds(const QList<int> &ids)
+{
+    QStringList placeholders;
+    for (int i = 0; i < ids.size(); ++i)
+        placeholders << "?";
+    QSqlQuery q(m_db);
+    q.setForwardOnly(true);
+    q.prepare("SELECT * FROM client WHERE id_client IN (" + placeholders.join(", ") + ")");
+    for (int id : ids)
+        q.addBindValue(id);
+    if (!q.exec())
+        qWarning() << "getClientsByIds failed:" << q.lastError().text();
+    return q;
+}
+
+QSqlQuery DatabaseManager::getCommandesByIds(const QList<int> &ids)
+{
+    QStringList placeholders;
+    for (int i = 0; i < ids.size(); ++i)
+        placeholders << "?";
+    QSqlQuery q(m_db);
+    q.setForwardOnly(true);
+    q.prepare("SELECT c.id_client, c.nom, c.prenom, co.id_commande, co.date_commande, co.statut, co.montant_total, "
+              "co.moyen_paiement, co.remarque FROM commande co JOIN client c ON c.id_client = co.id_client "
+              "WHERE co.id_commande IN (" + placeholders.join(", ") + ")");
+    for (int id : ids)
+        q.addBindValue(id);
+    if (!q.exec())
+        qWarning() << "getCommandesByIds failed:" << q.lastError().text();
+    return q;
+}
+
+// ---- Bulk ----
+bool DatabaseManager::deleteClients(const QList<int> &ids)
+{
+    // Orders go with their client (ON DELETE CASCADE); the replica has no
+    // cascade while syncing, so its orders are removed explicitly
+    if (ids.isEmpty())
+        return true;
+
+    m_db.transaction();
+    if (!execForIds(m_db, "DELETE FROM client WHERE id_client IN (%1)", {}, ids)
+        || !recordDeletions("client", ids) || !m_db.commit()) {
+        qWarning() << "deleteClients failed:" << m_db.lastError().text();
+        m_db.rollback();
         return false;
     }
+
+    if (m_shards)
+        deleteShardOrders(ids);
+    if (m_replica && m_replicaDb.isOpen()) {
+        m_replicaDb.transaction();
+        if (!execForIds(m_replicaDb, "DELETE FROM commande WHERE id_client IN (%1)", {}, ids)
+            || !execForIds(m_replicaDb, "DELETE FROM client WHERE id_client IN (%1)", {}, ids)
+            || !m_replicaDb.commit())
+            m_replicaDb.rollback();
+    }
+    for (int id : ids)
+        m_clientNames.remove(id);
+    wrote(ids);
+    return true;
+}
+
+bool DatabaseManager::deleteCommandes(const QList<int> &ids)
+{
+    const QList<int> clientIds = clientIdsOfCommandes(ids);
+    if (!runBulk("deleteCommandes", "DELETE FROM commande WHERE id_commande IN (%1)", {}, ids, "commande", clientIds))
+        return false;
+    wrote(clientIds);
     return true;
 }
 
+bool DatabaseManager::updateCommandesStatut(const QList<int> &ids, const QString &statut)
+{
+    return runBulk("updateCommandesStatut", "UPDATE commande SET statut = ? WHERE id_commande IN (%1)", {statut}, ids);
+}
+
+bool DatabaseManager::updateCommandesPaiement(const QList<int> &ids, const QString &moyenPaiement)
+{
+    return runBulk("updateCommandesPaiement", "UPDATE commande SET moyen_paiement = ? WHERE id_commande IN (%1)",
+                   {moyenPaiement}, ids);
+}
+
 // ---- Recherche/tri multicritères ----
-// clientNameLike: substring (ex: "%ali%")
+// clientNameLike: LIKE pattern on nom_key, normalized here (ex: "ali%")
 // statut: exact match or empty QString() to ignore
 // fromDate/toDate: if invalid(), ignored
 QSqlQuery DatabaseManager::searchCommandes(const QString &clientNameLike,
                                            const QString &statut,
                                            const QDate &fromDate,
                                            const QDate &toDate,
-                                           const QString &orderBy)
+                                           const QString &orderBy,
+                                           bool forwardOnly,
+                                           int limit,
+                                           const QVariantList &after,
+                                           const OrderQuery &query,
+                                           bool withNames)
 {
-    QSqlQuery q(m_db);
-    QString sql =
-        "SELECT c.id_client, c.nom, c.prenom, co.id_commande, co.date_commande, co.statut, co.montant_total, co.moyen_paiement, co.remarque "
-        "FROM client c JOIN commande co ON c.id_client = co.id_client "
-        "WHERE (:name IS NULL OR c.nom LIKE :name) "
-        "AND (:statut IS NULL OR co.statut = :statut) "
-        "AND (:fromDate IS NULL OR co.date_commande >= :fromDate) "
-        "AND (:toDate IS NULL OR co.date_commande <= :toDate)";
-
-    if (orderBy == "date_desc") sql += " ORDER BY co.date_commande DESC";
+    // Only the active criteria go into the WHERE clause: "(:x IS NULL OR ...)"
+    // hides the bounds from the planner, which then scans every order
+    QStringList conditions;
+    QVariantList binds;
+    QStringList mode;
+    if (!clientNameLike.isEmpty()) {
+        conditions << (withNames ? "c.nom_key LIKE ?"
+                                 : "co.id_client IN (SELECT id_client FROM client WHERE nom_key LIKE ?)");
+        binds << SearchKey::normalize(clientNameLike);
+        mode << "nom";
+    }
+    if (!statut.isEmpty()) {
+        conditions << "co.statut = ?";
+        binds << statut;
+        mode << "statut";
+    }
+    if (fromDate.isValid()) {
+        conditions << "co.date_commande >= ?";
+        binds << QDateTime(fromDate, QTime(0, 0));
+    }
+    if (toDate.isValid()) {
+        conditions << "co.date_commande <= ?";
+        binds << QDateTime(toDate, QTime(23, 59, 59));
+    }
+    if (fromDate.isValid() || toDate.isValid())
+        mode << "période";
+    // Next page: the <= bound is the one the date index seeks on
+    if (orderBy == "date_desc" && after.size() == 2) {
+        conditions << "co.date_commande <= ? AND (co.date_commande < ? OR co.id_commande < ?)";
+        binds << after.at(0) << after.at(0) << after.at(1);
+    }
+    conditions += query.conditions(binds);
+    for (const QString &label : query.labels()) {
+        if (!mode.contains(label))
+            mode << label;
+    }
+
+    // The archive is only read if the period of both allows it
+    QDate from = fromDate;
+    QDate to = toDate;
+    query.narrowDates(from, to);
+    QSqlDatabase db;
+    const QString orders = ordersSource(from, to, &db);
+    QString sql = withNames
+        ? "SELECT c.id_client, c.nom, c.prenom, co.id_commande, co.date_commande, co.statut, co.montant_total, co.moyen_paiement, co.remarque "
+          "FROM client c JOIN " + orders + " co ON c.id_client = co.id_client"
+        : "SELECT co.id_client, co.id_commande, co.date_commande, co.statut, co.montant_total, co.moyen_paiement, co.remarque "
+          "FROM " + orders + " co";
+    if (!conditions.isEmpty())
+        sql += " WHERE " + conditions.join(" AND ");
+
+    if (orderBy == "date_desc") sql += " ORDER BY co.date_commande DESC, co.id_commande DESC";
     else if (orderBy == "montant_desc") sql += " ORDER BY co.montant_total DESC";
+    else if (orderBy == "client_date") sql += " ORDER BY co.id_client, co.date_commande, co.id_commande";
     else sql += " ORDER BY co.date_commande ASC";
+    if (limit > 0)
+        sql += QString(" LIMIT %1").arg(limit);
 
+    QSqlQuery q(db);
+    q.setForwardOnly(forwardOnly);
     q.prepare(sql);
-
-    if (clientNameLike.isEmpty())
-        q.bindValue(":name", QVariant()); // NULL
-    else
-        q.bindValue(":name", clientNameLike);
-
-    if (statut.isEmpty())
-        q.bindValue(":statut", QVariant());
-    else
-        q.bindValue(":statut", statut);
-
-    if (!fromDate.isValid())
-        q.bindValue(":fromDate", QVariant());
-    else
-        q.bindValue(":fromDate", QDateTime(fromDate, QTime(0, 0)));
-
-    if (!toDate.isValid())
-        q.bindValue(":toDate", QVariant());
-    else
-        q.bindValue(":toDate", QDateTime(toDate, QTime(23, 59, 59)));
+    for (const QVariant &value : binds)
+        q.addBindValue(value);
+    capturePlan(QString("searchCommandes [%1, %2]").arg(mode.isEmpty() ? "sans filtre" : mode.join("+"), orderBy), db, q);
 
     if (!q.exec()) qWarning() << "searchCommandes failed:" << q.lastError().text();
     return q;
 }
 
-QSqlQuery DatabaseManager::ordersPerMonth(int year)
+namespace {
+// Orders and revenue per month of [:start, :end) from the orders table
+// expression; the dialect follows the connection actually queried (the
+// replica is always SQLite, a shard may differ from the primary)
+QString ordersPerMonthSql(const QSqlDatabase &db, const QString &orders)
 {
-    QSqlQuery q(m_db);
-    QString sql;
-    if (m_driver == "QMYSQL" || m_driver == "QODBC") {
-        sql = "SELECT MONTH(date_commande) AS mois, COUNT(*) AS total, SUM(montant_total) AS chiffre "
-              "FROM commande WHERE YEAR(date_commande) = :year GROUP BY MONTH(date_commande) ORDER BY mois";
+    const QString driver = db.driverName();
+    QString monthExpr;
+    if (driver == "QMYSQL" || driver == "QODBC") {
+        monthExpr = "MONTH(date_commande)";
+    } else if (driver == "QSQLITE") {
+        monthExpr = "CAST(strftime('%m', date_commande) AS INTEGER)";
     } else {
         // generic fallback: Oracle would need EXTRACT(MONTH FROM date_commande)
-        sql = "SELECT EXTRACT(MONTH FROM date_commande) AS mois, COUNT(*) AS total, SUM(montant_total) AS chiffre "
-              "FROM commande WHERE EXTRACT(YEAR FROM date_commande) = :year GROUP BY EXTRACT(MONTH FROM date_commande) ORDER BY mois";
+        monthExpr = "EXTRACT(MONTH FROM date_commande)";
     }
-    q.prepare(sql);
-    q.bindValue(":year", year);
+
+    // Range on the raw column instead of YEAR(date_commande) so idx_commande_date is usable
+    return QString("SELECT %1 AS mois, COUNT(*) AS total, SUM(montant_total) AS chiffre "
+                   "FROM %2 co WHERE date_commande >= :start AND date_commande < :end "
+                   "GROUP BY %1 ORDER BY mois").arg(monthExpr, orders);
+}
+
+// Adds the rows of an ordersPerMonthSql() query to the month totals
+void addMonths(QSqlQuery &q, QVector<int> &orders, QVector<double> &revenue)
+{
+    while (q.next()) {
+        const int mois = q.value("mois").toInt() - 1;
+        if (mois >= 0 && mois < 12) {
+            orders[mois] += q.value("total").toInt();
+            revenue[mois] += q.value("chiffre").toDouble();
+        }
+    }
+}
+}
+
+QSqlQuery DatabaseManager::ordersPerMonth(int year)
+{
+    const QDate start(year, 1, 1);
+    QSqlDatabase db;
+    const QString orders = ordersSource(start, start.addYears(1).addDays(-1), &db);
+    QSqlQuery q(db);
+    q.prepare(ordersPerMonthSql(db, orders));
+    q.bindValue(":start", QDateTime(start, QTime(0, 0)));
+    q.bindValue(":end", QDateTime(start.addYears(1), QTime(0, 0)));
+    capturePlan("ordersPerMonth", db, q);
     if (!q.exec()) qWarning() << "ordersPerMonth failed:" << q.lastError().text();
     return q;
 }
 
+// Sum merge: every shard groups its own orders, the months are added up
+bool DatabaseManager::ordersPerMonth(int year, QVector<int> &orders, QVector<double> &revenue, QString *error)
+{
+    orders = QVector<int>(12, 0);
+    revenue = QVector<double>(12, 0.0);
+    if (!m_shards) {
+        QSqlQuery q = ordersPerMonth(year);
+        if (!q.isActive()) {
+            if (error)
+                *error = q.lastError().text();
+            return false;
+        }
+        addMonths(q, orders, revenue);
+        return true;
+    }
+
+    const QDate start(year, 1, 1);
+    QVector<QVector<int>> shardOrders(m_shards->count(), QVector<int>(12, 0));
+    QVector<QVector<double>> shardRevenue(m_shards->count(), QVector<double>(12, 0.0));
+    QVector<QSqlError> errors(m_shards->count());
+    m_shards->scatter([&start, &shardOrders, &shardRevenue, &errors](int shard, QSqlDatabase db) {
+        QSqlQuery q(db);
+        q.setForwardOnly(true);
+        q.prepare(ordersPerMonthSql(db, "commande"));
+        q.bindValue(":start", QDateTime(start, QTime(0, 0)));
+        q.bindValue(":end", QDateTime(start.addYears(1), QTime(0, 0)));
+        if (!q.exec()) {
+            errors[shard] = q.lastError();
+            return;
+        }
+        addMonths(q, shardOrders[shard], shardRevenue[shard]);
+    });
+
+    for (int shard = 0; shard < m_shards->count(); ++shard) {
+        if (errors.at(shard).isValid()) {
+            qWarning() << "ordersPerMonth failed on shard" << shard << errors.at(shard).text();
+            if (error)
+                *error = errors.at(shard).text();
+            return false;
+        }
+        for (int month = 0; month < 12; ++month) {
+            orders[month] += shardOrders.at(shard).at(month);
+            revenue[month] += shardRevenue.at(shard).at(month);
+        }
+    }
+    return true;
+}
+
 QSqlQuery DatabaseManager::getCommandesThisMonth()
 {
-    QSqlQuery q(m_db);
-    QDate currentDate = QDate::currentDate();
-    QDate firstDayOfMonth(currentDate.year(), currentDate.month(), 1);
+    return getCommandesForMonth(QDate::currentDate());
+}
+
+QSqlQuery DatabaseManager::getCommandesForMonth(const QDate &month, bool forwardOnly, bool withNames)
+{
+    QDate firstDayOfMonth(month.year(), month.month(), 1);
     QDate lastDayOfMonth = firstDayOfMonth.addMonths(1).addDays(-1);
+    QSqlDatabase db;
+    const QString orders = ordersSource(firstDayOfMonth, lastDayOfMonth, &db);
+    QSqlQuery q(db);
+    q.setForwardOnly(forwardOnly);
 
-    QString sql = "SELECT c.id_client, c.nom, c.prenom, co.id_commande, co.date_commande, co.statut, co.montant_total, co.moyen_paiement, co.remarque "
-                  "FROM client c JOIN commande co ON c.id_client = co.id_client "
-                  "WHERE co.date_commande BETWEEN :startDate AND :endDate "
-                  "ORDER BY co.date_commande DESC";
+    QString sql = withNames
+        ? "SELECT c.id_client, c.nom, c.prenom, co.id_commande, co.date_commande, co.statut, co.montant_total, co.moyen_paiement, co.remarque "
+          "FROM client c JOIN " + orders + " co ON c.id_client = co.id_client "
+        : "SELECT co.id_client, co.id_commande, co.date_commande, co.statut, co.montant_total, co.moyen_paiement, co.remarque "
+          "FROM " + orders + " co ";
+    sql += "WHERE co.date_commande BETWEEN :startDate AND :endDate "
+           "ORDER BY co.date_commande DESC";
 
     q.prepare(sql);
     q.bindValue(":startDate", QDateTime(firstDayOfMonth, QTime(0, 0, 0)));
     q.bindValue(":endDate", QDateTime(lastDayOfMonth, QTime(23, 59, 59)));
+    capturePlan("getCommandesForMonth", db, q);
+
+    if (!q.exec()) {
+        qWarning() << "getCommandesForMonth failed:" << q.lastError().text();
+    }
+    return q;
+}
+
+QSqlQuery DatabaseManager::getOrdersByClient(const QDate &fromDate, const QDate &toDate)
+{
+    QSqlDatabase db;
+    const QString orders = ordersSource(fromDate, toDate, &db);
+    QSqlQuery q(db);
+    q.setForwardOnly(true);
+    q.prepare("SELECT c.id_client, c.nom, c.prenom, c.email, co.id_commande, co.date_commande, co.statut, "
+              "co.montant_total, co.moyen_paiement, co.remarque "
+              "FROM " + orders + " co JOIN client c ON c.id_client = co.id_client "
+              "WHERE co.date_commande BETWEEN :startDate AND :endDate "
+              "ORDER BY co.id_client, co.date_commande");
+    q.bindValue(":startDate", QDateTime(fromDate, QTime(0, 0, 0)));
+    q.bindValue(":endDate", QDateTime(toDate, QTime(23, 59, 59)));
+    capturePlan("getOrdersByClient", db, q);
 
     if (!q.exec()) {
-        qWarning() << "getCommandesThisMonth failed:" << q.lastError().text();
+        qWarning() << "getOrdersByClient failed:" << q.lastError().text();
     }
     return q;
 }
+
+RowCursor<ClientRow> DatabaseManager::clientsCursor(int limit, const QVariantList &after)
+{
+    return RowCursor<ClientRow>(getClientsWithCommandCount(true, limit, after));
+}
+
+RowCursor<ClientRow> DatabaseManager::searchClientsCursor(const QString &textLike, int limit,
+                                                          const QVariantList &after)
+{
+    return RowCursor<ClientRow>(searchClients(textLike, true, limit, after));
+}
+
+RowCursor<CommandeRow> DatabaseManager::commandesCursor(const QString &clientNameLike, const QString &statut,
+                                                        const QDate &fromDate, const QDate &toDate,
+                                                        const QString &orderBy, int limit, const QVariantList &after,
+                                                        const OrderQuery &query)
+{
+    if (m_shards)
+        return shardedCommandes(clientNameLike, statut, fromDate, toDate, orderBy, limit, after, query);
+    RowCursor<CommandeRow> cursor(searchCommandes(clientNameLike, statut, fromDate, toDate, orderBy, true, limit,
+                                                  after, query, false));
+    fillClientNames(cursor);
+    return cursor;
+}
+
+RowCursor<CommandeRow> DatabaseManager::commandesForMonthCursor(const QDate &month)
+{
+    if (m_shards) {
+        const QDate first(month.year(), month.month(), 1);
+        return shardedCommandes(QString(), QString(), first, first.addMonths(1).addDays(-1), "date_desc", 0,
+                                QVariantList(), OrderQuery());
+    }
+    RowCursor<CommandeRow> cursor(getCommandesForMonth(month, true, false));
+    fillClientNames(cursor);
+    return cursor;
+}
+
+// The refresh reads the primary side, never the local replica: its clients
+// carry the stamps of the server they were copied from
+void DatabaseManager::fillClientNames(RowCursor<CommandeRow> &cursor)
+{
+    const QSqlDatabase db = serverReadDb();
+    m_clientNames.refresh(db);
+    cursor.setFill([this, db](CommandeRow &row) { m_clientNames.fill(db, row); });
+}
+
+RowCursor<CommandeRow> DatabaseManager::commandesByIdsCursor(const QList<int> &ids)
+{
+    if (m_shards)
+        return shardedCommandesByIds(ids);
+    return RowCursor<CommandeRow>(getCommandesByIds(ids));
+}
@@ -7,56 +7,342 @@
 #include <QSqlRecord>
 #include <QSqlQuery>
 #include <QSqlError>
+#include <functional>
+#include "RowCursor.h"
+#include "Entities.h"
+#include "ClientDimension.h"
+#include "OrderQuery.h"
+
+// Connection settings, read from the [database] group of QTcredit.ini
+struct DatabaseConfig
+{
+    QString driver = "QODBC";        // "QODBC", "QMYSQL" or "QSQLITE"
+    QString host = "localhost";
+    QString databaseName = "credit_db"; // schema name, or file path for QSQLITE
+    QString userName = "root";
+    QString password;
+    QString odbcConnection;          // full ODBC string, built from the fields above if empty
+
+    // SQLite tuning (ignored by the other drivers)
+    QString sqliteSynchronous = "NORMAL";
+    int sqliteCacheKb = 65536;
+    qint64 sqliteMmapBytes = 256LL * 1024 * 1024;
+    int sqliteBusyTimeoutMs = 5000;
+
+    // Qt connection name, the default connection if empty
+    QString connectionName;
+    // Create missing tables/indexes on open(); off for extra worker connections
+    bool manageSchema = true;
+
+    static DatabaseConfig load(const QString &group = "database");
+};
+
+// Settings of the [read_replica] group of QTcredit.ini: a replicated
+// server (or, to try it locally, a second SQLite file) serving the list,
+// statistics, report and export reads. Same connection keys as [database].
+struct ReadReplicaConfig
+{
+    bool enabled = false;
+    DatabaseConfig database;
+    int stickySeconds = 5; // reads stay on the primary this long after a write
+
+    static ReadReplicaConfig load(const QString &group = "read_replica");
+};
+
+class LocalReplica;
+struct ReplicaConfig;
+class OrderShards;
+struct ShardConfig;
 
 class DatabaseManager : public QObject
 {
     Q_OBJECT
 public:
     explicit DatabaseManager(QObject *parent = nullptr);
+    explicit DatabaseManager(const DatabaseConfig &config, QObject *parent = nullptr);
     ~DatabaseManager();
 
     bool open();
     void close();
 
+    bool isSqlite() const { return m_driver == "QSQLITE"; }
+    bool isMySql() const { return m_driver == "QMYSQL" || m_driver == "QODBC"; }
+
     // Add this method to get database connection
     QSqlDatabase getDatabase() const { return m_db; }
+    // Connection used for reads: the local replica once it is in sync, else
+    // the read replica, else the primary (see readDb())
+    QSqlDatabase getReadDatabase() const { return readDb(); }
+    const DatabaseConfig &config() const { return m_config; }
+
+    // Serve reads from a local SQLite copy kept in sync in the background
+    bool attachLocalReplica(const ReplicaConfig &replicaConfig);
+    LocalReplica *localReplica() const { return m_replica; }
+    // Reads through the replica another manager attached, on a connection
+    // of this thread; the owner must outlive this manager
+    bool shareLocalReplica(const ReplicaConfig &replicaConfig, const LocalReplica *replica);
+    QSqlDatabase getReplicaDatabase() const { return m_replicaDb; }
+
+    // Routes the reads to a read replica, on a connection of this thread.
+    // Writes always go to the primary, and so do the reads of every manager
+    // of the process for stickySeconds after any of them wrote.
+    bool attachReadReplica(const ReadReplicaConfig &replicaConfig);
+    QSqlDatabase getReadReplicaDatabase() const { return m_readReplicaDb; }
+
+    // Orders on the shards of shardConfig instead of the primary's commande
+    // (see OrderShards.h): order CRUD, the write-behind batches, bulk order
+    // updates, the order search and its cursors, ordersPerMonth and
+    // shardClientTotals go to the shards. The order exports, statements,
+    // client metrics, cohorts and status rules check orderShards() and
+    // read through these; the QSqlQuery order reads below only know the
+    // primary.
+    // False, with error set, if a shard cannot be opened, if a feature that
+    // only knows the primary's commande is enabled (ShardConfig::conflicts())
+    // or if the primary still holds orders, which the shards would hide.
+    bool attachShards(const ShardConfig &shardConfig, QString *error = nullptr);
+    OrderShards *orderShards() const { return m_shards; }
+
+    struct ClientTotals {
+        int count = 0;
+        double total = 0.0;
+        QVariant firstOrder;
+        QVariant lastOrder;
+    };
+    // Totals of clientIds (every client with orders if empty) over the shards
+    QHash<int, ClientTotals> shardClientTotals(const QList<int> &clientIds, bool *ok);
+
+    // Named (or default) connection with the driver options of config
+    static QSqlDatabase addConnection(const DatabaseConfig &config, const QString &connectionName);
+    // Creates the index if missing (MySQL has no CREATE INDEX IF NOT EXISTS)
+    static bool ensureIndex(QSqlDatabase db, const QString &table, const QString &name, const QString &columns);
+    // Runs migrate once per database: done migrations are recorded by name
+    // in schema_migration, with the data changes in the same transaction
+    static bool migrateOnce(QSqlDatabase db, const QString &name, const std::function<bool()> &migrate);
+    // Rewrites the emoji labels stored by older versions in statut and
+    // moyen_paiement of an order table to their codes (OrderCodes.h); a
+    // scan of the table, run through migrateOnce()
+    static bool normalizeOrderCodes(QSqlDatabase db, const QString &table);
+
+    // SQL expression for "now" with millisecond precision, matching updated_at
+    static QString nowExpression(const QSqlDatabase &db);
+    // SQL expression for year * 12 + month - 1 of a date column
+    static QString monthIndexExpression(const QSqlDatabase &db, const QString &column);
+
+    // Query plan, one line per step: EXPLAIN QUERY PLAN details on SQLite,
+    // "column=value" pairs of each EXPLAIN row on MySQL
+    static QStringList explainQuery(const QSqlDatabase &db, const QString &sql,
+                                    const QVariantList &binds = QVariantList());
+    // Tables read without any index in a plan from explainQuery()
+    static QStringList fullScans(const QStringList &plan);
+    // Diagnostic mode: the key queries record their plan before running
+    void setPlanCapture(bool enabled) { m_capturePlans = enabled; }
+    bool planCapture() const { return m_capturePlans; }
+    QMap<QString, QStringList> capturedPlans() const { return m_plans; }
+    void clearCapturedPlans() { m_plans.clear(); }
 
     // CLIENT CRUD
-    bool addClient(const QString &nom, const QString &prenom, const QString &email,
-                   const QString &telephone, const QString &adresse, qint64 &outId);
-    bool getClient(int id, QSqlRecord &outRecord);
-    bool updateClient(int id, const QString &nom, const QString &prenom, const QString &email,
-                      const QString &telephone, const QString &adresse);
+    // addClient sets client.idClient; updateClient writes every column but the key
+    bool addClient(Client &client);
+    bool getClient(qint64 id, Client &outClient);
+    bool updateClient(const Client &client);
     bool deleteClient(int id);
 
     // New client methods
-    QSqlQuery getClientsWithCommandCount();
+    // client.nb_commandes / total_montant / last_order_at are maintained by
+    // every order write, so these are plain scans of client
+    // forwardOnly: stream the rows instead of buffering them (exports)
+    // limit/after page like searchClients, after is (nb_commandes, id_client)
+    QSqlQuery getClientsWithCommandCount(bool forwardOnly = false, int limit = 0,
+                                         const QVariantList &after = QVariantList());
+    // Clients whose nom, prenom or email match the LIKE pattern ("%" = all),
+    // ignoring accents and case (compared on the search keys, see SearchKey.h).
+    // A pattern starting with "%@" is matched on the email only (domain
+    // search). Missing keys are filled first, at most once a minute.
+    // Keyset paging: at most limit rows (0 = all) after the row whose
+    // (nom, prenom, id_client) is after (empty = from the first one)
+    QSqlQuery searchClients(const QString &textLike, bool forwardOnly = false, int limit = 0,
+                            const QVariantList &after = QVariantList());
+    // Per-client order count, revenue and first/last order date in one grouped
+    // scan; all clients, or only clientIds (at most BulkChunkSize of them)
+    QSqlQuery getClientMetrics(const QList<int> &clientIds = QList<int>());
     double getTotalRevenueFromClient(int clientId);
     int getClientCommandCount(int clientId);
 
+    // Clients whose stored counters differ from their orders (archived ones included)
+    QList<int> checkClientCounters(bool *ok = nullptr);
+    // Recomputes the counters from commande: clientIds only, or every client
+    bool rebuildClientCounters(const QList<int> &clientIds = QList<int>());
+    // Fills nom_key / prenom_key / email_key of the clients written without
+    // them (rows from before the keys, or inserted by other tools)
+    bool fillSearchKeys();
+
     // COMMANDE CRUD
-    bool addCommande(int idClient, const QDateTime &dateCommande, const QString &statut,
-                     double montantTotal, const QString &moyenPaiement, const QString &remarque, qint64 &outId);
-    bool getCommande(int id, QSqlRecord &outRecord);
-    bool updateCommande(int id, const QString &statut, double montantTotal, const QString &moyenPaiement, const QString &remarque);
+    // updateCommande leaves id_client and date_commande unchanged
+    bool addCommande(Commande &commande);
+    bool getCommande(qint64 id, Commande &outCommande);
+    bool updateCommande(const Commande &commande);
     bool deleteCommande(int id);
 
+    // Saves of the write-behind queue (see WriteQueue.h) in one transaction:
+    // ids < 0 are inserted and get their new id, the others are updated.
+    // Clients go first; on failure nothing is written, except with shards:
+    // if the primary fails after the shards committed, the orders are saved
+    // and commandesWritten is set.
+    bool saveBatch(QList<Client> &clients, QList<Commande> &commandes, bool *commandesWritten = nullptr);
+    // Rows of these ids (at most BulkChunkSize), with the columns of the
+    // lists; read on the primary, the replica may not have them yet
+    QSqlQuery getClientsByIds(const QList<int> &ids);
+    QSqlQuery getCommandesByIds(const QList<int> &ids);
+
+    // Bulk operations on a selection: set-based statements (IN lists of at
+    // most BulkChunkSize ids) committed in a single transaction
+    static const int BulkChunkSize = 500;
+    bool deleteClients(const QList<int> &ids);
+    bool deleteCommandes(const QList<int> &ids);
+    bool updateCommandesStatut(const QList<int> &ids, const QString &statut);
+    bool updateCommandesPaiement(const QList<int> &ids, const QString &moyenPaiement);
+
+    // Order archive (see OrderArchive.h). The order queries below read
+    // commande_archive too only when their dates reach an archived order.
+    // Table expression for the orders of [fromDate, toDate] (invalid dates =
+    // open bounds), used as "<source> co"; db gets the connection to query,
+    // the primary or read replica when the archive is read (the local
+    // replica has no archive)
+    QString ordersSource(const QDate &fromDate, const QDate &toDate, QSqlDatabase *db = nullptr);
+    // Oldest orders dated before the cutoff, at most limit of them
+    QList<int> archivableCommandes(const QDateTime &before, int limit);
+    // Moves the orders to commande_archive in one transaction
+    bool archiveCommandes(const QList<int> &ids);
+    // Those of ids that are archived; the writes above only touch commande,
+    // so archived orders are read-only
+    QList<int> archivedCommandes(const QList<int> &ids, bool *ok = nullptr);
+
     // recherche / tri exemple (3 critères)
+    // orderBy: "date_desc", "montant_desc", "client_date" (by client, then
+    // date) or by date ascending otherwise.
+    // limit/after page like searchClients; after is (date_commande,
+    // id_commande) and only applies to "date_desc". clientNameLike is
+    // matched like searchClients() does, on nom_key. query is ANDed with the
+    // other criteria. Without names, only the commande columns are read (no
+    // join with client).
     QSqlQuery searchCommandes(const QString &clientNameLike,
                               const QString &statut,
                               const QDate &fromDate,
                               const QDate &toDate,
-                              const QString &orderBy);
+                              const QString &orderBy,
+                              bool forwardOnly = false,
+                              int limit = 0,
+                              const QVariantList &after = QVariantList(),
+                              const OrderQuery &query = OrderQuery(),
+                              bool withNames = true);
 
     // statistique: commandes par mois
     QSqlQuery ordersPerMonth(int year);
+    // Same as orders and revenue per month (12 entries each); with shards,
+    // the sum of every shard's
+    bool ordersPerMonth(int year, QVector<int> &orders, QVector<double> &revenue, QString *error = nullptr);
 
     // Get commands for current month for PDF export
     QSqlQuery getCommandesThisMonth();
+    // Same for any month (only year and month of the date are used)
+    QSqlQuery getCommandesForMonth(const QDate &month, bool forwardOnly = false, bool withNames = true);
+
+    // All orders of a period with their client, sorted by client then date,
+    // forward-only so it can be streamed (per-client statements)
+    QSqlQuery getOrdersByClient(const QDate &fromDate, const QDate &toDate);
+
+    // Typed forward-only cursors over the queries above, for row loops. The
+    // order cursors take the client names from memory (see ClientDimension.h)
+    RowCursor<ClientRow> clientsCursor(int limit = 0, const QVariantList &after = QVariantList());
+    RowCursor<ClientRow> searchClientsCursor(const QString &textLike, int limit = 0,
+                                             const QVariantList &after = QVariantList());
+    RowCursor<CommandeRow> commandesCursor(const QString &clientNameLike, const QString &statut,
+                                           const QDate &fromDate, const QDate &toDate, const QString &orderBy,
+                                           int limit = 0, const QVariantList &after = QVariantList(),
+                                           const OrderQuery &query = OrderQuery());
+    RowCursor<CommandeRow> commandesForMonthCursor(const QDate &month);
+    RowCursor<CommandeRow> commandesByIdsCursor(const QList<int> &ids);
+
+signals:
+    // Emitted after a committed write that changes a client or its order totals
+    void clientsChanged(const QList<int> &clientIds);
 
 private:
+    void applySqlitePragmas();
+    bool ensureSchema();
+    bool ensureIndex(const QString &table, const QString &name, const QString &columns);
+    bool ensureColumn(const QString &table, const QString &column, const QString &definition);
+    bool ensureChangeTracking();
+    bool ensureClientCounters();
+    bool ensureArchive();
+    bool ensureSearchKeys();
+
+    template <typename Entity> bool insertEntity(Entity &entity, const char *operation);
+    template <typename Entity> bool fetchEntity(qint64 id, Entity &outEntity, const char *operation);
+    template <typename Entity> bool updateEntity(const Entity &entity, const char *operation);
+
+    QSqlDatabase readDb() const;
+    // The read replica unless a recent write makes reads stick to the primary
+    QSqlDatabase serverReadDb() const;
+    // Every committed write ends here: marks the session, then clientsChanged
+    void wrote(const QList<int> &clientIds);
+    static qint64 sessionMs();
+    bool archiveReaches(const QDate &fromDate, const QDate &toDate);
+    bool recordDeletion(const QString &table, int rowId);
+    bool recordDeletions(const QString &table, const QList<int> &rowIds);
+    QList<int> clientIdsOfCommandes(const QList<int> &commandeIds);
+    void applyToReplica(const QString &sql, const QVariantMap &binds);
+    void capturePlan(const QString &name, const QSqlDatabase &db, const QSqlQuery &query);
+    // sql contains %1 for the IN list; binds come before the ids
+    static bool execForIds(QSqlDatabase db, const QString &sql, const QVariantList &binds, const QList<int> &ids);
+    // counterClients: clients whose counters the statement changes
+    bool runBulk(const char *operation, const QString &sql, const QVariantList &binds,
+                 const QList<int> &ids, const QString &tombstoneTable = QString(),
+                 const QList<int> &counterClients = QList<int>());
+    // Counters of clientIds (every client if empty), in the caller's transaction
+    static bool refreshClientCounters(QSqlDatabase db, const QList<int> &clientIds);
+    void refreshReplicaCounters(const QList<int> &clientIds);
+
+    // Order shards: the same operations on the shards owning the rows
+    // Counters of clientIds from the shards, in the caller's transaction on
+    // the primary (every client if empty)
+    bool refreshShardedCounters(const QList<int> &clientIds);
+    // Own transaction, after the shards committed; warns if it fails
+    void syncShardedCounters(const QList<int> &clientIds);
+    QList<int> shardedClientIdsOfCommandes(const QList<int> &commandeIds);
+    static bool insertShardCommande(OrderShards *shards, int shard, QSqlDatabase db, Commande &commande);
+    // Inserts (id < 0) and updates on the owning shards, all or none;
+    // clientIds gets the clients whose counters changed
+    bool saveShardCommandes(QList<Commande> &commandes, QList<int> &clientIds);
+    // No cascade across databases: the orders of deleted clients
+    void deleteShardOrders(const QList<int> &clientIds);
+    RowCursor<CommandeRow> shardedCommandes(const QString &clientNameLike, const QString &statut,
+                                            const QDate &fromDate, const QDate &toDate, const QString &orderBy,
+                                            int limit, const QVariantList &after, const OrderQuery &query);
+    RowCursor<CommandeRow> shardedCommandesByIds(const QList<int> &ids);
+    // nom/prenom of rows read from the shards, from m_clientNames
+    void readClientNames(QVector<CommandeRow> &rows);
+    // Brings m_clientNames up to date and fills the names of the cursor's rows
+    void fillClientNames(RowCursor<CommandeRow> &cursor);
+
+    DatabaseConfig m_config;
     QSqlDatabase m_db;
-    QString m_driver; // "QMYSQL" or "QODBC"
+    QString m_driver; // "QMYSQL", "QODBC" or "QSQLITE"
+
+    LocalReplica *m_replica = nullptr;
+    const LocalReplica *m_sharedReplica = nullptr;
+    QSqlDatabase m_replicaDb;
+
+    QSqlDatabase m_readReplicaDb;
+    qint64 m_stickyMs = 0;
+    qint64 m_keysFilledMs = -1; // sessionMs() of the last fillSearchKeys() by searchClients()
+
+    OrderShards *m_shards = nullptr;
+    ClientDimension m_clientNames;
+    static QAtomicInteger<qint64> s_lastWriteMs; // sessionMs() of the last commit, -1 before any
+
+    bool m_capturePlans = false;
+    QMap<QString, QStringList> m_plans; // query name -> last captured plan
 };
 
 #endif // DATABASEMANAGER_H
@@ -0,0 +1,260 @@
+#ifndef ENTITIES_H
+#define ENTITIES_H
+
+#include <QSqlQuery>
+#include <QDateTime>
+#include <QVariantMap>
+#include <QStringList>
+#include <tuple>
+#include <type_traits>
+#include "SearchKey.h"
+
+// Value types for the client and commande tables. Each one has a
+// compile-time description in EntityTraits: table name, primary key and the
+// other columns in bind order. The SQL text and the bind/read code below are
+// generated from it, so nothing is looked up by name at run time.
+// Derived columns are computed from the entity on every write and never
+// read back.
+struct Client
+{
+    qint64 idClient = -1;
+    QString nom;
+    QString prenom;
+    QString email;
+    QString telephone;
+    QString adresse;
+};
+
+struct Commande
+{
+    qint64 idCommande = -1;
+    qint64 idClient = -1;
+    QDateTime dateCommande;
+    QString statut;
+    double montantTotal = 0.0;
+    QString moyenPaiement;
+    QString remarque;
+};
+
+// One column: its name, the member holding it, and whether an UPDATE may change it
+template <typename Entity, typename T>
+struct Field
+{
+    const char *column;
+    T Entity::*member;
+    bool updatable = true;
+};
+
+// A column computed from the other fields when the row is written
+template <typename Entity>
+struct Derived
+{
+    const char *column;
+    QString (*compute)(const Entity &);
+};
+
+template <typename Entity>
+struct EntityTraits;
+
+template <>
+struct EntityTraits<Client>
+{
+    static constexpr const char *table = "client";
+    static constexpr Field<Client, qint64> key{"id_client", &Client::idClient};
+    static constexpr auto fields = std::make_tuple(
+        Field<Client, QString>{"nom", &Client::nom},
+        Field<Client, QString>{"prenom", &Client::prenom},
+        Field<Client, QString>{"email", &Client::email},
+        Field<Client, QString>{"telephone", &Client::telephone},
+        Field<Client, QString>{"adresse", &Client::adresse});
+
+    // Search keys of searchClients()
+    static QString nomKey(const Client &client) { return SearchKey::normalize(client.nom); }
+    static QString prenomKey(const Client &client) { return SearchKey::normalize(client.prenom); }
+    static QString emailKey(const Client &client) { return SearchKey::normalize(client.email); }
+    static constexpr auto derived = std::make_tuple(
+        Derived<Client>{"nom_key", &nomKey},
+        Derived<Client>{"prenom_key", &prenomKey},
+        Derived<Client>{"email_key", &emailKey});
+};
+
+template <>
+struct EntityTraits<Commande>
+{
+    static constexpr const char *table = "commande";
+    static constexpr Field<Commande, qint64> key{"id_commande", &Commande::idCommande};
+    // An order keeps its client and date once created
+    static constexpr auto fields = std::make_tuple(
+        Field<Commande, qint64>{"id_client", &Commande::idClient, false},
+        Field<Commande, QDateTime>{"date_commande", &Commande::dateCommande, false},
+        Field<Commande, QString>{"statut", &Commande::statut},
+        Field<Commande, double>{"montant_total", &Commande::montantTotal},
+        Field<Commande, QString>{"moyen_paiement", &Commande::moyenPaiement},
+        Field<Commande, QString>{"remarque", &Commande::remarque});
+    static constexpr auto derived = std::make_tuple();
+};
+
+namespace EntitySql {
+
+template <typename Entity, typename Fn>
+void forEachField(Fn &&fn)
+{
+    std::apply([&fn](const auto &...field) { (fn(field), ...); }, EntityTraits<Entity>::fields);
+}
+
+template <typename Entity, typename Fn>
+void forEachDerived(Fn &&fn)
+{
+    std::apply([&fn](const auto &...derived) { (fn(derived), ...); }, EntityTraits<Entity>::derived);
+}
+
+template <typename Entity>
+QStringList columns(bool updatableOnly = false)
+{
+    QStringList names;
+    forEachField<Entity>([&names, updatableOnly](const auto &field) {
+        if (!updatableOnly || field.updatable)
+            names << QString::fromLatin1(field.column);
+    });
+    return names;
+}
+
+// columns() plus the derived columns, for the statements that write
+template <typename Entity>
+QStringList writtenColumns(bool updatableOnly = false)
+{
+    QStringList names = columns<Entity>(updatableOnly);
+    forEachDerived<Entity>([&names](const auto &derived) { names << QString::fromLatin1(derived.column); });
+    return names;
+}
+
+// Statements are built on first use and kept for the life of the program
+
+// SELECT key, fields... FROM table WHERE key = :key
+template <typename Entity>
+const QString &selectByKey()
+{
+    static const QString sql = [] {
+        using Traits = EntityTraits<Entity>;
+        const QString key = QString::fromLatin1(Traits::key.column);
+        return QString("SELECT %1, %2 FROM %3 WHERE %1 = :%1")
+            .arg(key, columns<Entity>().join(", "), QString::fromLatin1(Traits::table));
+    }();
+    return sql;
+}
+
+// INSERT INTO table (fields...) VALUES (:fields...), key left to the database
+template <typename Entity>
+const QString &insert()
+{
+    static const QString sql = [] {
+        const QStringList names = writtenColumns<Entity>();
+        return QString("INSERT INTO %1 (%2) VALUES (:%3)")
+            .arg(QString::fromLatin1(EntityTraits<Entity>::table), names.join(", "), names.join(", :"));
+    }();
+    return sql;
+}
+
+// INSERT INTO table (key, fields...) VALUES (:key, :fields...), key chosen
+// by the caller (order shards)
+template <typename Entity>
+const QString &insertWithKey()
+{
+    static const QString sql = [] {
+        using Traits = EntityTraits<Entity>;
+        const QString key = QString::fromLatin1(Traits::key.column);
+        const QStringList names = writtenColumns<Entity>();
+        return QString("INSERT INTO %1 (%2, %3) VALUES (:%2, :%4)")
+            .arg(QString::fromLatin1(Traits::table), key, names.join(", "), names.join(", :"));
+    }();
+    return sql;
+}
+
+// INSERT with an explicit key that updates the row if it already exists
+// (SQLite replica; REPLACE would cascade-delete child rows)
+template <typename Entity>
+const QString &upsert()
+{
+    static const QString sql = [] {
+        using Traits = EntityTraits<Entity>;
+        const QString key = QString::fromLatin1(Traits::key.column);
+        const QStringList names = writtenColumns<Entity>();
+        QStringList assignments;
+        for (const QString &name : names)
+            assignments << name + " = excluded." + name;
+        return QString("INSERT INTO %1 (%2, %3) VALUES (:%2, :%4) ON CONFLICT(%2) DO UPDATE SET %5")
+            .arg(QString::fromLatin1(Traits::table), key, names.join(", "), names.join(", :"),
+                 assignments.join(", "));
+    }();
+    return sql;
+}
+
+// UPDATE table SET updatable fields WHERE key = :key
+template <typename Entity>
+const QString &update()
+{
+    static const QString sql = [] {
+        using Traits = EntityTraits<Entity>;
+        const QString key = QString::fromLatin1(Traits::key.column);
+        QStringList assignments;
+        for (const QString &name : writtenColumns<Entity>(true))
+            assignments << name + " = :" + name;
+        return QString("UPDATE %1 SET %2 WHERE %3 = :%3")
+            .arg(QString::fromLatin1(Traits::table), assignments.join(", "), key);
+    }();
+    return sql;
+}
+
+// updatableOnly: only the placeholders of update()
+template <typename Entity>
+void bindFields(QSqlQuery &query, const Entity &entity, bool updatableOnly = false)
+{
+    forEachField<Entity>([&query, &entity, updatableOnly](const auto &field) {
+        if (!updatableOnly || field.updatable)
+            query.bindValue(QString(":") + QString::fromLatin1(field.column), QVariant::fromValue(entity.*(field.member)));
+    });
+    forEachDerived<Entity>([&query, &entity](const auto &derived) {
+        query.bindValue(QString(":") + QString::fromLatin1(derived.column), derived.compute(entity));
+    });
+}
+
+template <typename Entity>
+void bindKey(QSqlQuery &query, const Entity &entity)
+{
+    const auto &key = EntityTraits<Entity>::key;
+    query.bindValue(QString(":") + QString::fromLatin1(key.column), QVariant::fromValue(entity.*(key.member)));
+}
+
+// Same values as bindFields + bindKey, for applyToReplica()
+template <typename Entity>
+QVariantMap values(const Entity &entity, bool updatableOnly = false)
+{
+    QVariantMap map;
+    const auto &key = EntityTraits<Entity>::key;
+    map.insert(QString::fromLatin1(key.column), QVariant::fromValue(entity.*(key.member)));
+    forEachField<Entity>([&map, &entity, updatableOnly](const auto &field) {
+        if (!updatableOnly || field.updatable)
+            map.insert(QString::fromLatin1(field.column), QVariant::fromValue(entity.*(field.member)));
+    });
+    forEachDerived<Entity>([&map, &entity](const auto &derived) {
+        map.insert(QString::fromLatin1(derived.column), derived.compute(entity));
+    });
+    return map;
+}
+
+// Reads the current row of a selectByKey() query: key at 0, then the fields in order
+template <typename Entity>
+void read(const QSqlQuery &query, Entity &entity)
+{
+    const auto &key = EntityTraits<Entity>::key;
+    entity.*(key.member) = query.value(0).toLongLong();
+    int column = 1;
+    forEachField<Entity>([&query, &entity, &column](const auto &field) {
+        using T = std::decay_t<decltype(entity.*(field.member))>;
+        entity.*(field.member) = query.value(column++).value<T>();
+    });
+}
+
+} // namespace EntitySql
+
+#endif // ENTITIES_H
@@ -0,0 +1,298 @@
+#include "LocalReplica.h"
+#include "AppSettings.h"
+#include <QDebug>
+#include <QSettings>
+#include <QSqlRecord>
+
+namespace {
+const char *StampFormat = "yyyy-MM-ddTHH:mm:ss.zzz";
+const char *EpochStamp = "1970-01-01T00:00:00.000";
+
+// updated_at is a QDateTime on MySQL and ISO text on SQLite; keep one text form
+QString toStamp(const QVariant &value)
+{
+    if (value.metaType().id() == QMetaType::QDateTime)
+        return value.toDateTime().toString(StampFormat);
+    return value.toString();
+}
+}
+
+ReplicaConfig ReplicaConfig::load(const QString &group)
+{
+    ReplicaConfig config;
+    QSettings settings(AppSettings::filePath(), QSettings::IniFormat);
+    settings.beginGroup(group);
+    config.enabled = settings.value("enabled", config.enabled).toBool();
+    config.path = settings.value("path", config.path).toString();
+    config.intervalMs = settings.value("interval_ms", config.intervalMs).toInt();
+    config.overlapSeconds = settings.value("overlap_s", config.overlapSeconds).toInt();
+    config.batchSize = settings.value("batch_size", config.batchSize).toInt();
+    settings.endGroup();
+    return config;
+}
+
+// ---- ReplicaSyncWorker ----
+ReplicaSyncWorker::ReplicaSyncWorker(const DatabaseConfig &primaryConfig, const ReplicaConfig &replicaConfig)
+    : m_primaryConfig(primaryConfig), m_replicaConfig(replicaConfig)
+{
+    m_primaryConfig.connectionName = "replica_sync_primary";
+    m_primaryConfig.manageSchema = false;
+}
+
+void ReplicaSyncWorker::start()
+{
+    // Connections are created here so they belong to the sync thread
+    m_primary = new DatabaseManager(m_primaryConfig, this);
+    m_local = new DatabaseManager(LocalReplica::localDatabaseConfig(m_replicaConfig, "replica_sync_local"), this);
+    if (!m_primary->open() || !m_local->open() || !ensureStateTable()) {
+        emit syncFailed("Ouverture des bases du réplica impossible");
+        return;
+    }
+
+    // Clients and orders may arrive in either order between two pulls
+    QSqlQuery pragma(m_local->getDatabase());
+    pragma.exec("PRAGMA foreign_keys = OFF");
+
+    m_timer = new QTimer(this);
+    m_timer->setInterval(m_replicaConfig.intervalMs);
+    connect(m_timer, &QTimer::timeout, this, &ReplicaSyncWorker::syncOnce);
+    m_timer->start();
+    syncOnce();
+}
+
+void ReplicaSyncWorker::syncOnce()
+{
+    bool ok = true;
+    const int clients = pullTable("client", "id_client", ok);
+    const int commandes = ok ? pullTable("commande", "id_commande", ok) : 0;
+    const int deletions = ok ? pullDeletions(ok) : 0;
+
+    if (ok)
+        emit synced(clients, commandes, deletions);
+    else
+        emit syncFailed("Synchronisation du réplica interrompue");
+}
+
+bool ReplicaSyncWorker::ensureStateTable()
+{
+    QSqlQuery q(m_local->getDatabase());
+    if (!q.exec("CREATE TABLE IF NOT EXISTS sync_state ("
+                " table_name TEXT PRIMARY KEY,"
+                " high_water TEXT,"
+                " last_id INTEGER NOT NULL DEFAULT 0)")) {
+        qWarning() << "sync_state creation failed:" << q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+QVariant ReplicaSyncWorker::timestampParam(const QVariant &value, int secondsBack) const
+{
+    QDateTime stamp = QDateTime::fromString(value.toString(), StampFormat);
+    if (!stamp.isValid())
+        stamp = QDateTime::fromString(EpochStamp, StampFormat);
+    stamp = stamp.addSecs(-secondsBack);
+
+    if (m_primary->isSqlite())
+        return stamp.toString(StampFormat);
+    return stamp;
+}
+
+int ReplicaSyncWorker::pullTable(const QString &table, const QString &primaryKey, bool &ok)
+{
+    QSqlDatabase local = m_local->getDatabase();
+
+    QSqlQuery state(local);
+    state.prepare("SELECT high_water, last_id FROM sync_state WHERE table_name = :table");
+    state.bindValue(":table", table);
+    QString highWater = EpochStamp;
+    if (state.exec() && state.next())
+        highWater = state.value(0).toString();
+
+    // Rewind by the overlap window: rows stamped just before the last pull may
+    // have committed after it. Upserts make the re-read idempotent.
+    QVariant cursorStamp = timestampParam(highWater, m_replicaConfig.overlapSeconds);
+    qint64 cursorId = 0;
+    int pulled = 0;
+
+    const QSqlRecord localColumns = local.record(table);
+    const QString select = QString("SELECT * FROM %1 "
+                                   "WHERE updated_at > :stamp OR (updated_at = :stamp AND %2 > :lastId) "
+                                   "ORDER BY updated_at, %2 LIMIT %3")
+                               .arg(table, primaryKey)
+                               .arg(m_replicaConfig.batchSize);
+
+    while (true) {
+        QSqlQuery page(m_primary->getDatabase());
+        page.setForwardOnly(true);
+        page.prepare(select);
+        page.bindValue(":stamp", cursorStamp);
+        page.bindValue(":lastId", cursorId);
+        if (!page.exec()) {
+            qWarning() << "Replica pull failed:" << table << page.lastError().text();
+            ok = false;
+            return pulled;
+        }
+
+        // Upsert on the columns both sides know about
+        const QSqlRecord remoteColumns = page.record();
+        QStringList columns;
+        QVector<int> remoteIndexes;
+        for (int i = 0; i < remoteColumns.count(); ++i) {
+            if (localColumns.contains(remoteColumns.fieldName(i))) {
+                columns << remoteColumns.fieldName(i);
+                remoteIndexes << i;
+            }
+        }
+        QStringList placeholders, assignments;
+        for (const QString &column : columns) {
+            placeholders << ":" + column;
+            if (column != primaryKey)
+                assignments << QString("%1 = excluded.%1").arg(column);
+        }
+        const int updatedAtIndex = remoteColumns.indexOf("updated_at");
+        const int keyIndex = remoteColumns.indexOf(primaryKey);
+
+        local.transaction();
+        QSqlQuery upsert(local);
+        upsert.prepare(QString("INSERT INTO %1 (%2) VALUES (%3) ON CONFLICT(%4) DO UPDATE SET %5")
+                           .arg(table, columns.join(", "), placeholders.join(", "), primaryKey, assignments.join(", ")));
+
+        int rows = 0;
+        QString lastStamp = highWater;
+        while (page.next()) {
+            for (int c = 0; c < columns.size(); ++c) {
+                QVariant value = page.value(remoteIndexes.at(c));
+                if (columns.at(c) == "updated_at")
+                    value = toStamp(value);
+                upsert.bindValue(c, value);
+            }
+            if (!upsert.exec()) {
+                qWarning() << "Replica upsert failed:" << table << upsert.lastError().text();
+                local.rollback();
+                ok = false;
+                return pulled;
+            }
+            lastStamp = toStamp(page.value(updatedAtIndex));
+            cursorId = page.value(keyIndex).toLongLong();
+            ++rows;
+        }
+
+        if (rows > 0) {
+            // Only move forward: the overlap re-read must not lower the mark
+            if (lastStamp > highWater)
+                highWater = lastStamp;
+            QSqlQuery save(local);
+            save.prepare("INSERT INTO sync_state (table_name, high_water, last_id) VALUES (:table, :stamp, :lastId) "
+                         "ON CONFLICT(table_name) DO UPDATE SET high_water = excluded.high_water, last_id = excluded.last_id");
+            save.bindValue(":table", table);
+            save.bindValue(":stamp", highWater);
+            save.bindValue(":lastId", cursorId);
+            save.exec();
+            cursorStamp = timestampParam(lastStamp, 0);
+        }
+        local.commit();
+
+        pulled += rows;
+        if (rows < m_replicaConfig.batchSize)
+            break;
+    }
+    return pulled;
+}
+
+int ReplicaSyncWorker::pullDeletions(bool &ok)
+{
+    QSqlDatabase local = m_local->getDatabase();
+
+    QSqlQuery state(local);
+    state.prepare("SELECT last_id FROM sync_state WHERE table_name = 'deleted_row'");
+    qint64 lastId = 0;
+    if (state.exec() && state.next())
+        lastId = state.value(0).toLongLong();
+
+    int applied = 0;
+    while (true) {
+        QSqlQuery page(m_primary->getDatabase());
+        page.setForwardOnly(true);
+        page.prepare(QString("SELECT id, table_name, row_id FROM deleted_row WHERE id > :lastId ORDER BY id LIMIT %1")
+                         .arg(m_replicaConfig.batchSize));
+        page.bindValue(":lastId", lastId);
+        if (!page.exec()) {
+            qWarning() << "Replica deletion pull failed:" << page.lastError().text();
+            ok = false;
+            return applied;
+        }
+
+        local.transaction();
+        QSqlQuery del(local);
+        int rows = 0;
+        while (page.next()) {
+            const QString table = page.value(1).toString();
+            const int rowId = page.value(2).toInt();
+            if (table == "client") {
+                // Foreign keys are off on this connection, cascade by hand
+                del.prepare("DELETE FROM commande WHERE id_client = :id");
+                del.bindValue(":id", rowId);
+                del.exec();
+                del.prepare("DELETE FROM client WHERE id_client = :id");
+            } else {
+                del.prepare("DELETE FROM commande WHERE id_commande = :id");
+            }
+            del.bindValue(":id", rowId);
+            del.exec();
+            lastId = page.value(0).toLongLong();
+            ++rows;
+        }
+
+        if (rows > 0) {
+            QSqlQuery save(local);
+            save.prepare("INSERT INTO sync_state (table_name, last_id) VALUES ('deleted_row', :lastId) "
+                         "ON CONFLICT(table_name) DO UPDATE SET last_id = excluded.last_id");
+            save.bindValue(":lastId", lastId);
+            save.exec();
+        }
+        local.commit();
+
+        applied += rows;
+        if (rows < m_replicaConfig.batchSize)
+            break;
+    }
+    return applied;
+}
+
+// ---- LocalReplica ----
+LocalReplica::LocalReplica(const DatabaseConfig &primaryConfig, const ReplicaConfig &replicaConfig, QObject *parent)
+    : QObject(parent),
+    m_worker(new ReplicaSyncWorker(primaryConfig, replicaConfig))
+{
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::started, m_worker, &ReplicaSyncWorker::start);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    connect(m_worker, &ReplicaSyncWorker::synced, this, [this](int clients, int commandes, int deletions) {
+        m_ready.storeRelease(true);
+        emit synced(clients, commandes, deletions);
+    });
+    connect(m_worker, &ReplicaSyncWorker::syncFailed, this, [](const QString &error) {
+        qWarning() << "Local replica:" << error;
+    });
+}
+
+LocalReplica::~LocalReplica()
+{
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void LocalReplica::start()
+{
+    m_thread.start();
+}
+
+DatabaseConfig LocalReplica::localDatabaseConfig(const ReplicaConfig &replicaConfig, const QString &connectionName)
+{
+    DatabaseConfig config;
+    config.driver = "QSQLITE";
+    config.databaseName = replicaConfig.path;
+    config.connectionName = connectionName;
+    return config;
+}
@@ -0,0 +1,75 @@
+#ifndef LOCALREPLICA_H
+#define LOCALREPLICA_H
+
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QVariant>
+#include <QAtomicInteger>
+#include "DatabaseManager.h"
+
+// Settings of the [replica_local] group of QTcredit.ini
+struct ReplicaConfig
+{
+    bool enabled = false;
+    QString path;              // SQLite file holding the copy of client/commande
+    int intervalMs = 2000;     // delay between two delta pulls
+    int overlapSeconds = 5;    // re-read window for transactions that committed late
+    int batchSize = 2000;      // rows per page and per local transaction
+
+    static ReplicaConfig load(const QString &group = "replica_local");
+};
+
+// Runs in the sync thread with its own primary and local connections
+class ReplicaSyncWorker : public QObject
+{
+    Q_OBJECT
+public:
+    ReplicaSyncWorker(const DatabaseConfig &primaryConfig, const ReplicaConfig &replicaConfig);
+
+public slots:
+    void start();
+    void syncOnce();
+
+signals:
+    void synced(int clients, int commandes, int deletions);
+    void syncFailed(const QString &error);
+
+private:
+    bool ensureStateTable();
+    int pullTable(const QString &table, const QString &primaryKey, bool &ok);
+    int pullDeletions(bool &ok);
+    QVariant timestampParam(const QVariant &value, int secondsBack) const;
+
+    DatabaseConfig m_primaryConfig;
+    ReplicaConfig m_replicaConfig;
+    DatabaseManager *m_primary = nullptr;
+    DatabaseManager *m_local = nullptr;
+    QTimer *m_timer = nullptr;
+};
+
+// Keeps a local SQLite copy of client and commande in sync with the primary.
+// Reads can be served from it once the first pull of this session is done.
+class LocalReplica : public QObject
+{
+    Q_OBJECT
+public:
+    LocalReplica(const DatabaseConfig &primaryConfig, const ReplicaConfig &replicaConfig, QObject *parent = nullptr);
+    ~LocalReplica();
+
+    void start();
+    // Thread-safe: search workers read through the replica too
+    bool isReady() const { return m_ready.loadAcquire(); }
+
+    static DatabaseConfig localDatabaseConfig(const ReplicaConfig &replicaConfig, const QString &connectionName);
+
+signals:
+    void synced(int clients, int commandes, int deletions);
+
+private:
+    QThread m_thread;
+    ReplicaSyncWorker *m_worker;
+    QAtomicInteger<bool> m_ready = false;
+};
+
+#endif // LOCALREPLICA_H
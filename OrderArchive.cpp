@@ -0,0 +1,130 @@
+#include "OrderArchive.h"
+#include "AppSettings.h"
+#include <QDebug>
+#include <QSettings>
+
+QDateTime ArchiveConfig::cutoff() const
+{
+    const QDate today = QDate::currentDate();
+    return QDateTime(QDate(today.year(), today.month(), 1).addMonths(-horizonMonths), QTime(0, 0));
+}
+
+ArchiveConfig ArchiveConfig::load(const QString &group)
+{
+    ArchiveConfig config;
+    QSettings settings(AppSettings::filePath(), QSettings::IniFormat);
+    settings.beginGroup(group);
+    config.enabled = settings.value("enabled", config.enabled).toBool();
+    config.horizonMonths = qMax(1, settings.value("horizon_months", config.horizonMonths).toInt());
+    config.chunkSize = qMax(1, settings.value("chunk_size", config.chunkSize).toInt());
+    config.pauseMs = qMax(0, settings.value("pause_ms", config.pauseMs).toInt());
+    config.intervalMinutes = settings.value("interval_min", config.intervalMinutes).toInt();
+    settings.endGroup();
+    return config;
+}
+
+// ---- OrderArchiver ----
+int OrderArchiver::countArchivable(DatabaseManager &db, const ArchiveConfig &config, bool *ok)
+{
+    QSqlQuery q(db.getDatabase());
+    q.prepare("SELECT COUNT(*) FROM commande WHERE date_commande < :cutoff");
+    q.bindValue(":cutoff", config.cutoff());
+    const bool success = q.exec() && q.next();
+    if (!success)
+        qWarning() << "countArchivable failed:" << q.lastError().text();
+    if (ok)
+        *ok = success;
+    return success ? q.value(0).toInt() : 0;
+}
+
+OrderArchiver::Outcome OrderArchiver::run(DatabaseManager &db, const ArchiveConfig &config, bool dryRun,
+                                          const std::function<bool()> &keepGoing)
+{
+    Outcome outcome;
+    outcome.archivable = countArchivable(db, config, &outcome.ok);
+    if (!outcome.ok || dryRun)
+        return outcome;
+
+    // Short transactions: interactive writes wait at most one chunk
+    const QDateTime cutoff = config.cutoff();
+    while (outcome.moved < outcome.archivable) {
+        const QList<int> ids = db.archivableCommandes(cutoff, config.chunkSize);
+        if (ids.isEmpty())
+            break;
+        if (!db.archiveCommandes(ids)) {
+            outcome.ok = false;
+            break;
+        }
+        outcome.moved += ids.size();
+        if (ids.size() < config.chunkSize || (keepGoing && !keepGoing()))
+            break;
+        if (config.pauseMs > 0)
+            QThread::msleep(config.pauseMs);
+    }
+    return outcome;
+}
+
+// ---- ArchiveWorker ----
+ArchiveWorker::ArchiveWorker(const DatabaseConfig &databaseConfig, const ArchiveConfig &archiveConfig)
+    : m_databaseConfig(databaseConfig), m_archiveConfig(archiveConfig)
+{
+    m_databaseConfig.connectionName = "order_archive";
+    m_databaseConfig.manageSchema = false;
+}
+
+void ArchiveWorker::start()
+{
+    // The connection is created here so it belongs to the archive thread
+    m_db = new DatabaseManager(m_databaseConfig, this);
+    if (!m_db->open()) {
+        emit failed("Connexion de l'archivage impossible");
+        return;
+    }
+
+    m_timer = new QTimer(this);
+    m_timer->setInterval(qMax(1, m_archiveConfig.intervalMinutes) * 60 * 1000);
+    connect(m_timer, &QTimer::timeout, this, &ArchiveWorker::runOnce);
+    m_timer->start();
+    runOnce();
+}
+
+void ArchiveWorker::runOnce()
+{
+    // Stops between chunks when the application quits
+    QThread *thread = QThread::currentThread();
+    const OrderArchiver::Outcome outcome = OrderArchiver::run(*m_db, m_archiveConfig, false, [thread]() {
+        return !thread->isInterruptionRequested();
+    });
+
+    if (!outcome.ok)
+        emit failed("Archivage des commandes interrompu");
+    if (outcome.moved > 0)
+        emit archived(outcome.moved);
+}
+
+// ---- ArchiveScheduler ----
+ArchiveScheduler::ArchiveScheduler(const DatabaseConfig &databaseConfig, const ArchiveConfig &archiveConfig,
+                                   QObject *parent)
+    : QObject(parent),
+    m_worker(new ArchiveWorker(databaseConfig, archiveConfig))
+{
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::started, m_worker, &ArchiveWorker::start);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    connect(m_worker, &ArchiveWorker::archived, this, &ArchiveScheduler::archived);
+    connect(m_worker, &ArchiveWorker::failed, this, [](const QString &error) {
+        qWarning() << "Order archive:" << error;
+    });
+}
+
+ArchiveScheduler::~ArchiveScheduler()
+{
+    m_thread.requestInterruption();
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void ArchiveScheduler::start()
+{
+    m_thread.start();
+}
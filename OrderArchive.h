@@ -0,0 +1,85 @@
+#ifndef ORDERARCHIVE_H
+#define ORDERARCHIVE_H
+
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QDateTime>
+#include <functional>
+#include "DatabaseManager.h"
+
+// Settings of the [archive] group of QTcredit.ini
+struct ArchiveConfig
+{
+    bool enabled = false;      // run in the background
+    int horizonMonths = 24;    // orders older than this many whole months move out
+    int chunkSize = 1000;      // orders per transaction
+    int pauseMs = 200;         // between chunks, leaves room for interactive writes
+    int intervalMinutes = 24 * 60;
+
+    // First day of the month horizonMonths before the current one: the
+    // boundary stays put for a whole month
+    QDateTime cutoff() const;
+
+    static ArchiveConfig load(const QString &group = "archive");
+};
+
+// Moves orders past the horizon from commande to commande_archive, oldest
+// first, one transaction per chunk
+class OrderArchiver
+{
+public:
+    struct Outcome {
+        int archivable = 0; // orders past the horizon before the run
+        int moved = 0;      // 0 in dry-run
+        bool ok = true;
+    };
+
+    // keepGoing is checked between chunks; returning false stops the run
+    static Outcome run(DatabaseManager &db, const ArchiveConfig &config, bool dryRun,
+                       const std::function<bool()> &keepGoing = {});
+    static int countArchivable(DatabaseManager &db, const ArchiveConfig &config, bool *ok = nullptr);
+};
+
+// Runs in the archive thread with its own connection
+class ArchiveWorker : public QObject
+{
+    Q_OBJECT
+public:
+    ArchiveWorker(const DatabaseConfig &databaseConfig, const ArchiveConfig &archiveConfig);
+
+public slots:
+    void start();
+    void runOnce();
+
+signals:
+    void archived(int moved);
+    void failed(const QString &error);
+
+private:
+    DatabaseConfig m_databaseConfig;
+    ArchiveConfig m_archiveConfig;
+    DatabaseManager *m_db = nullptr;
+    QTimer *m_timer = nullptr;
+};
+
+// Archives on a timer in a background thread
+class ArchiveScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    ArchiveScheduler(const DatabaseConfig &databaseConfig, const ArchiveConfig &archiveConfig,
+                     QObject *parent = nullptr);
+    ~ArchiveScheduler();
+
+    void start();
+
+signals:
+    void archived(int moved);
+
+private:
+    QThread m_thread;
+    ArchiveWorker *m_worker;
+};
+
+#endif // ORDERARCHIVE_H
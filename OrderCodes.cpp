@@ -0,0 +1,65 @@
+#include "OrderCodes.h"
+#include "SearchKey.h"
+#include <QHash>
+
+namespace {
+const QHash<QString, QString> &labels()
+{
+    static const QHash<QString, QString> labels = {
+        {"EN_COURS", "🟡 EN_COURS"}, {"LIVRE", "🟢 LIVRE"}, {"ANNULE", "🔴 ANNULE"},
+        {"Carte Bancaire", "💳 Carte Bancaire"}, {"Espèces", "💵 Espèces"},
+        {"Chèque", "📄 Chèque"}, {"Virement", "🏦 Virement"},
+    };
+    return labels;
+}
+
+// Drops the emoji and spaces in front of a label, then folds it
+QString key(const QString &value)
+{
+    int start = 0;
+    while (start < value.size() && !value.at(start).isLetterOrNumber())
+        ++start;
+    return SearchKey::normalize(value.mid(start).trimmed());
+}
+
+QString find(const QStringList &codes, const QString &value)
+{
+    const QString wanted = key(value);
+    for (const QString &code : codes) {
+        if (key(code) == wanted)
+            return code;
+    }
+    return QString();
+}
+}
+
+namespace OrderCodes {
+
+const QStringList &statuts()
+{
+    static const QStringList codes = {"EN_COURS", "LIVRE", "ANNULE"};
+    return codes;
+}
+
+const QStringList &paiements()
+{
+    static const QStringList codes = {"Carte Bancaire", "Espèces", "Chèque", "Virement"};
+    return codes;
+}
+
+QString label(const QString &code)
+{
+    return labels().value(code, code);
+}
+
+QString statut(const QString &value)
+{
+    return find(statuts(), value);
+}
+
+QString paiement(const QString &value)
+{
+    return find(paiements(), value);
+}
+
+} // namespace OrderCodes
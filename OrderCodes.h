@@ -0,0 +1,26 @@
+#ifndef ORDERCODES_H
+#define ORDERCODES_H
+
+#include <QStringList>
+
+// statut and moyen_paiement hold plain codes ("LIVRE", "Virement"), the
+// same in the database, the search expression and QTcredit.ini. The emoji
+// labels are for display: the combos show label() and carry the code as
+// item data. Rows saved with the label by older versions are rewritten by
+// DatabaseManager::normalizeOrderCodes(), once per database.
+namespace OrderCodes {
+
+const QStringList &statuts();   // EN_COURS, LIVRE, ANNULE
+const QStringList &paiements(); // Carte Bancaire, Espèces, Chèque, Virement
+
+// "🟢 LIVRE" for "LIVRE"; anything else is returned as is
+QString label(const QString &code);
+
+// Code of a typed, configured or stored value, ignoring the emoji, case
+// and accents ("livre", "🟢 LIVRE" -> "LIVRE"); empty if unknown
+QString statut(const QString &value);
+QString paiement(const QString &value);
+
+} // namespace OrderCodes
+
+#endif // ORDERCODES_H
@@ -0,0 +1,493 @@
+#include "OrderQuery.h"
+#include "OrderCodes.h"
+#include "SearchKey.h"
+#include <QHash>
+#include <QLocale>
+#include <QRegularExpression>
+
+namespace {
+struct Token {
+    QString text;
+    bool quoted = false;   // started with a quote: a name, never a field
+};
+
+// Splits on spaces outside quotes; the quotes themselves are dropped
+QList<Token> tokenize(const QString &text)
+{
+    QList<Token> tokens;
+    Token current;
+    bool inQuote = false;
+    bool started = false;
+    for (const QChar c : text) {
+        if (c == '"') {
+            if (!started)
+                current.quoted = true;
+            inQuote = !inQuote;
+            started = true;
+        } else if (c.isSpace() && !inQuote) {
+            if (started)
+                tokens << current;
+            current = Token();
+            started = false;
+        } else {
+            current.text += c;
+            started = true;
+        }
+    }
+    if (started)
+        tokens << current;
+    return tokens;
+}
+
+const QHash<QString, OrderQuery::Field> &fieldNames()
+{
+    static const QHash<QString, OrderQuery::Field> names = {
+        {"client", OrderQuery::Client}, {"nom", OrderQuery::Client},
+        {"statut", OrderQuery::Statut}, {"paiement", OrderQuery::Paiement},
+        {"montant", OrderQuery::Montant}, {"date", OrderQuery::Date},
+    };
+    return names;
+}
+
+// LIKE escape character of the client patterns; a backslash would need a
+// different literal on MySQL and SQLite
+const QChar LikeEscape = '!';
+
+// Matched against nom_key, so accents and case do not matter. The start of
+// the name by default, so idx_client_nom_key is used; a leading * matches
+// anywhere in the name (full scan of client). % and _ typed by the user
+// are literal.
+QString likePattern(const QString &text)
+{
+    QString key = SearchKey::normalize(text);
+    const bool anywhere = key.startsWith('*');
+    if (anywhere)
+        key.remove(0, 1);
+    if (key.endsWith('*'))
+        key.chop(1);
+    QString escaped;
+    for (const QChar c : std::as_const(key)) {
+        if (c == '%' || c == '_' || c == LikeEscape)
+            escaped += LikeEscape;
+        escaped += c;
+    }
+    return (anywhere ? "%" : "") + escaped + "%";
+}
+
+// [start, end) of a year, a month or a day
+bool parseDay(const QString &text, QDateTime &start, QDateTime &end)
+{
+    QDate day = QDate::fromString(text, "yyyy-MM-dd");
+    if (day.isValid()) {
+        start = QDateTime(day, QTime(0, 0));
+        end = QDateTime(day.addDays(1), QTime(0, 0));
+        return true;
+    }
+    day = QDate::fromString(text, "yyyy-MM");
+    if (day.isValid()) {
+        start = QDateTime(day, QTime(0, 0));
+        end = QDateTime(day.addMonths(1), QTime(0, 0));
+        return true;
+    }
+    day = QDate::fromString(text, "yyyy");
+    if (day.isValid()) {
+        start = QDateTime(day, QTime(0, 0));
+        end = QDateTime(day.addYears(1), QTime(0, 0));
+        return true;
+    }
+    return false;
+}
+
+bool parseAmount(const QString &text, QVariantList &values)
+{
+    bool ok = false;
+    const double amount = QLocale::c().toDouble(text, &ok);
+    if (ok)
+        values << amount;
+    return ok;
+}
+
+bool parseTerm(OrderQuery::Field field, const QString &op, const QString &value, OrderQuery::Term &term,
+               QString *error)
+{
+    auto fail = [error, &value](const QString &message) {
+        if (error)
+            *error = QString("%1 (%2)").arg(message, value);
+        return false;
+    };
+    const bool equal = op == ":" || op == "=";
+    term.field = field;
+    term.values.clear();
+
+    switch (field) {
+    case OrderQuery::Client:
+    case OrderQuery::Statut:
+    case OrderQuery::Paiement:
+        if (!equal)
+            return fail("Comparaison impossible sur ce champ");
+        for (const QString &part : value.split(',', Qt::SkipEmptyParts)) {
+            if (field == OrderQuery::Client) {
+                term.values << likePattern(part);
+                continue;
+            }
+            // The stored code, so SQL and rows in memory compare the same value
+            const QString code = field == OrderQuery::Statut ? OrderCodes::statut(part) : OrderCodes::paiement(part);
+            if (code.isEmpty())
+                return fail(field == OrderQuery::Statut ? "Statut inconnu" : "Moyen de paiement inconnu");
+            term.values << code;
+        }
+        if (term.values.isEmpty())
+            return fail("Valeur manquante");
+        term.op = field == OrderQuery::Client ? OrderQuery::Like : OrderQuery::Equal;
+        return true;
+
+    case OrderQuery::Montant:
+        if (equal && value.contains("..")) {
+            const QString low = value.section("..", 0, 0);
+            const QString high = value.section("..", 1);
+            if ((!low.isEmpty() && !parseAmount(low, term.values)) || (!high.isEmpty() && !parseAmount(high, term.values)))
+                return fail("Montant invalide");
+            if (term.values.isEmpty())
+                return fail("Intervalle vide");
+            term.op = low.isEmpty() ? OrderQuery::LessEqual : high.isEmpty() ? OrderQuery::GreaterEqual : OrderQuery::Range;
+            return true;
+        }
+        for (const QString &part : value.split(',', Qt::SkipEmptyParts)) {
+            if (!parseAmount(part, term.values))
+                return fail("Montant invalide");
+        }
+        if (term.values.isEmpty() || (!equal && term.values.size() > 1))
+            return fail("Montant invalide");
+        if (equal) term.op = OrderQuery::Equal;
+        else if (op == "<") term.op = OrderQuery::Less;
+        else if (op == "<=") term.op = OrderQuery::LessEqual;
+        else if (op == ">") term.op = OrderQuery::Greater;
+        else term.op = OrderQuery::GreaterEqual;
+        return true;
+
+    case OrderQuery::Date: {
+        // Bounds are kept half-open: >= start of the first period, < end of the last
+        QDateTime start, end;
+        if (equal && value.contains("..")) {
+            const QString low = value.section("..", 0, 0);
+            const QString high = value.section("..", 1);
+            QDateTime lowStart, highEnd, unused;
+            if ((!low.isEmpty() && !parseDay(low, lowStart, unused)) || (!high.isEmpty() && !parseDay(high, unused, highEnd)))
+                return fail("Date invalide");
+            if (low.isEmpty() && high.isEmpty())
+                return fail("Intervalle vide");
+            if (!low.isEmpty())
+                term.values << lowStart;
+            if (!high.isEmpty())
+                term.values << highEnd;
+            term.op = low.isEmpty() ? OrderQuery::Less : high.isEmpty() ? OrderQuery::GreaterEqual : OrderQuery::Range;
+            return true;
+        }
+        if (!parseDay(value, start, end))
+            return fail("Date invalide");
+        if (equal) {
+            term.op = OrderQuery::Range;
+            term.values << start << end;
+        } else if (op == "<") {
+            term.op = OrderQuery::Less;
+            term.values << start;
+        } else if (op == "<=") {
+            term.op = OrderQuery::Less;
+            term.values << end;
+        } else if (op == ">") {
+            term.op = OrderQuery::GreaterEqual;
+            term.values << end;
+        } else {
+            term.op = OrderQuery::GreaterEqual;
+            term.values << start;
+        }
+        return true;
+    }
+    }
+    return false;
+}
+
+QString column(OrderQuery::Field field)
+{
+    switch (field) {
+    case OrderQuery::Statut: return "co.statut";
+    case OrderQuery::Paiement: return "co.moyen_paiement";
+    case OrderQuery::Montant: return "co.montant_total";
+    case OrderQuery::Date: return "co.date_commande";
+    case OrderQuery::Client: break;
+    }
+    return QString();
+}
+
+// A term with its values converted once, tested row by row
+struct Test
+{
+    explicit Test(const OrderQuery::Term &term) : field(term.field), op(term.op)
+    {
+        for (const QVariant &value : term.values) {
+            if (field == OrderQuery::Client) {
+                // "%text%" or "text%" with escapes, see likePattern()
+                const QString pattern = value.toString();
+                prefix << !pattern.startsWith('%');
+                QString needle;
+                for (int i = prefix.constLast() ? 0 : 1; i < pattern.size() - 1; ++i) {
+                    if (pattern.at(i) == LikeEscape)
+                        ++i;
+                    needle += pattern.at(i);
+                }
+                texts << needle;
+            } else if (field == OrderQuery::Montant) {
+                numbers << value.toDouble();
+            } else if (field == OrderQuery::Date) {
+                dates << value.toDateTime();
+            } else {
+                texts << value.toString();
+            }
+        }
+    }
+
+    bool operator()(const CommandeRow &row) const
+    {
+        switch (field) {
+        case OrderQuery::Client: {
+            const QString nomKey = SearchKey::normalize(row.nom);
+            for (int i = 0; i < texts.size(); ++i) {
+                if (prefix.at(i) ? nomKey.startsWith(texts.at(i)) : nomKey.contains(texts.at(i)))
+                    return true;
+            }
+            return false;
+        }
+        // Codes on both sides (see parseTerm), compared exactly like SQL
+        case OrderQuery::Statut:
+            return texts.contains(row.statut);
+        case OrderQuery::Paiement:
+            return texts.contains(row.moyenPaiement);
+        case OrderQuery::Montant:
+            return compare(row.montantTotal, numbers);
+        case OrderQuery::Date:
+            return compare(row.dateCommande, dates);
+        }
+        return false;
+    }
+
+    template <typename T>
+    bool compare(const T &value, const QVector<T> &bounds) const
+    {
+        switch (op) {
+        case OrderQuery::Equal: return bounds.contains(value);
+        case OrderQuery::Less: return value < bounds.at(0);
+        case OrderQuery::LessEqual: return value <= bounds.at(0);
+        case OrderQuery::Greater: return value > bounds.at(0);
+        case OrderQuery::GreaterEqual: return value >= bounds.at(0);
+        // Dates are half-open, amounts inclusive
+        case OrderQuery::Range:
+            return value >= bounds.at(0) && (field == OrderQuery::Date ? value < bounds.at(1) : value <= bounds.at(1));
+        case OrderQuery::Like: break;
+        }
+        return false;
+    }
+
+    OrderQuery::Field field;
+    OrderQuery::Op op;
+    QStringList texts;
+    QVector<bool> prefix;
+    QVector<double> numbers;
+    QVector<QDateTime> dates;
+};
+}
+
+bool OrderQuery::parse(const QString &text, OrderQuery &query, QString *error)
+{
+    static const QRegularExpression termPattern("^([A-Za-z]+)(:|>=|<=|>|<|=)(.*)$");
+    query = OrderQuery();
+    // Consecutive words without a field are one name, as typed in the old box
+    QStringList words;
+    auto flushWords = [&query, &words]() {
+        if (!words.isEmpty())
+            query.add({Client, Like, {likePattern(words.join(' '))}});
+        words.clear();
+    };
+
+    for (const Token &token : tokenize(text)) {
+        const QRegularExpressionMatch match = token.quoted ? QRegularExpressionMatch() : termPattern.match(token.text);
+        if (!match.hasMatch()) {
+            words << token.text;
+            continue;
+        }
+        const QString name = match.captured(1).toLower();
+        if (!fieldNames().contains(name)) {
+            if (error)
+                *error = QString("Champ inconnu: %1 (client, statut, paiement, montant, date)").arg(name);
+            return false;
+        }
+        flushWords();
+        Term term;
+        if (!parseTerm(fieldNames().value(name), match.captured(2), match.captured(3), term, error))
+            return false;
+        query.add(term);
+    }
+    flushWords();
+    return true;
+}
+
+OrderQuery::Term OrderQuery::period(const QDate &from, const QDate &to)
+{
+    Term term{Date, Range, {}};
+    if (from.isValid())
+        term.values << QDateTime(from, QTime(0, 0));
+    if (to.isValid())
+        term.values << QDateTime(to.addDays(1), QTime(0, 0));
+    if (!from.isValid())
+        term.op = Less;
+    else if (!to.isValid())
+        term.op = GreaterEqual;
+    return term;
+}
+
+bool OrderQuery::has(Field field) const
+{
+    for (const Term &term : m_terms) {
+        if (term.field == field)
+            return true;
+    }
+    return false;
+}
+
+QStringList OrderQuery::labels() const
+{
+    static const QHash<int, QString> names = {
+        {Client, "nom"}, {Statut, "statut"}, {Paiement, "paiement"}, {Montant, "montant"}, {Date, "période"},
+    };
+    QStringList labels;
+    for (const Term &term : m_terms) {
+        if (!labels.contains(names.value(term.field)))
+            labels << names.value(term.field);
+    }
+    return labels;
+}
+
+QString OrderQuery::orderCondition(const Term &term, QVariantList &binds)
+{
+    const QString col = column(term.field);
+    // Period terms without values (both sides open) select everything
+    if (term.values.isEmpty())
+        return QString();
+    binds += term.values;
+    switch (term.op) {
+    case Equal:
+        return term.values.size() == 1 ? col + " = ?"
+                                       : col + " IN (" + QStringList(term.values.size(), "?").join(", ") + ")";
+    case Less: return col + " < ?";
+    case LessEqual: return col + " <= ?";
+    case Greater: return col + " > ?";
+    case GreaterEqual: return col + " >= ?";
+    case Range:
+        return term.field == Date ? col + " >= ? AND " + col + " < ?" : col + " BETWEEN ? AND ?";
+    case Like: break;
+    }
+    return QString();
+}
+
+QString OrderQuery::clientCondition(const Term &term, QVariantList &binds)
+{
+    binds += term.values;
+    const QString condition =
+        QStringList(term.values.size(), QString("nom_key LIKE ? ESCAPE '%1'").arg(LikeEscape)).join(" OR ");
+    return term.values.size() == 1 ? condition : "(" + condition + ")";
+}
+
+// Every order condition compares an indexed column to bound values, so the
+// statut and date indexes stay usable
+QStringList OrderQuery::conditions(QVariantList &binds) const
+{
+    QStringList conditions;
+    for (const Term &term : m_terms) {
+        const QString condition = term.field == Client
+            ? "co.id_client IN (SELECT id_client FROM client WHERE " + clientCondition(term, binds) + ")"
+            : orderCondition(term, binds);
+        if (!condition.isEmpty())
+            conditions << condition;
+    }
+    return conditions;
+}
+
+QStringList OrderQuery::orderConditions(QVariantList &binds) const
+{
+    QStringList conditions;
+    for (const Term &term : m_terms) {
+        if (term.field == Client)
+            continue;
+        const QString condition = orderCondition(term, binds);
+        if (!condition.isEmpty())
+            conditions << condition;
+    }
+    return conditions;
+}
+
+QStringList OrderQuery::clientConditions(QVariantList &binds) const
+{
+    QStringList conditions;
+    for (const Term &term : m_terms) {
+        if (term.field == Client)
+            conditions << clientCondition(term, binds);
+    }
+    return conditions;
+}
+
+void OrderQuery::narrowDates(QDate &from, QDate &to) const
+{
+    auto narrowFrom = [&from](const QVariant &start) {
+        const QDate day = start.toDateTime().date();
+        if (!from.isValid() || day > from)
+            from = day;
+    };
+    // Upper bounds are exclusive: the last day is the one before
+    auto narrowTo = [&to](const QVariant &end) {
+        const QDate day = end.toDateTime().addMSecs(-1).date();
+        if (!to.isValid() || day < to)
+            to = day;
+    };
+    for (const Term &term : m_terms) {
+        if (term.field != Date || term.values.isEmpty())
+            continue;
+        if (term.op == GreaterEqual) {
+            narrowFrom(term.values.at(0));
+        } else if (term.op == Less) {
+            narrowTo(term.values.at(0));
+        } else if (term.op == Range) {
+            narrowFrom(term.values.at(0));
+            narrowTo(term.values.at(1));
+        }
+    }
+}
+
+bool OrderQuery::matches(const CommandeRow &row) const
+{
+    for (const Term &term : m_terms) {
+        if (!term.values.isEmpty() && !Test(term)(row))
+            return false;
+    }
+    return true;
+}
+
+QVector<int> OrderQuery::select(const QVector<CommandeRow> &rows) const
+{
+    QVector<int> positions(rows.size());
+    for (int i = 0; i < positions.size(); ++i)
+        positions[i] = i;
+
+    for (const Term &term : m_terms) {
+        if (term.values.isEmpty())
+            continue;
+        const Test test(term);
+        int kept = 0;
+        for (int i = 0; i < positions.size(); ++i) {
+            if (test(rows.at(positions.at(i))))
+                positions[kept++] = positions.at(i);
+        }
+        positions.resize(kept);
+        if (positions.isEmpty())
+            break;
+    }
+    return positions;
+}
@@ -0,0 +1,71 @@
+#ifndef ORDERQUERY_H
+#define ORDERQUERY_H
+
+#include <QDate>
+#include <QVariantList>
+#include <QStringList>
+#include "RowCursor.h"
+
+// Search expression of the order list, e.g.
+//   statut:LIVRE montant>500 paiement:Virement client:ali date:2025-01..2025-03
+// Terms are ANDed. A field takes several values separated by commas (any
+// of them), "a..b" is an inclusive range with either side open, quotes
+// keep spaces ("Carte Bancaire"). Words without a field match the start
+// of the client name like the old name box, ignoring accents and case;
+// a leading * matches anywhere in the name (client:*ali), which cannot use
+// the name index. % and _ are plain characters.
+// Statut and paiement values are read as OrderCodes codes ("livre" ->
+// LIVRE). Dates are yyyy, yyyy-MM or yyyy-MM-dd.
+//
+// The same query compiles to SQL conditions on the indexed commande
+// columns, and to a filter over rows already in memory.
+class OrderQuery
+{
+public:
+    enum Field { Client, Statut, Paiement, Montant, Date };
+    enum Op { Equal, Like, Less, LessEqual, Greater, GreaterEqual, Range };
+
+    // Equal: one or more values (IN); Range: low, high; others: one value.
+    // Client values are LIKE patterns on nom_key, escaped with '!'; date
+    // bounds are QDateTime, Range and Less upper bounds being exclusive
+    // (date terms only use GreaterEqual, Less and Range).
+    struct Term {
+        Field field;
+        Op op;
+        QVariantList values;
+    };
+
+    // false and error set if text is not a valid expression
+    static bool parse(const QString &text, OrderQuery &query, QString *error = nullptr);
+    // Orders of the days from..to (either invalid = open)
+    static Term period(const QDate &from, const QDate &to);
+
+    void add(const Term &term) { m_terms << term; }
+    bool isEmpty() const { return m_terms.isEmpty(); }
+    bool has(Field field) const;
+    const QList<Term> &terms() const { return m_terms; }
+    // Labels of the fields used ("nom", "statut", "période"...), for plan names
+    QStringList labels() const;
+
+    // ANDed conditions over commande aliased co, values appended to binds in
+    // order. The client terms become a semi-join on client.
+    QStringList conditions(QVariantList &binds) const;
+    // Same split for the order shards, which have no client table
+    QStringList orderConditions(QVariantList &binds) const;
+    QStringList clientConditions(QVariantList &binds) const;
+    // Narrows [from, to] (invalid = open) to the days the date terms allow
+    void narrowDates(QDate &from, QDate &to) const;
+
+    bool matches(const CommandeRow &row) const;
+    // Positions of the matching rows: each term filters the remaining
+    // positions on its own column, one column at a time
+    QVector<int> select(const QVector<CommandeRow> &rows) const;
+
+private:
+    static QString orderCondition(const Term &term, QVariantList &binds);
+    static QString clientCondition(const Term &term, QVariantList &binds);
+
+    QList<Term> m_terms;
+};
+
+#endif // ORDERQUERY_H
@@ -0,0 +1,224 @@
+#include "OrderShards.h"
+#include "AppSettings.h"
+#include "ChangeFeed.h"
+#include "LocalReplica.h"
+#include "OrderArchive.h"
+#include <QDebug>
+#include <QSemaphore>
+#include <QSettings>
+
+ShardConfig ShardConfig::load(const QString &group)
+{
+    ShardConfig config;
+    QSettings settings(AppSettings::filePath(), QSettings::IniFormat);
+    settings.beginGroup(group);
+    config.enabled = settings.value("enabled", config.enabled).toBool();
+    const int count = qMax(0, settings.value("count", 0).toInt());
+    config.idBlockSize = qMax(1, settings.value("id_block_size", config.idBlockSize).toInt());
+    settings.endGroup();
+
+    for (int n = 0; n < count; ++n)
+        config.shards << DatabaseConfig::load(QString("shard_%1").arg(n));
+    return config;
+}
+
+QStringList ShardConfig::conflicts()
+{
+    QStringList groups;
+    if (ChangeFeedConfig::load().enabled)
+        groups << "change_feed";
+    if (ReplicaConfig::load().enabled)
+        groups << "replica_local";
+    if (ReadReplicaConfig::load().enabled)
+        groups << "read_replica";
+    if (ArchiveConfig::load().enabled)
+        groups << "archive";
+    return groups;
+}
+
+OrderShards::OrderShards(const ShardConfig &config, const QString &owner)
+    : m_idBlockSize(config.idBlockSize)
+{
+    for (int n = 0; n < config.shards.size(); ++n) {
+        Shard shard;
+        shard.config = config.shards.at(n);
+        shard.config.connectionName = QString("%1_shard_%2").arg(owner).arg(n);
+        shard.thread = new QThread;
+        shard.context = new QObject;
+        shard.context->moveToThread(shard.thread);
+        QObject::connect(shard.thread, &QThread::finished, shard.context, &QObject::deleteLater);
+        shard.thread->start();
+        m_shards << shard;
+    }
+}
+
+OrderShards::~OrderShards()
+{
+    // Each connection is closed and removed by the thread that opened it
+    scatter([this](int n, QSqlDatabase) {
+        Shard &shard = m_shards[n];
+        shard.db.close();
+        shard.db = QSqlDatabase();
+        QSqlDatabase::removeDatabase(shard.config.connectionName);
+    });
+    for (Shard &shard : m_shards) {
+        shard.thread->quit();
+        shard.thread->wait();
+        delete shard.thread;
+    }
+}
+
+bool OrderShards::open()
+{
+    if (m_shards.isEmpty())
+        return false;
+
+    QVector<char> opened(count(), false);
+    scatter([this, &opened](int n, QSqlDatabase) {
+        Shard &shard = m_shards[n];
+        shard.db = DatabaseManager::addConnection(shard.config, shard.config.connectionName);
+        if (!shard.db.open()) {
+            qWarning() << "Order shard" << n << "open failed:" << shard.db.lastError().text();
+            return;
+        }
+        if (shard.config.driver == "QSQLITE") {
+            QSqlQuery q(shard.db);
+            q.exec("PRAGMA journal_mode = WAL");
+            q.exec(QString("PRAGMA synchronous = %1").arg(shard.config.sqliteSynchronous));
+        }
+        opened[n] = ensureSchema(shard);
+    });
+    return !opened.contains(false);
+}
+
+// commande as on the primary minus the client foreign key (clients stay on
+// the primary), and the id_block counter of the order ids
+bool OrderShards::ensureSchema(Shard &shard)
+{
+    QStringList ddl;
+    if (shard.config.driver == "QSQLITE") {
+        ddl << "CREATE TABLE IF NOT EXISTS commande ("
+               " id_commande INTEGER PRIMARY KEY,"
+               " id_client INTEGER NOT NULL,"
+               " date_commande TEXT NOT NULL,"
+               " statut TEXT NOT NULL DEFAULT 'EN_COURS',"
+               " montant_total REAL NOT NULL DEFAULT 0,"
+               " moyen_paiement TEXT,"
+               " remarque TEXT)"
+            << "CREATE TABLE IF NOT EXISTS id_block (name TEXT PRIMARY KEY, next_hi INTEGER NOT NULL)"
+            << "INSERT OR IGNORE INTO id_block (name, next_hi) VALUES ('commande', 1)";
+    } else {
+        ddl << "CREATE TABLE IF NOT EXISTS commande ("
+               " id_commande BIGINT PRIMARY KEY,"
+               " id_client INT NOT NULL,"
+               " date_commande DATETIME NOT NULL,"
+               " statut VARCHAR(20) NOT NULL DEFAULT 'EN_COURS',"
+               " montant_total DECIMAL(12,2) NOT NULL DEFAULT 0,"
+               " moyen_paiement VARCHAR(50),"
+               " remarque TEXT)"
+            << "CREATE TABLE IF NOT EXISTS id_block (name VARCHAR(32) PRIMARY KEY, next_hi BIGINT NOT NULL)"
+            << "INSERT IGNORE INTO id_block (name, next_hi) VALUES ('commande', 1)";
+    }
+
+    QSqlQuery q(shard.db);
+    for (const QString &statement : ddl) {
+        if (!q.exec(statement)) {
+            qWarning() << "Order shard schema failed:" << shard.config.connectionName << q.lastError().text();
+            return false;
+        }
+    }
+    return DatabaseManager::ensureIndex(shard.db, "commande", "idx_commande_client_date", "id_client, date_commande")
+        && DatabaseManager::ensureIndex(shard.db, "commande", "idx_commande_date", "date_commande")
+        && DatabaseManager::ensureIndex(shard.db, "commande", "idx_commande_statut_date", "statut, date_commande")
+        && DatabaseManager::migrateOnce(shard.db, "order_codes", [&shard]() {
+               return DatabaseManager::normalizeOrderCodes(shard.db, "commande");
+           });
+}
+
+QList<int> OrderShards::allShards() const
+{
+    QList<int> shards;
+    for (int n = 0; n < count(); ++n)
+        shards << n;
+    return shards;
+}
+
+QHash<int, QList<int>> OrderShards::byClient(const QList<int> &clientIds) const
+{
+    QHash<int, QList<int>> groups;
+    for (int id : clientIds)
+        groups[shardOfClient(id)] << id;
+    return groups;
+}
+
+QHash<int, QList<int>> OrderShards::byCommande(const QList<int> &commandeIds) const
+{
+    QHash<int, QList<int>> groups;
+    for (int id : commandeIds)
+        groups[shardOfCommande(id)] << id;
+    return groups;
+}
+
+void OrderShards::scatter(const QList<int> &shards, const ShardFn &fn)
+{
+    QSemaphore done;
+    for (int n : shards) {
+        Shard &shard = m_shards[n];
+        QMetaObject::invokeMethod(shard.context, [&done, &fn, &shard, n]() {
+            fn(n, shard.db);
+            done.release();
+        });
+    }
+    done.acquire(shards.size());
+}
+
+// Not a two-phase commit: a commit failing after another shard committed
+// leaves that one written, which is reported
+bool OrderShards::transact(const QList<int> &shards, const ShardWriteFn &fn)
+{
+    QVector<char> written(count(), false);
+    scatter(shards, [&fn, &written](int n, QSqlDatabase db) {
+        written[n] = db.transaction() && fn(n, db);
+    });
+    bool ok = true;
+    for (int n : shards)
+        ok = ok && written.at(n);
+
+    QVector<char> committed(count(), false);
+    scatter(shards, [this, ok, &committed](int n, QSqlDatabase db) {
+        if (ok && db.commit()) {
+            committed[n] = true;
+            return;
+        }
+        db.rollback();
+        // Ids reserved by this transaction went back with it
+        m_shards[n].nextId = m_shards[n].endId = 0;
+    });
+    if (!ok)
+        return false;
+    for (int n : shards) {
+        if (!committed.at(n)) {
+            qWarning() << "Order shard" << n << "commit failed, other shards of the write may have committed";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Hi/lo: id_block hands out blocks of idBlockSize, ids within a block are
+// lo * count() + shard so that any id tells its shard
+qint64 OrderShards::nextCommandeId(int n, QSqlDatabase db)
+{
+    Shard &shard = m_shards[n];
+    if (shard.nextId >= shard.endId) {
+        QSqlQuery q(db);
+        if (!q.exec("UPDATE id_block SET next_hi = next_hi + 1 WHERE name = 'commande'")
+            || !q.exec("SELECT next_hi FROM id_block WHERE name = 'commande'") || !q.next()) {
+            qWarning() << "Order shard id block failed:" << q.lastError().text();
+            return -1;
+        }
+        shard.nextId = (q.value(0).toLongLong() - 1) * m_idBlockSize;
+        shard.endId = shard.nextId + m_idBlockSize;
+    }
+    return shard.nextId++ * count() + n;
+}
@@ -0,0 +1,104 @@
+#ifndef ORDERSHARDS_H
+#define ORDERSHARDS_H
+
+#include <QObject>
+#include <QThread>
+#include <functional>
+#include <algorithm>
+#include "DatabaseManager.h"
+
+// Settings of the [shards] group of QTcredit.ini. Shard n connects with the
+// keys of the [shard_<n>] group, same names as [database].
+struct ShardConfig
+{
+    bool enabled = false;
+    QList<DatabaseConfig> shards;
+    int idBlockSize = 100; // order ids reserved per update of id_block
+
+    static ShardConfig load(const QString &group = "shards");
+    // Enabled features that read or write commande on [database] only and
+    // would miss the sharded orders: change_feed, replica_local,
+    // read_replica, archive
+    static QStringList conflicts();
+};
+
+// commande split over several databases by client: every order of a client
+// lives on shard id_client % count(), and order ids are handed out so that
+// id_commande % count() names the same shard. Each shard has a thread of
+// its own holding its connection; the calls below block the caller until
+// the shards concerned are done, running them in parallel.
+class OrderShards
+{
+public:
+    // fn(shard, db) runs in the thread of shard, db is its connection
+    using ShardFn = std::function<void(int shard, QSqlDatabase db)>;
+    using ShardWriteFn = std::function<bool(int shard, QSqlDatabase db)>;
+
+    // owner prefixes the connection names, one set per DatabaseManager
+    OrderShards(const ShardConfig &config, const QString &owner);
+    ~OrderShards();
+
+    // Opens every shard and creates its tables
+    bool open();
+
+    int count() const { return m_shards.size(); }
+    int shardOfClient(qint64 idClient) const { return int(idClient % count()); }
+    int shardOfCommande(qint64 idCommande) const { return int(idCommande % count()); }
+    QList<int> allShards() const;
+    // ids grouped by owning shard (by client or by order id)
+    QHash<int, QList<int>> byClient(const QList<int> &clientIds) const;
+    QHash<int, QList<int>> byCommande(const QList<int> &commandeIds) const;
+
+    void scatter(const QList<int> &shards, const ShardFn &fn);
+    void scatter(const ShardFn &fn) { scatter(allShards(), fn); }
+    // fn in one transaction per shard; they all commit only if every fn
+    // returned true, else they all roll back
+    bool transact(const QList<int> &shards, const ShardWriteFn &fn);
+
+    // New order id on shard; inside a transact() fn of that shard only, the
+    // reservation commits or rolls back with it
+    qint64 nextCommandeId(int shard, QSqlDatabase db);
+
+private:
+    struct Shard {
+        DatabaseConfig config;
+        QThread *thread = nullptr;
+        QObject *context = nullptr;   // lives in thread, target of the queued calls
+        QSqlDatabase db;              // only touched in thread
+        qint64 nextId = 0;            // current id block [nextId, endId)
+        qint64 endId = 0;
+    };
+
+    bool ensureSchema(Shard &shard);
+
+    int m_idBlockSize;
+    QList<Shard> m_shards;
+};
+
+// k-way merge of parts each sorted by before(), at most limit rows (0 = all)
+template <typename Row, typename Before>
+QVector<Row> mergeSorted(const QVector<QVector<Row>> &parts, Before before, int limit = 0)
+{
+    QVector<Row> merged;
+    QVector<int> positions(parts.size(), 0);
+    // (part, position) of the current head of each part, smallest first
+    auto later = [&](int a, int b) { return before(parts[b][positions[b]], parts[a][positions[a]]); };
+    QVector<int> heap;
+    for (int i = 0; i < parts.size(); ++i) {
+        if (!parts[i].isEmpty())
+            heap << i;
+    }
+    std::make_heap(heap.begin(), heap.end(), later);
+    while (!heap.isEmpty() && (limit <= 0 || merged.size() < limit)) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        const int part = heap.takeLast();
+        merged << parts[part][positions[part]++];
+        if (positions[part] < parts[part].size()) {
+            heap << part;
+            std::push_heap(heap.begin(), heap.end(), later);
+        }
+    }
+    return merged;
+}
+
+#endif // ORDERSHARDS_H
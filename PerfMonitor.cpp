@@ -0,0 +1,92 @@
+#include "PerfMonitor.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <QFile>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+namespace {
+QMutex s_mutex;
+QMap<QString, QMap<QString, PerfMonitor::Timing>> s_timings;
+QMap<QString, PerfMonitor::CacheStats> s_caches;
+}
+
+const QString PerfMonitor::Query = QStringLiteral("query");
+const QString PerfMonitor::Fetch = QStringLiteral("fetch");
+const QString PerfMonitor::Populate = QStringLiteral("populate");
+const QString PerfMonitor::Chart = QStringLiteral("chart");
+
+QStringList PerfMonitor::phases()
+{
+    return {Query, Fetch, Populate, Chart};
+}
+
+void PerfMonitor::record(const QString &screen, const QString &phase, qint64 ns)
+{
+    QMutexLocker locker(&s_mutex);
+    Timing &t = s_timings[screen][phase];
+    t.lastNs = ns;
+    t.totalNs += ns;
+    t.maxNs = qMax(t.maxNs, ns);
+    t.samples++;
+}
+
+void PerfMonitor::cacheHit(const QString &cache, qint64 count)
+{
+    QMutexLocker locker(&s_mutex);
+    s_caches[cache].hits += count;
+}
+
+void PerfMonitor::cacheMiss(const QString &cache, qint64 count)
+{
+    QMutexLocker locker(&s_mutex);
+    s_caches[cache].misses += count;
+}
+
+QMap<QString, QMap<QString, PerfMonitor::Timing>> PerfMonitor::timings()
+{
+    QMutexLocker locker(&s_mutex);
+    return s_timings;
+}
+
+QMap<QString, PerfMonitor::CacheStats> PerfMonitor::cacheStats()
+{
+    QMutexLocker locker(&s_mutex);
+    return s_caches;
+}
+
+void PerfMonitor::reset()
+{
+    QMutexLocker locker(&s_mutex);
+    s_timings.clear();
+    s_caches.clear();
+}
+
+qint64 PerfMonitor::residentMemoryBytes()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return static_cast<qint64>(counters.WorkingSetSize);
+    return -1;
+#elif defined(Q_OS_LINUX)
+    QFile status("/proc/self/status");
+    if (!status.open(QIODevice::ReadOnly | QIODevice::Text))
+        return -1;
+    while (!status.atEnd()) {
+        const QByteArray line = status.readLine();
+        if (line.startsWith("VmRSS:")) {
+            // "VmRSS:     123456 kB"
+            const QList<QByteArray> parts = line.simplified().split(' ');
+            if (parts.size() >= 2)
+                return parts.at(1).toLongLong() * 1024;
+        }
+    }
+    return -1;
+#else
+    return -1;
+#endif
+}
@@ -0,0 +1,66 @@
+#ifndef PERFMONITOR_H
+#define PERFMONITOR_H
+
+#include <QString>
+#include <QStringList>
+#include <QMap>
+#include <QElapsedTimer>
+
+// Process-wide timing and cache counters, read by the diagnostics panel.
+// All methods are thread-safe so background workers can report too.
+class PerfMonitor
+{
+public:
+    struct Timing {
+        qint64 lastNs = 0;
+        qint64 totalNs = 0;
+        qint64 maxNs = 0;
+        int samples = 0;
+
+        double lastMs() const { return lastNs / 1e6; }
+        double avgMs() const { return samples > 0 ? (totalNs / samples) / 1e6 : 0.0; }
+        double maxMs() const { return maxNs / 1e6; }
+    };
+
+    struct CacheStats {
+        qint64 hits = 0;
+        qint64 misses = 0;
+
+        double hitRate() const { return hits + misses > 0 ? double(hits) / double(hits + misses) : 0.0; }
+    };
+
+    // Phase names used by the screens
+    static const QString Query;     // SQL exec
+    static const QString Fetch;     // next() + QVariant conversion
+    static const QString Populate;  // table / widget filling
+    static const QString Chart;     // chart construction
+
+    static QStringList phases();
+
+    static void record(const QString &screen, const QString &phase, qint64 ns);
+    static void cacheHit(const QString &cache, qint64 count = 1);
+    static void cacheMiss(const QString &cache, qint64 count = 1);
+
+    static QMap<QString, QMap<QString, Timing>> timings();
+    static QMap<QString, CacheStats> cacheStats();
+    static void reset();
+
+    // Resident set size of the current process, -1 if unknown on this platform
+    static qint64 residentMemoryBytes();
+
+    // Records the elapsed time of a scope as one sample
+    class Scope
+    {
+    public:
+        Scope(const QString &screen, const QString &phase)
+            : m_screen(screen), m_phase(phase) { m_timer.start(); }
+        ~Scope() { PerfMonitor::record(m_screen, m_phase, m_timer.nsecsElapsed()); }
+
+    private:
+        QString m_screen;
+        QString m_phase;
+        QElapsedTimer m_timer;
+    };
+};
+
+#endif // PERFMONITOR_H
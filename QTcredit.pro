@@ -2,7 +2,7 @@ QT += sql
 QT       += core gui
 QT       += charts
 QT += core gui sql charts printsupport
-QT += core gui sql charts printsupport network
+QT += core gui sql charts printsupport network concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -13,17 +13,85 @@ CONFIG += c++17
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    AppSettings.cpp \
+    BatchRunner.cpp \
+    ChangeFeed.cpp \
+    ClientAnalytics.cpp \
+    ClientDimension.cpp \
+    CohortAnalysis.cpp \
+    CsvExporter.cpp \
     DatabaseManager.cpp \
+    LocalReplica.cpp \
+    OrderArchive.cpp \
+    OrderCodes.cpp \
+    OrderQuery.cpp \
+    OrderShards.cpp \
+    PerfMonitor.cpp \
+    QueryPlanCheck.cpp \
+    ReportGenerator.cpp \
+    RowCursor.cpp \
+    RowTableModel.cpp \
+    SearchKey.cpp \
+    SearchRunner.cpp \
+    StatementGenerator.cpp \
+    StatusRules.cpp \
+    TableRowDelegate.cpp \
+    WriteQueue.cpp \
     main.cpp \
     mainwindow.cpp
 
 HEADERS += \
+    AppSettings.h \
+    BatchRunner.h \
+    ChangeFeed.h \
+    ClientAnalytics.h \
+    ClientDimension.h \
+    CohortAnalysis.h \
+    CsvExporter.h \
     DatabaseManager.h \
+    Entities.h \
+    LocalReplica.h \
+    OrderArchive.h \
+    OrderCodes.h \
+    OrderQuery.h \
+    OrderShards.h \
+    PerfMonitor.h \
+    QueryPlanCheck.h \
+    ReportGenerator.h \
+    RowCursor.h \
+    RowTableModel.h \
+    SearchKey.h \
+    SearchRunner.h \
+    StatementGenerator.h \
+    StatusRules.h \
+    TableRowDelegate.h \
+    WriteQueue.h \
     mainwindow.h
 
+# GetProcessMemoryInfo for the diagnostics panel
+win32: LIBS += -lpsapi
+
+# Streaming gzip for CSV exports, needs zlib headers and library:
+#   qmake CONFIG+=qtcredit_zlib
+qtcredit_zlib {
+    DEFINES += QTCREDIT_HAVE_ZLIB
+    LIBS += -lz
+}
+
+# sqlite3_interrupt() to cancel a running search on SQLite; only when Qt's
+# SQLite plugin is built against the same library (-system-sqlite):
+#   qmake CONFIG+=qtcredit_sqlite3
+qtcredit_sqlite3 {
+    DEFINES += QTCREDIT_HAVE_SQLITE3
+    LIBS += -lsqlite3
+}
+
 FORMS += \
     mainwindow.ui
 
+DISTFILES += \
+    QTcredit.example.ini
+
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
 else: unix:!android: target.path = /opt/$${TARGET}/bin
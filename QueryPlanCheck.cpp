@@ -0,0 +1,136 @@
+#include "QueryPlanCheck.h"
+#include "DatabaseManager.h"
+#include "OrderCodes.h"
+#include <QDebug>
+#include <QRandomGenerator>
+#include <functional>
+
+namespace {
+struct PlanCase {
+    QString query;
+    std::function<void(DatabaseManager &)> run;
+    QString expectedIndex;     // must appear in the plan, if set
+    bool orderedByIndex;       // no temporary sort for ORDER BY
+    QStringList allowedScans;  // tables this query has to read whole
+};
+
+QList<PlanCase> planCases()
+{
+    const QDate today = QDate::currentDate();
+    const QDate from = today.addMonths(-2);
+    return {
+        {"searchCommandes sans filtre (date_desc)",
+         [](DatabaseManager &db) { db.searchCommandes(QString(), QString(), QDate(), QDate(), "date_desc", true); },
+         "idx_commande_date", true},
+        {"searchCommandes sans filtre (date_asc)",
+         [](DatabaseManager &db) { db.searchCommandes(QString(), QString(), QDate(), QDate(), "date_asc", true); },
+         "idx_commande_date", true},
+        {"searchCommandes sans filtre (montant_desc)",
+         [](DatabaseManager &db) { db.searchCommandes(QString(), QString(), QDate(), QDate(), "montant_desc", true); },
+         QString(), false, {"c", "co"}},
+        {"searchCommandes statut",
+         [](DatabaseManager &db) { db.searchCommandes(QString(), "LIVRE", QDate(), QDate(), "date_desc", true); },
+         "idx_commande_statut_date", true},
+        {"searchCommandes période",
+         [from, today](DatabaseManager &db) { db.searchCommandes(QString(), QString(), from, today, "date_desc", true); },
+         "idx_commande_date", true},
+        {"searchCommandes statut + période",
+         [from, today](DatabaseManager &db) { db.searchCommandes(QString(), "EN_COURS", from, today, "date_desc", true); },
+         "idx_commande_statut_date", true},
+        {"searchCommandes nom",
+         [](DatabaseManager &db) { db.searchCommandes("nom12%", QString(), QDate(), QDate(), "date_desc", true); },
+         QString(), false},
+        {"getCommandesThisMonth", [](DatabaseManager &db) { db.getCommandesThisMonth(); }, "idx_commande_date", true},
+        {"ordersPerMonth", [today](DatabaseManager &db) { db.ordersPerMonth(today.year()); }, "idx_commande_date", false},
+        {"getOrdersByClient", [from, today](DatabaseManager &db) { db.getOrdersByClient(from, today); },
+         "idx_commande_date", false},
+        {"getClientsWithCommandCount", [](DatabaseManager &db) { db.getClientsWithCommandCount(true); },
+         "idx_client_nb_commandes", true},
+        {"searchClients nom", [](DatabaseManager &db) { db.searchClients("nom12%", true); }, "idx_client_nom_key", false},
+        {"getClient", [](DatabaseManager &db) { Client client; db.getClient(1, client); }, "PRIMARY KEY", false},
+        {"getCommande", [](DatabaseManager &db) { Commande commande; db.getCommande(1, commande); }, "PRIMARY KEY", false},
+    };
+}
+}
+
+bool QueryPlanCheck::generateSample(DatabaseManager &db, int clients, int orders)
+{
+    const QStringList &statuts = OrderCodes::statuts();
+    const QStringList &paiements = OrderCodes::paiements();
+    QRandomGenerator random(42);
+    const QDateTime now = QDateTime::currentDateTime();
+
+    QSqlDatabase sql = db.getDatabase();
+    sql.transaction();
+    QSqlQuery client(sql);
+    client.prepare("INSERT INTO client (nom, prenom, email) VALUES (?, ?, ?)");
+    for (int i = 0; i < clients; ++i) {
+        client.addBindValue(QString("Nom%1").arg(i));
+        client.addBindValue(QString("Prenom%1").arg(i));
+        client.addBindValue(QString("client%1@example.com").arg(i));
+        if (!client.exec()) {
+            qWarning() << "generateSample failed:" << client.lastError().text();
+            sql.rollback();
+            return false;
+        }
+    }
+
+    QSqlQuery commande(sql);
+    commande.prepare("INSERT INTO commande (id_client, date_commande, statut, montant_total, moyen_paiement) "
+                     "VALUES (?, ?, ?, ?, ?)");
+    for (int i = 0; i < orders; ++i) {
+        commande.addBindValue(1 + random.bounded(clients));
+        commande.addBindValue(now.addSecs(-qint64(random.bounded(3 * 365 * 24 * 3600))));
+        commande.addBindValue(statuts.at(random.bounded(statuts.size())));
+        commande.addBindValue(random.bounded(100000) / 100.0);
+        commande.addBindValue(paiements.at(random.bounded(paiements.size())));
+        if (!commande.exec()) {
+            qWarning() << "generateSample failed:" << commande.lastError().text();
+            sql.rollback();
+            return false;
+        }
+    }
+    if (!sql.commit())
+        return false;
+
+    QSqlQuery analyze(sql);
+    return db.rebuildClientCounters() && db.fillSearchKeys() && analyze.exec("ANALYZE");
+}
+
+QList<QueryPlanCheck::Outcome> QueryPlanCheck::run(DatabaseManager &db)
+{
+    const bool capturing = db.planCapture();
+    db.setPlanCapture(true);
+
+    QList<Outcome> outcomes;
+    for (const PlanCase &planCase : planCases()) {
+        db.clearCapturedPlans();
+        planCase.run(db);
+
+        Outcome outcome;
+        outcome.query = planCase.query;
+        const QMap<QString, QStringList> plans = db.capturedPlans();
+        if (plans.isEmpty()) {
+            outcome.problem = "aucun plan capturé";
+            outcomes << outcome;
+            continue;
+        }
+        outcome.plan = plans.first();
+
+        const QString text = outcome.plan.join("\n");
+        QStringList scans = DatabaseManager::fullScans(outcome.plan);
+        for (const QString &table : planCase.allowedScans)
+            scans.removeAll(table);
+        if (!scans.isEmpty())
+            outcome.problem = "parcours complet de " + scans.join(", ");
+        else if (!planCase.expectedIndex.isEmpty() && !text.contains(planCase.expectedIndex))
+            outcome.problem = "index attendu non utilisé: " + planCase.expectedIndex;
+        else if (planCase.orderedByIndex && text.contains("TEMP B-TREE FOR ORDER BY"))
+            outcome.problem = "tri temporaire au lieu de l'ordre de l'index";
+        outcomes << outcome;
+    }
+
+    db.clearCapturedPlans();
+    db.setPlanCapture(capturing);
+    return outcomes;
+}
@@ -0,0 +1,29 @@
+#ifndef QUERYPLANCHECK_H
+#define QUERYPLANCHECK_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+
+class DatabaseManager;
+
+// Guards the index usage of the key queries: each one runs with plan
+// capture on and its plan is compared with the index it is expected to
+// use. Run by "QTcredit check-plans" against a generated SQLite database.
+class QueryPlanCheck
+{
+public:
+    struct Outcome {
+        QString query;
+        QStringList plan;
+        QString problem; // empty when the plan is as expected
+        bool ok() const { return problem.isEmpty(); }
+    };
+
+    // Fills an empty database with clients and orders spread over the
+    // last three years, then refreshes the planner statistics
+    static bool generateSample(DatabaseManager &db, int clients, int orders);
+    static QList<Outcome> run(DatabaseManager &db);
+};
+
+#endif // QUERYPLANCHECK_H
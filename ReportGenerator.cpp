@@ -0,0 +1,284 @@
+#include "ReportGenerator.h"
+#include "DatabaseManager.h"
+#include <QAbstractTextDocumentLayout>
+#include <QDebug>
+#include <QFile>
+#include <QMap>
+#include <QPainter>
+#include <QPdfWriter>
+#include <QPageSize>
+#include <QPageLayout>
+#include <QTextDocument>
+#include <QTextFrame>
+#include <QTextStream>
+
+bool MonthlyStats::load(DatabaseManager &db, int year, MonthlyStats &stats, QString *error)
+{
+    stats = MonthlyStats();
+    stats.year = year;
+    if (!db.ordersPerMonth(year, stats.orders, stats.revenue, error))
+        return false;
+    for (int mois = 0; mois < 12; ++mois) {
+        stats.totalOrders += stats.orders[mois];
+        stats.totalRevenue += stats.revenue[mois];
+    }
+    return true;
+}
+
+QString ReportGenerator::reportStyle()
+{
+    QString css;
+    css += "body { font-family: Arial, sans-serif; margin: 20px; }";
+    css += "h1 { color: #2a7fff; text-align: center; }";
+    css += "h2 { color: #333; border-bottom: 2px solid #2a7fff; padding-bottom: 5px; }";
+    css += "table { width: 100%; border-collapse: collapse; margin: 20px 0; }";
+    css += "th { background-color: #2a7fff; color: white; padding: 10px; text-align: left; }";
+    css += "td { padding: 8px; border: 1px solid #ddd; }";
+    css += "tr:nth-child(even) { background-color: #f2f2f2; }";
+    css += ".summary { background-color: #e8f4ff; padding: 15px; border-radius: 5px; margin: 20px 0; }";
+    css += ".total { font-weight: bold; color: #2a7fff; }";
+    return css;
+}
+
+bool ReportGenerator::generatePDF(const QString &fileName, const QString &htmlContent)
+{
+    // QPdfWriter rather than QPrinter: it only needs QtGui and works off the GUI thread
+    QPdfWriter writer(fileName);
+    writer.setResolution(1200);
+    writer.setPageSize(QPageSize(QPageSize::A4));
+    writer.setPageOrientation(QPageLayout::Portrait);
+
+    // Laid out for the writer like QTextDocument::print does (2 cm margins),
+    // but painted here so an unwritable file or a failed end is reported
+    QTextDocument document;
+    document.documentLayout()->setPaintDevice(&writer);
+    document.setHtml(htmlContent);
+    const QRect page = writer.pageLayout().paintRectPixels(writer.resolution());
+    document.setPageSize(page.size());
+    QTextFrameFormat frame = document.rootFrame()->frameFormat();
+    frame.setMargin(2 / 2.54 * writer.resolution());
+    document.rootFrame()->setFrameFormat(frame);
+
+    QPainter painter;
+    if (!painter.begin(&writer)) {
+        qWarning() << "PDF creation failed:" << fileName;
+        return false;
+    }
+    for (int i = 0; i < document.pageCount(); ++i) {
+        if (i > 0 && !writer.newPage()) {
+            painter.end();
+            return false;
+        }
+        const QRectF clip(0, i * page.height(), page.width(), page.height());
+        painter.save();
+        painter.translate(0, -clip.top());
+        document.drawContents(&painter, clip);
+        painter.restore();
+    }
+    return painter.end();
+}
+
+ReportGenerator::Result ReportGenerator::exportClientsPDF(DatabaseManager &db, const QString &fileName)
+{
+    Result result;
+    RowCursor<ClientRow> cursor = db.clientsCursor();
+
+    if (!cursor.isActive()) {
+        result.error = "Impossible de récupérer les clients: " + cursor.lastError().text();
+        return result;
+    }
+
+    // Rows and totals in one pass, the summary is placed above the table afterwards
+    int totalClients = 0;
+    int totalCommands = 0;
+    QString rows;
+    ClientRow client;
+    while (cursor.next(client)) {
+        totalClients++;
+        totalCommands += client.nbCommandes;
+        rows += "<tr>";
+        rows += "<td>" + QString::number(client.idClient) + "</td>";
+        rows += "<td>" + client.nom + "</td>";
+        rows += "<td>" + client.prenom + "</td>";
+        rows += "<td>" + client.email + "</td>";
+        rows += "<td>" + client.telephone + "</td>";
+        rows += "<td>" + client.adresse + "</td>";
+        rows += "<td>" + QString::number(client.nbCommandes) + "</td>";
+        rows += "</tr>";
+    }
+
+    QString html;
+    html += "<html><head><style>" + reportStyle() + "</style></head><body>";
+
+    // Header
+    html += "<h1>Liste des Clients</h1>";
+    html += "<p>Généré le: " + QDateTime::currentDateTime().toString("dd/MM/yyyy à HH:mm") + "</p>";
+
+    // Summary
+    html += "<div class='summary'>";
+    html += "<h2>Résumé</h2>";
+    html += "<p>Total des clients: <span class='total'>" + QString::number(totalClients) + "</span></p>";
+    html += "<p>Total des commandes: <span class='total'>" + QString::number(totalCommands) + "</span></p>";
+    html += "<p>Moyenne par client: <span class='total'>" + (totalClients > 0 ? QString::number(static_cast<double>(totalCommands) / totalClients, 'f', 1) : "0") + "</span></p>";
+    html += "</div>";
+
+    // Table
+    html += "<h2>Détail des Clients</h2>";
+    html += "<table>";
+    html += "<tr>";
+    html += "<th>ID</th>";
+    html += "<th>Nom</th>";
+    html += "<th>Prénom</th>";
+    html += "<th>Email</th>";
+    html += "<th>Téléphone</th>";
+    html += "<th>Adresse</th>";
+    html += "<th>Nb Commandes</th>";
+    html += "</tr>";
+    html += rows;
+    html += "</table>";
+    html += "</body></html>";
+
+    if (!generatePDF(fileName, html)) {
+        result.error = "Impossible d'écrire le fichier " + fileName;
+        return result;
+    }
+    result.ok = true;
+    result.rows = totalClients;
+    return result;
+}
+
+ReportGenerator::Result ReportGenerator::exportCommandesMonthPDF(DatabaseManager &db, const QDate &month, const QString &fileName)
+{
+    Result result;
+    RowCursor<CommandeRow> cursor = db.commandesForMonthCursor(month);
+
+    if (!cursor.isActive()) {
+        result.error = "Impossible de récupérer les commandes du mois: " + cursor.lastError().text();
+        return result;
+    }
+
+    int totalCommandes = 0;
+    double totalMontant = 0.0;
+    QMap<QString, int> statutsCount;
+    QString rows;
+    CommandeRow commande;
+    while (cursor.next(commande)) {
+        totalCommandes++;
+        totalMontant += commande.montantTotal;
+        statutsCount[commande.statut]++;
+
+        rows += "<tr>";
+        rows += "<td>" + QString::number(commande.idCommande) + "</td>";
+        rows += "<td>" + commande.prenom + " " + commande.nom + "</td>";
+        rows += "<td>" + commande.dateCommande.toString("dd/MM/yyyy HH:mm") + "</td>";
+        rows += "<td>" + commande.statut + "</td>";
+        rows += "<td>" + QString::number(commande.montantTotal, 'f', 2) + " €</td>";
+        rows += "<td>" + commande.moyenPaiement + "</td>";
+        rows += "<td>" + commande.remarque + "</td>";
+        rows += "</tr>";
+    }
+
+    QString html;
+    html += "<html><head><style>" + reportStyle() + "</style></head><body>";
+
+    // Header
+    html += "<h1>Rapport des Commandes - " + month.toString("MMMM yyyy") + "</h1>";
+    html += "<p>Généré le: " + QDateTime::currentDateTime().toString("dd/MM/yyyy à HH:mm") + "</p>";
+
+    // Summary
+    html += "<div class='summary'>";
+    html += "<h2>Résumé</h2>";
+    html += "<p>Total des commandes: <span class='total'>" + QString::number(totalCommandes) + "</span></p>";
+    html += "<p>Chiffre d'affaires total: <span class='total'>" + QString::number(totalMontant, 'f', 2) + " €</span></p>";
+    html += "<p>Répartition par statut:</p><ul>";
+    for (auto it = statutsCount.begin(); it != statutsCount.end(); ++it) {
+        html += "<li>" + it.key() + ": " + QString::number(it.value()) + "</li>";
+    }
+    html += "</ul></div>";
+
+    // Table
+    html += "<h2>Détail des Commandes</h2>";
+    html += "<table>";
+    html += "<tr>";
+    html += "<th>ID</th>";
+    html += "<th>Client</th>";
+    html += "<th>Date</th>";
+    html += "<th>Statut</th>";
+    html += "<th>Montant</th>";
+    html += "<th>Paiement</th>";
+    html += "<th>Remarque</th>";
+    html += "</tr>";
+    html += rows;
+    html += "</table>";
+    html += "</body></html>";
+
+    if (!generatePDF(fileName, html)) {
+        result.error = "Impossible d'écrire le fichier " + fileName;
+        return result;
+    }
+    result.ok = true;
+    result.rows = totalCommandes;
+    return result;
+}
+
+QString ReportGenerator::statisticsText(const MonthlyStats &stats)
+{
+    static const QStringList months = {"Jan", "Fév", "Mar", "Avr", "Mai", "Jun",
+                                       "Jul", "Aoû", "Sep", "Oct", "Nov", "Déc"};
+    QString text;
+    text += "Mois;Commandes;Chiffre d'affaires\n";
+    for (int i = 0; i < 12; ++i) {
+        text += QString("%1;%2;%3\n").arg(months.at(i),
+                                          QString::number(stats.orders.at(i)),
+                                          QString::number(stats.revenue.at(i), 'f', 2));
+    }
+    text += QString("Total;%1;%2\n").arg(QString::number(stats.totalOrders),
+                                         QString::number(stats.totalRevenue, 'f', 2));
+    return text;
+}
+
+ReportGenerator::Result ReportGenerator::exportStatistics(DatabaseManager &db, int year, const QString &fileName)
+{
+    Result result;
+    MonthlyStats stats;
+    QString error;
+    if (!MonthlyStats::load(db, year, stats, &error)) {
+        result.error = "Impossible de calculer les statistiques: " + error;
+        return result;
+    }
+    result.rows = stats.totalOrders;
+
+    if (fileName.endsWith(".pdf", Qt::CaseInsensitive)) {
+        QString html;
+        html += "<html><head><style>" + reportStyle() + "</style></head><body>";
+        html += "<h1>Statistiques " + QString::number(year) + "</h1>";
+        html += "<div class='summary'>";
+        html += "<p>Total Commandes: <span class='total'>" + QString::number(stats.totalOrders) + "</span></p>";
+        html += "<p>Chiffre d'Affaires Total: <span class='total'>" + QString::number(stats.totalRevenue, 'f', 2) + " €</span></p>";
+        html += "<p>Moyenne par Commande: <span class='total'>"
+                + (stats.totalOrders > 0 ? QString::number(stats.totalRevenue / stats.totalOrders, 'f', 2) : QString("0.00"))
+                + " €</span></p>";
+        html += "</div><table><tr><th>Mois</th><th>Commandes</th><th>Chiffre d'affaires</th></tr>";
+        const QStringList lines = statisticsText(stats).split('\n', Qt::SkipEmptyParts);
+        for (int i = 1; i < lines.size(); ++i) {
+            const QStringList cells = lines.at(i).split(';');
+            html += "<tr><td>" + cells.value(0) + "</td><td>" + cells.value(1) + "</td><td>" + cells.value(2) + " €</td></tr>";
+        }
+        html += "</table></body></html>";
+        if (!generatePDF(fileName, html)) {
+            result.error = "Impossible d'écrire le fichier " + fileName;
+            return result;
+        }
+    } else {
+        QFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            result.error = "Impossible d'écrire le fichier " + fileName;
+            return result;
+        }
+        QTextStream out(&file);
+        out << statisticsText(stats);
+    }
+
+    result.ok = true;
+    return result;
+}
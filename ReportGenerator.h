@@ -0,0 +1,46 @@
+#ifndef REPORTGENERATOR_H
+#define REPORTGENERATOR_H
+
+#include <QString>
+#include <QVector>
+#include <QDate>
+#include <QSqlQuery>
+
+class DatabaseManager;
+
+// Orders and revenue per month of one year, as returned by ordersPerMonth()
+struct MonthlyStats
+{
+    int year = 0;
+    QVector<int> orders = QVector<int>(12, 0);
+    QVector<double> revenue = QVector<double>(12, 0.0);
+    int totalOrders = 0;
+    double totalRevenue = 0.0;
+
+    // From db.ordersPerMonth(); false with the error if it failed
+    static bool load(DatabaseManager &db, int year, MonthlyStats &stats, QString *error = nullptr);
+};
+
+// Report rendering shared by the GUI and the headless batch mode.
+// No widgets involved: safe to call from worker threads, one
+// DatabaseManager (connection) per thread.
+class ReportGenerator
+{
+public:
+    struct Result {
+        bool ok = false;
+        int rows = 0;
+        QString error;
+    };
+
+    static Result exportCommandesMonthPDF(DatabaseManager &db, const QDate &month, const QString &fileName);
+    static Result exportClientsPDF(DatabaseManager &db, const QString &fileName);
+    // PDF if fileName ends with .pdf, semicolon-separated text otherwise
+    static Result exportStatistics(DatabaseManager &db, int year, const QString &fileName);
+
+    static QString statisticsText(const MonthlyStats &stats);
+    static QString reportStyle();
+    static bool generatePDF(const QString &fileName, const QString &htmlContent);
+};
+
+#endif // REPORTGENERATOR_H
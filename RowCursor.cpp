@@ -0,0 +1,52 @@
+#include "RowCursor.h"
+
+namespace {
+QString stringAt(const QSqlQuery &query, int column)
+{
+    return column >= 0 ? query.value(column).toString() : QString();
+}
+
+int intAt(const QSqlQuery &query, int column)
+{
+    return column >= 0 ? query.value(column).toInt() : 0;
+}
+}
+
+ClientRow::Columns ClientRow::resolve(const QSqlRecord &record)
+{
+    return Columns{record.indexOf("id_client"), record.indexOf("nom"),       record.indexOf("prenom"),
+                   record.indexOf("email"),     record.indexOf("telephone"), record.indexOf("adresse"),
+                   record.indexOf("nb_commandes")};
+}
+
+void ClientRow::read(const QSqlQuery &query, const Columns &columns, ClientRow &row)
+{
+    row.idClient = intAt(query, columns.idClient);
+    row.nom = stringAt(query, columns.nom);
+    row.prenom = stringAt(query, columns.prenom);
+    row.email = stringAt(query, columns.email);
+    row.telephone = stringAt(query, columns.telephone);
+    row.adresse = stringAt(query, columns.adresse);
+    row.nbCommandes = intAt(query, columns.nbCommandes);
+}
+
+CommandeRow::Columns CommandeRow::resolve(const QSqlRecord &record)
+{
+    return Columns{record.indexOf("id_commande"),    record.indexOf("id_client"), record.indexOf("nom"),
+                   record.indexOf("prenom"),         record.indexOf("date_commande"),
+                   record.indexOf("statut"),         record.indexOf("montant_total"),
+                   record.indexOf("moyen_paiement"), record.indexOf("remarque")};
+}
+
+void CommandeRow::read(const QSqlQuery &query, const Columns &columns, CommandeRow &row)
+{
+    row.idCommande = intAt(query, columns.idCommande);
+    row.idClient = intAt(query, columns.idClient);
+    row.nom = stringAt(query, columns.nom);
+    row.prenom = stringAt(query, columns.prenom);
+    row.dateCommande = columns.dateCommande >= 0 ? query.value(columns.dateCommande).toDateTime() : QDateTime();
+    row.statut = stringAt(query, columns.statut);
+    row.montantTotal = columns.montantTotal >= 0 ? query.value(columns.montantTotal).toDouble() : 0.0;
+    row.moyenPaiement = stringAt(query, columns.moyenPaiement);
+    row.remarque = stringAt(query, columns.remarque);
+}
@@ -0,0 +1,114 @@
+#ifndef ROWCURSOR_H
+#define ROWCURSOR_H
+
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QSqlError>
+#include <QDateTime>
+#include <QVector>
+#include <functional>
+
+// One line of the client list (client columns + number of orders)
+struct ClientRow
+{
+    int idClient = 0;
+    QString nom;
+    QString prenom;
+    QString email;
+    QString telephone;
+    QString adresse;
+    int nbCommandes = 0;
+
+    // Column positions, looked up once per query
+    struct Columns {
+        int idClient, nom, prenom, email, telephone, adresse, nbCommandes;
+    };
+    static Columns resolve(const QSqlRecord &record);
+    static void read(const QSqlQuery &query, const Columns &columns, ClientRow &row);
+};
+
+// One order joined with its client name
+struct CommandeRow
+{
+    int idCommande = 0;
+    int idClient = 0;
+    QString nom;
+    QString prenom;
+    QDateTime dateCommande;
+    QString statut;
+    double montantTotal = 0.0;
+    QString moyenPaiement;
+    QString remarque;
+
+    struct Columns {
+        int idCommande, idClient, nom, prenom, dateCommande, statut, montantTotal, moyenPaiement, remarque;
+    };
+    static Columns resolve(const QSqlRecord &record);
+    static void read(const QSqlQuery &query, const Columns &columns, CommandeRow &row);
+};
+
+// Typed reader over an executed forward-only query. Column names are
+// resolved once, then every row is read by position into a Row struct.
+// A column missing from the query keeps the Row default.
+// It can also hand out rows already read, e.g. merged from several
+// connections (see OrderShards.h); error is then the read failure, if any.
+// setFill() completes each row after it is read (e.g. names from memory).
+template <typename Row>
+class RowCursor
+{
+public:
+    explicit RowCursor(QSqlQuery query)
+        : m_query(std::move(query)), m_columns(Row::resolve(m_query.record()))
+    {
+    }
+
+    explicit RowCursor(QVector<Row> rows, const QSqlError &error = QSqlError())
+        : m_columns(), m_rows(std::move(rows)), m_buffered(true), m_error(error)
+    {
+    }
+
+    bool isActive() const { return m_buffered ? !m_error.isValid() : m_query.isActive(); }
+    QSqlError lastError() const { return m_buffered ? m_error : m_query.lastError(); }
+    void setFill(std::function<void(Row &)> fill) { m_fill = std::move(fill); }
+
+    bool next(Row &row)
+    {
+        if (m_buffered) {
+            if (m_position >= m_rows.size())
+                return false;
+            row = m_rows.at(m_position++);
+        } else {
+            if (!m_query.next())
+                return false;
+            Row::read(m_query, m_columns, row);
+        }
+        if (m_fill)
+            m_fill(row);
+        return true;
+    }
+
+    // Replaces the content of batch with up to batchSize rows; the vector
+    // keeps its capacity between calls. Returns false once nothing is left.
+    bool fetch(QVector<Row> &batch, int batchSize = 512)
+    {
+        batch.resize(batchSize);
+        int count = 0;
+        while (count < batchSize && next(batch[count]))
+            count++;
+        batch.resize(count);
+        return count > 0;
+    }
+
+private:
+    QSqlQuery m_query;
+    typename Row::Columns m_columns;
+
+    QVector<Row> m_rows;
+    int m_position = 0;
+    bool m_buffered = false;
+    QSqlError m_error;
+
+    std::function<void(Row &)> m_fill;
+};
+
+#endif // ROWCURSOR_H
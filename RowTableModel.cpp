@@ -0,0 +1,442 @@
+#include "RowTableModel.h"
+#include "OrderCodes.h"
+#include "PerfMonitor.h"
+#include <QCollator>
+#include <QSet>
+#include <QThread>
+#include <QtConcurrent>
+#include <algorithm>
+#include <numeric>
+#include <optional>
+#include <vector>
+
+namespace {
+// Below this many rows one thread is faster than splitting the work
+const int ParallelThreshold = 20000;
+
+// Runs fn(begin, end) over [0, count) split in one range per thread
+template <typename Fn>
+void forChunks(int count, Fn fn)
+{
+    const int chunks = count < ParallelThreshold ? 1 : qMax(1, QThread::idealThreadCount());
+    if (chunks == 1) {
+        fn(0, count);
+        return;
+    }
+    QList<int> parts;
+    for (int p = 0; p < chunks; ++p)
+        parts << p;
+    QtConcurrent::blockingMap(parts, [count, chunks, &fn](int p) {
+        fn(int(qint64(count) * p / chunks), int(qint64(count) * (p + 1) / chunks));
+    });
+}
+
+// Stable sort: ranges sorted in parallel, then merged pairwise
+template <typename Less>
+void parallelStableSort(QVector<int> &items, Less less)
+{
+    const int count = items.size();
+    const int chunks = count < ParallelThreshold ? 1 : qMax(1, QThread::idealThreadCount());
+    int *data = items.data();
+    if (chunks == 1) {
+        std::stable_sort(data, data + count, less);
+        return;
+    }
+
+    QVector<int> bounds;
+    for (int p = 0; p <= chunks; ++p)
+        bounds << int(qint64(count) * p / chunks);
+    forChunks(count, [data, less](int begin, int end) { std::stable_sort(data + begin, data + end, less); });
+    for (int width = 1; width < chunks; width *= 2) {
+        for (int p = 0; p + width < chunks; p += 2 * width)
+            std::inplace_merge(data + bounds.at(p), data + bounds.at(p + width),
+                               data + bounds.at(qMin(p + 2 * width, chunks)), less);
+    }
+}
+
+// Rows keep their place when replaced; upserts not found are added at the
+// end, or in front in reverse order (latest upsert first)
+template <typename Row, typename IdOf, typename Drop>
+QVector<Row> mergeById(const QVector<Row> &rows, const QVector<Row> &upserts, IdOf idOf, Drop drop, bool prependNew)
+{
+    QHash<int, int> pending; // id -> latest position in upserts
+    for (int i = 0; i < upserts.size(); ++i)
+        pending.insert(idOf(upserts.at(i)), i);
+
+    QVector<Row> kept;
+    kept.reserve(rows.size() + upserts.size());
+    for (const Row &row : rows) {
+        if (drop(row))
+            continue;
+        auto it = pending.find(idOf(row));
+        if (it == pending.end()) {
+            kept << row;
+        } else {
+            kept << upserts.at(it.value());
+            pending.erase(it);
+        }
+    }
+
+    QVector<Row> added;
+    for (int i = 0; i < upserts.size(); ++i) {
+        const Row &row = upserts.at(i);
+        if (pending.value(idOf(row), -1) == i && !drop(row))
+            added << row;
+    }
+    if (!prependNew)
+        return kept + added;
+    std::reverse(added.begin(), added.end());
+    return added + kept;
+}
+}
+
+RowTableModel::RowTableModel(const QString &screen, const QStringList &headers, QObject *parent)
+    : QAbstractTableModel(parent), m_screen(screen), m_headers(headers)
+{
+}
+
+int RowTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_visible.size();
+}
+
+int RowTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_headers.size();
+}
+
+QVariant RowTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_visible.size())
+        return QVariant();
+
+    if (role == Qt::DisplayRole)
+        return text(m_visible.at(index.row()), index.column());
+    if (role == Qt::UserRole)
+        return int(number(m_visible.at(index.row()), 0));
+    if (role == Qt::TextAlignmentRole && isNumeric(index.column()))
+        return QVariant(Qt::AlignRight | Qt::AlignVCenter);
+    return QVariant();
+}
+
+QVariant RowTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole)
+        return m_headers.value(section);
+    return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+void RowTableModel::sort(int column, Qt::SortOrder order)
+{
+    if (column == m_sortColumn && order == m_sortOrder)
+        return;
+
+    PerfMonitor::Scope scope(m_screen + " (tri)", PerfMonitor::Populate);
+    m_sortColumn = column < m_headers.size() ? column : -1;
+    m_sortOrder = order;
+
+    // Selected rows stay selected wherever they move
+    emit layoutAboutToBeChanged();
+    const QModelIndexList before = persistentIndexList();
+    QVector<int> sources;
+    sources.reserve(before.size());
+    for (const QModelIndex &index : before)
+        sources << (index.isValid() ? m_visible.value(index.row(), -1) : -1);
+
+    applyOrder();
+    applyFilter();
+
+    QVector<int> position(m_size, -1);
+    for (int row = 0; row < m_visible.size(); ++row)
+        position[m_visible.at(row)] = row;
+    QModelIndexList after;
+    after.reserve(before.size());
+    for (int i = 0; i < before.size(); ++i) {
+        const int row = sources.at(i) < 0 ? -1 : position.at(sources.at(i));
+        after << (row < 0 ? QModelIndex() : index(row, before.at(i).column()));
+    }
+    changePersistentIndexList(before, after);
+    emit layoutChanged();
+}
+
+void RowTableModel::setFilter(int column, const QString &text)
+{
+    const QString filter = text.trimmed();
+    if (column == m_filterColumn && filter == m_filterText)
+        return;
+
+    PerfMonitor::Scope scope(m_screen + " (filtre)", PerfMonitor::Populate);
+    beginResetModel();
+    m_filterColumn = column < m_headers.size() ? column : -1;
+    m_filterText = filter;
+    applyFilter();
+    endResetModel();
+}
+
+void RowTableModel::rowsReplaced(int count)
+{
+    m_size = count;
+    m_keys.clear();
+    applyOrder();
+    applyFilter();
+}
+
+// Rank of every source row in the column: built with one (parallel) sort
+// on the first use of the column, equal values get the same rank
+const QVector<int> &RowTableModel::sortKeys(int column)
+{
+    auto it = m_keys.find(column);
+    if (it != m_keys.end())
+        return it.value();
+
+    QVector<int> sorted(m_size);
+    std::iota(sorted.begin(), sorted.end(), 0);
+    QVector<int> ranks(m_size, 0);
+
+    auto assignRanks = [&](auto equal) {
+        int rank = 0;
+        for (int i = 0; i < m_size; ++i) {
+            if (i > 0 && !equal(sorted.at(i - 1), sorted.at(i)))
+                rank = i;
+            ranks[sorted.at(i)] = rank;
+        }
+    };
+
+    if (isNumeric(column)) {
+        QVector<double> values(m_size);
+        double *out = values.data();
+        forChunks(m_size, [this, out, column](int begin, int end) {
+            for (int row = begin; row < end; ++row)
+                out[row] = number(row, column);
+        });
+        const double *value = values.constData();
+        parallelStableSort(sorted, [value](int a, int b) { return value[a] < value[b]; });
+        assignRanks([value](int a, int b) { return value[a] == value[b]; });
+    } else {
+        // French collation keys, computed once: "Élodie" sorts with the E,
+        // not after "Zoé" as in UTF-16 order. One collator per range, they
+        // are not shared between threads.
+        std::vector<std::optional<QCollatorSortKey>> values(m_size);
+        std::optional<QCollatorSortKey> *out = values.data();
+        forChunks(m_size, [this, out, column](int begin, int end) {
+            QCollator collator(QLocale(QLocale::French, QLocale::France));
+            collator.setCaseSensitivity(Qt::CaseInsensitive);
+            for (int row = begin; row < end; ++row)
+                out[row].emplace(collator.sortKey(text(row, column)));
+        });
+        const std::optional<QCollatorSortKey> *value = values.data();
+        parallelStableSort(sorted, [value](int a, int b) { return value[a]->compare(*value[b]) < 0; });
+        assignRanks([value](int a, int b) { return value[a]->compare(*value[b]) == 0; });
+    }
+    return m_keys.insert(column, ranks).value();
+}
+
+// Ranks are below m_size (equal values share the position of the first of
+// them), so ordering the rows is a stable counting sort
+void RowTableModel::applyOrder()
+{
+    m_order.resize(m_size);
+    if (m_sortColumn < 0) {
+        std::iota(m_order.begin(), m_order.end(), 0);
+        return;
+    }
+
+    const QVector<int> &keys = sortKeys(m_sortColumn);
+    const bool descending = m_sortOrder == Qt::DescendingOrder;
+    QVector<int> start(m_size + 1, 0);
+    for (int row = 0; row < m_size; ++row)
+        start[(descending ? m_size - 1 - keys.at(row) : keys.at(row)) + 1]++;
+    for (int rank = 0; rank < m_size; ++rank)
+        start[rank + 1] += start.at(rank);
+    for (int row = 0; row < m_size; ++row)
+        m_order[start[descending ? m_size - 1 - keys.at(row) : keys.at(row)]++] = row;
+}
+
+void RowTableModel::applyFilter()
+{
+    if (m_filterText.isEmpty()) {
+        m_visible = m_order;
+        return;
+    }
+
+    auto matches = [this](int source) {
+        if (m_filterColumn >= 0)
+            return text(source, m_filterColumn).contains(m_filterText, Qt::CaseInsensitive);
+        for (int column = 0; column < m_headers.size(); ++column) {
+            if (text(source, column).contains(m_filterText, Qt::CaseInsensitive))
+                return true;
+        }
+        return false;
+    };
+
+    // Each range keeps a flag per row, then the kept rows are gathered in order
+    QVector<char> keep(m_order.size(), 0);
+    char *flags = keep.data();
+    const int *order = m_order.constData();
+    forChunks(m_order.size(), [flags, order, &matches](int begin, int end) {
+        for (int i = begin; i < end; ++i)
+            flags[i] = matches(order[i]) ? 1 : 0;
+    });
+
+    m_visible.clear();
+    for (int i = 0; i < m_order.size(); ++i) {
+        if (keep.at(i))
+            m_visible << m_order.at(i);
+    }
+}
+
+// ---- ClientTableModel ----
+ClientTableModel::ClientTableModel(QObject *parent)
+    : RowTableModel("clientsTable", {"ID", "Nom", "Prénom", "Email", "Téléphone", "Adresse", "Nb Commandes"}, parent)
+{
+}
+
+void ClientTableModel::setRows(QVector<ClientRow> rows)
+{
+    beginResetModel();
+    m_rows = std::move(rows);
+    rowsReplaced(m_rows.size());
+    endResetModel();
+}
+
+void ClientTableModel::mergeRows(const QVector<ClientRow> &upserts, const QList<int> &removedIds)
+{
+    const QSet<int> removed(removedIds.cbegin(), removedIds.cend());
+    beginResetModel();
+    m_rows = mergeById(
+        m_rows, upserts, [](const ClientRow &row) { return row.idClient; },
+        [&removed](const ClientRow &row) { return removed.contains(row.idClient); }, false);
+    rowsReplaced(m_rows.size());
+    endResetModel();
+}
+
+void ClientTableModel::appendRows(const QVector<ClientRow> &rows)
+{
+    beginResetModel();
+    m_rows = mergeById(
+        m_rows, rows, [](const ClientRow &row) { return row.idClient; }, [](const ClientRow &) { return false; },
+        false);
+    rowsReplaced(m_rows.size());
+    endResetModel();
+}
+
+bool ClientTableModel::rowById(int id, ClientRow &out) const
+{
+    for (const ClientRow &row : m_rows) {
+        if (row.idClient == id) {
+            out = row;
+            return true;
+        }
+    }
+    return false;
+}
+
+// A negative id is a row waiting in the write queue
+QString ClientTableModel::text(int source, int column) const
+{
+    const ClientRow &row = m_rows.at(source);
+    switch (column) {
+    case 0: return row.idClient < 0 ? QString("⏳") : QString::number(row.idClient);
+    case 1: return row.nom;
+    case 2: return row.prenom;
+    case 3: return row.email;
+    case 4: return row.telephone;
+    case 5: return row.adresse;
+    case 6: return QString::number(row.nbCommandes);
+    }
+    return QString();
+}
+
+bool ClientTableModel::isNumeric(int column) const
+{
+    return column == 0 || column == 6;
+}
+
+double ClientTableModel::number(int source, int column) const
+{
+    const ClientRow &row = m_rows.at(source);
+    return column == 0 ? row.idClient : row.nbCommandes;
+}
+
+// ---- CommandeTableModel ----
+CommandeTableModel::CommandeTableModel(QObject *parent)
+    : RowTableModel("commandesTable", {"ID", "Client", "Date", "Statut", "Montant", "Paiement", "Remarque"}, parent)
+{
+}
+
+void CommandeTableModel::setRows(QVector<CommandeRow> rows)
+{
+    beginResetModel();
+    m_rows = std::move(rows);
+    rowsReplaced(m_rows.size());
+    endResetModel();
+}
+
+void CommandeTableModel::mergeRows(const QVector<CommandeRow> &upserts, const QList<int> &removedIds,
+                                   const QList<int> &removedClients)
+{
+    const QSet<int> removed(removedIds.cbegin(), removedIds.cend());
+    const QSet<int> clients(removedClients.cbegin(), removedClients.cend());
+    beginResetModel();
+    m_rows = mergeById(
+        m_rows, upserts, [](const CommandeRow &row) { return row.idCommande; },
+        [&removed, &clients](const CommandeRow &row) {
+            return removed.contains(row.idCommande) || clients.contains(row.idClient);
+        },
+        true);
+    rowsReplaced(m_rows.size());
+    endResetModel();
+}
+
+void CommandeTableModel::appendRows(const QVector<CommandeRow> &rows)
+{
+    beginResetModel();
+    m_rows = mergeById(
+        m_rows, rows, [](const CommandeRow &row) { return row.idCommande; },
+        [](const CommandeRow &) { return false; }, false);
+    rowsReplaced(m_rows.size());
+    endResetModel();
+}
+
+bool CommandeTableModel::rowById(int id, CommandeRow &out) const
+{
+    for (const CommandeRow &row : m_rows) {
+        if (row.idCommande == id) {
+            out = row;
+            return true;
+        }
+    }
+    return false;
+}
+
+QString CommandeTableModel::text(int source, int column) const
+{
+    const CommandeRow &row = m_rows.at(source);
+    switch (column) {
+    case 0: return row.idCommande < 0 ? QString("⏳") : QString::number(row.idCommande);
+    case 1: return row.prenom + " " + row.nom;
+    case 2: return row.dateCommande.toString("dd/MM/yyyy hh:mm");
+    case 3: return OrderCodes::label(row.statut);
+    case 4: return QString::number(row.montantTotal, 'f', 2) + " €";
+    case 5: return OrderCodes::label(row.moyenPaiement);
+    case 6: return row.remarque;
+    }
+    return QString();
+}
+
+// The date sorts chronologically, not as dd/MM text
+bool CommandeTableModel::isNumeric(int column) const
+{
+    return column == 0 || column == 2 || column == 4;
+}
+
+double CommandeTableModel::number(int source, int column) const
+{
+    const CommandeRow &row = m_rows.at(source);
+    switch (column) {
+    case 0: return row.idCommande;
+    case 2: return double(row.dateCommande.toMSecsSinceEpoch());
+    case 4: return row.montantTotal;
+    }
+    return 0.0;
+}
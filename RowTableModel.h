@@ -0,0 +1,110 @@
+#ifndef ROWTABLEMODEL_H
+#define ROWTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+#include "RowCursor.h"
+
+// Read-only table over rows already loaded in memory. Header-click sorting
+// and the quick filter never touch the rows nor re-run SQL: they rebuild
+// the list of row positions shown by the view. Each column is ranked once
+// per load (see sortKeys()), later sorts only compare integers.
+class RowTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    // screen: PerfMonitor name for the sort / filter timings
+    RowTableModel(const QString &screen, const QStringList &headers, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    // Qt::UserRole gives the row id (number of column 0)
+    // column < 0 restores the order of the query
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+    // Case-insensitive substring on one column, or on every column if
+    // column < 0; an empty text shows every row
+    void setFilter(int column, const QString &text);
+    QStringList headers() const { return m_headers; }
+    int totalRows() const { return m_size; }
+
+protected:
+    virtual QString text(int source, int column) const = 0;
+    // Numeric columns sort by number() and are right-aligned
+    virtual bool isNumeric(int column) const { Q_UNUSED(column); return false; }
+    virtual double number(int source, int column) const { Q_UNUSED(source); Q_UNUSED(column); return 0.0; }
+
+    int sourceRow(int row) const { return m_visible.at(row); }
+    // Subclasses replace their rows between beginResetModel() and this
+    void rowsReplaced(int count);
+
+private:
+    const QVector<int> &sortKeys(int column);
+    void applyOrder();
+    void applyFilter();
+
+    QString m_screen;
+    QStringList m_headers;
+    int m_size = 0;
+    QVector<int> m_order;            // source rows in display order
+    QVector<int> m_visible;          // m_order without the filtered-out rows
+    QHash<int, QVector<int>> m_keys; // column -> rank of each source row
+    int m_sortColumn = -1;
+    Qt::SortOrder m_sortOrder = Qt::AscendingOrder;
+    int m_filterColumn = -1;
+    QString m_filterText;
+};
+
+class ClientTableModel : public RowTableModel
+{
+public:
+    explicit ClientTableModel(QObject *parent = nullptr);
+
+    void setRows(QVector<ClientRow> rows);
+    // Replaces the rows of the same id, appends the new ones and drops
+    // removedIds; sort and filter are re-applied
+    void mergeRows(const QVector<ClientRow> &upserts, const QList<int> &removedIds);
+    // Next page of the query: added at the end, rows already merged are replaced
+    void appendRows(const QVector<ClientRow> &rows);
+    // false if no loaded row has this id
+    bool rowById(int id, ClientRow &out) const;
+    // row as shown by the view
+    const ClientRow &rowAt(int row) const { return m_rows.at(sourceRow(row)); }
+
+protected:
+    QString text(int source, int column) const override;
+    bool isNumeric(int column) const override;
+    double number(int source, int column) const override;
+
+private:
+    QVector<ClientRow> m_rows;
+};
+
+class CommandeTableModel : public RowTableModel
+{
+public:
+    explicit CommandeTableModel(QObject *parent = nullptr);
+
+    void setRows(QVector<CommandeRow> rows);
+    // Same as ClientTableModel, new orders go first (newest first); the
+    // orders of removedClients go too
+    void mergeRows(const QVector<CommandeRow> &upserts, const QList<int> &removedIds,
+                   const QList<int> &removedClients = QList<int>());
+    void appendRows(const QVector<CommandeRow> &rows);
+    bool rowById(int id, CommandeRow &out) const;
+    const CommandeRow &rowAt(int row) const { return m_rows.at(sourceRow(row)); }
+
+protected:
+    QString text(int source, int column) const override;
+    bool isNumeric(int column) const override;
+    double number(int source, int column) const override;
+
+private:
+    QVector<CommandeRow> m_rows;
+};
+
+#endif // ROWTABLEMODEL_H
@@ -0,0 +1,19 @@
+#include "SearchKey.h"
+
+namespace SearchKey {
+
+QString normalize(const QString &text)
+{
+    const QString decomposed = text.normalized(QString::NormalizationForm_KD);
+    QString key;
+    key.reserve(decomposed.size());
+    for (const QChar c : decomposed) {
+        const QChar::Category category = c.category();
+        if (category != QChar::Mark_NonSpacing && category != QChar::Mark_SpacingCombining
+            && category != QChar::Mark_Enclosing)
+            key += c;
+    }
+    return key.toCaseFolded();
+}
+
+} // namespace SearchKey
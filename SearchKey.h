@@ -0,0 +1,17 @@
+#ifndef SEARCHKEY_H
+#define SEARCHKEY_H
+
+#include <QString>
+
+// Accent- and case-insensitive form of a name or an email: NFKD, combining
+// marks dropped, case-folded ("Élodie" -> "elodie", "ÇA" -> "ca"). Stored
+// next to the column it comes from (nom_key, prenom_key, email_key) when
+// the row is written, and applied to the searched text, so a search
+// compares plain indexed values instead of normalizing every row.
+namespace SearchKey {
+
+QString normalize(const QString &text);
+
+} // namespace SearchKey
+
+#endif // SEARCHKEY_H
@@ -0,0 +1,284 @@
+#include "SearchRunner.h"
+#include "AppSettings.h"
+#include "OrderShards.h"
+#include "PerfMonitor.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QSettings>
+#ifdef QTCREDIT_HAVE_SQLITE3
+#include <sqlite3.h>
+#endif
+
+SearchConfig SearchConfig::load(const QString &group)
+{
+    SearchConfig config;
+    QSettings settings(AppSettings::filePath(), QSettings::IniFormat);
+    settings.beginGroup(group);
+    config.timeoutMs = qMax(0, settings.value("timeout_s", config.timeoutMs / 1000).toInt()) * 1000;
+    config.pageSize = qMax(0, settings.value("page_size", config.pageSize).toInt());
+    settings.endGroup();
+    return config;
+}
+
+// ---- QueryCancel ----
+void QueryCancel::attach(const QSqlDatabase &db, const QSqlDatabase &control)
+{
+    if (!db.isOpen())
+        return;
+
+    if (db.driverName() == "QSQLITE") {
+#ifdef QTCREDIT_HAVE_SQLITE3
+        // Only valid when Qt's SQLite plugin uses the same library (-system-sqlite)
+        const QVariant handle = db.driver()->handle();
+        if (handle.isValid() && qstrcmp(handle.typeName(), "sqlite3*") == 0) {
+            sqlite3 *sqlite = *static_cast<sqlite3 *const *>(handle.constData());
+            QMutexLocker locker(&m_mutex);
+            if (sqlite)
+                m_sqlite << sqlite;
+        }
+#endif
+        return;
+    }
+
+    QSqlQuery q(db);
+    if (q.exec("SELECT CONNECTION_ID()") && q.next()) {
+        QMutexLocker locker(&m_mutex);
+        m_mysql << MySqlConnection{q.value(0).toLongLong(), control};
+    } else {
+        qWarning() << "Query cancel: CONNECTION_ID() failed:" << q.lastError().text();
+    }
+}
+
+void QueryCancel::begin(int serial)
+{
+    QMutexLocker locker(&m_mutex);
+    m_running = serial;
+    m_cancelled.storeRelease(false);
+}
+
+void QueryCancel::end()
+{
+    QMutexLocker locker(&m_mutex);
+    m_running = 0;
+}
+
+// The lock is held while the statement is killed, so the worker cannot
+// start its next one in between and have it killed instead
+void QueryCancel::cancel(int serial)
+{
+    QMutexLocker locker(&m_mutex);
+    if (serial == 0 || m_running != serial)
+        return;
+    m_cancelled.storeRelease(true);
+
+#ifdef QTCREDIT_HAVE_SQLITE3
+    for (void *sqlite : std::as_const(m_sqlite))
+        sqlite3_interrupt(static_cast<sqlite3 *>(sqlite));
+#endif
+    for (const MySqlConnection &connection : std::as_const(m_mysql)) {
+        if (!connection.control.isOpen())
+            continue;
+        QSqlQuery kill(connection.control);
+        if (!kill.exec(QString("KILL QUERY %1").arg(connection.id)))
+            qWarning() << "Query cancel: KILL QUERY failed:" << kill.lastError().text();
+    }
+}
+
+namespace {
+// Every row of the cursor; a cancel is seen at the next batch at the latest
+template <typename Row>
+SearchResult::Status fetchRows(RowCursor<Row> &cursor, const QueryCancel &cancel, QVector<Row> &rows,
+                               QString &error)
+{
+    if (!cursor.isActive()) {
+        if (cancel.isCancelled())
+            return SearchResult::Cancelled;
+        error = cursor.lastError().text();
+        return SearchResult::Failed;
+    }
+
+    QVector<Row> batch;
+    while (cursor.fetch(batch)) {
+        if (cancel.isCancelled())
+            return SearchResult::Cancelled;
+        rows += batch;
+    }
+    // An interrupted statement ends like an exhausted one
+    if (cancel.isCancelled())
+        return SearchResult::Cancelled;
+    if (cursor.lastError().isValid()) {
+        error = cursor.lastError().text();
+        return SearchResult::Failed;
+    }
+    return SearchResult::Done;
+}
+}
+
+// ---- SearchWorker ----
+SearchWorker::SearchWorker(const DatabaseConfig &databaseConfig, const ReplicaConfig &replicaConfig,
+                           const LocalReplica *replica, SearchRunner *runner)
+    : m_databaseConfig(databaseConfig), m_replicaConfig(replicaConfig), m_replica(replica), m_runner(runner)
+{
+    m_databaseConfig.manageSchema = false;
+}
+
+void SearchWorker::start()
+{
+    // The connections are created here so they belong to the search thread
+    m_db = new DatabaseManager(m_databaseConfig, this);
+    if (!m_db->open()) {
+        qWarning() << "Search: connexion à la base de données impossible";
+        return;
+    }
+    const ShardConfig shardConfig = ShardConfig::load();
+    if (shardConfig.enabled && !m_db->attachShards(shardConfig)) {
+        qWarning() << "Search: connexion aux partitions de commandes impossible";
+        delete m_db;
+        m_db = nullptr;
+        return;
+    }
+
+    QueryCancel &cancel = m_runner->m_cancel;
+    cancel.attach(m_db->getDatabase(), m_runner->m_control);
+    if (m_replica && m_db->shareLocalReplica(m_replicaConfig, m_replica))
+        cancel.attach(m_db->getReplicaDatabase(), QSqlDatabase());
+    if (m_db->attachReadReplica(ReadReplicaConfig::load()))
+        cancel.attach(m_db->getReadReplicaDatabase(), m_runner->m_readControl);
+    // No control connection on the shard servers: only SQLite shards are interrupted
+    if (m_db->orderShards())
+        m_db->orderShards()->scatter([&cancel](int, QSqlDatabase db) { cancel.attach(db, QSqlDatabase()); });
+}
+
+void SearchWorker::run(const SearchRequest &request)
+{
+    // Superseded while it waited behind the previous one
+    if (!m_runner->isLatest(request.serial))
+        return;
+
+    SearchResult result;
+    result.serial = request.serial;
+    result.kind = request.kind;
+    result.append = !request.after.isEmpty();
+    if (!m_db || !m_db->getDatabase().isOpen()) {
+        result.status = SearchResult::Failed;
+        result.error = "Connexion à la base de données impossible";
+        emit finished(result);
+        return;
+    }
+
+    QueryCancel &cancel = m_runner->m_cancel;
+    cancel.begin(request.serial);
+    const int limit = request.limit > 0 ? request.limit + 1 : 0;
+    QElapsedTimer timer;
+    timer.start();
+    if (request.kind == SearchRequest::Clients) {
+        const bool all = request.textLike.isEmpty();
+        RowCursor<ClientRow> cursor = all ? m_db->clientsCursor(limit, request.after)
+                                          : m_db->searchClientsCursor(request.textLike, limit, request.after);
+        PerfMonitor::record(request.screen, PerfMonitor::Query, timer.nsecsElapsed());
+        timer.restart();
+        result.status = fetchRows(cursor, cancel, result.clients, result.error);
+        if (result.status == SearchResult::Done && request.limit > 0 && result.clients.size() > request.limit) {
+            result.clients.resize(request.limit);
+            const ClientRow &last = result.clients.constLast();
+            if (all)
+                result.next = {last.nbCommandes, last.idClient};
+            else
+                result.next = {last.nom, last.prenom, last.idClient};
+        }
+    } else {
+        RowCursor<CommandeRow> cursor = m_db->commandesCursor(request.textLike, request.statut, request.fromDate,
+                                                              request.toDate, "date_desc", limit, request.after,
+                                                              request.query);
+        PerfMonitor::record(request.screen, PerfMonitor::Query, timer.nsecsElapsed());
+        timer.restart();
+        result.status = fetchRows(cursor, cancel, result.commandes, result.error);
+        if (result.status == SearchResult::Done && request.limit > 0 && result.commandes.size() > request.limit) {
+            result.commandes.resize(request.limit);
+            const CommandeRow &last = result.commandes.constLast();
+            result.next = {last.dateCommande, last.idCommande};
+        }
+    }
+    PerfMonitor::record(request.screen, PerfMonitor::Fetch, timer.nsecsElapsed());
+    cancel.end();
+
+    if (result.status != SearchResult::Done) {
+        result.clients.clear();
+        result.commandes.clear();
+    }
+    emit finished(result);
+}
+
+// ---- SearchRunner ----
+SearchRunner::SearchRunner(const QString &name, const DatabaseManager &gui, const ReplicaConfig &replicaConfig,
+                           QObject *parent)
+    : QObject(parent), m_control(gui.getDatabase()), m_readControl(gui.getReadReplicaDatabase())
+{
+    qRegisterMetaType<SearchResult>();
+    DatabaseConfig config = gui.config();
+    config.connectionName = name;
+    m_worker = new SearchWorker(config, replicaConfig, gui.localReplica(), this);
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::started, m_worker, &SearchWorker::start);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    connect(m_worker, &SearchWorker::finished, this, &SearchRunner::workerFinished);
+
+    m_timeout.setSingleShot(true);
+    connect(&m_timeout, &QTimer::timeout, this, [this]() {
+        m_timedOut = m_latest.loadAcquire();
+        cancel();
+    });
+}
+
+SearchRunner::~SearchRunner()
+{
+    cancel();
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void SearchRunner::start()
+{
+    m_thread.start();
+}
+
+int SearchRunner::run(SearchRequest request)
+{
+    cancel();
+    request.serial = m_latest.loadAcquire() + 1;
+    m_latest.storeRelease(request.serial);
+    m_timedOut = 0;
+    if (request.timeoutMs > 0)
+        m_timeout.start(request.timeoutMs);
+    else
+        m_timeout.stop();
+
+    QMetaObject::invokeMethod(m_worker, [worker = m_worker, request]() { worker->run(request); });
+    if (!m_busy) {
+        m_busy = true;
+        emit busyChanged(true);
+    }
+    return request.serial;
+}
+
+void SearchRunner::cancel()
+{
+    m_cancel.cancel(m_latest.loadAcquire());
+}
+
+void SearchRunner::workerFinished(const SearchResult &result)
+{
+    if (!isLatest(result.serial))
+        return;
+
+    m_timeout.stop();
+    m_busy = false;
+    emit busyChanged(false);
+    if (result.status == SearchResult::Cancelled && result.serial == m_timedOut) {
+        SearchResult timedOut = result;
+        timedOut.status = SearchResult::TimedOut;
+        emit finished(timedOut);
+        return;
+    }
+    emit finished(result);
+}
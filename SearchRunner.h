@@ -0,0 +1,149 @@
+#ifndef SEARCHRUNNER_H
+#define SEARCHRUNNER_H
+
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QMutex>
+#include <QAtomicInteger>
+#include "LocalReplica.h"
+
+// Settings of the [search] group of QTcredit.ini
+struct SearchConfig
+{
+    int timeoutMs = 30000; // a search still running after this is cancelled
+    int pageSize = 1000;   // rows per page, "Charger plus" reads the next one
+
+    static SearchConfig load(const QString &group = "search");
+};
+
+// One page of the client or order list
+struct SearchRequest
+{
+    enum Kind { Clients, Commandes };
+    Kind kind = Clients;
+    QString screen;         // PerfMonitor name
+    QString textLike;       // client LIKE (empty: every client, most orders first),
+                            // or client name of the orders
+    QString statut;
+    QDate fromDate;
+    QDate toDate;
+    OrderQuery query;       // orders only, ANDed with the fields above
+    QVariantList after;     // key of the last row shown, empty for the first page
+    int limit = 0;          // 0 = every row
+    int timeoutMs = 0;      // 0 = no timeout
+    int serial = 0;         // set by SearchRunner::run()
+};
+
+struct SearchResult
+{
+    enum Status { Done, Cancelled, TimedOut, Failed };
+    Status status = Done;
+    int serial = 0;
+    SearchRequest::Kind kind = SearchRequest::Clients;
+    bool append = false;            // next page of the rows shown
+    QVector<ClientRow> clients;
+    QVector<CommandeRow> commandes;
+    QVariantList next;              // after of the next page, empty once every row is read
+    QString error;
+};
+Q_DECLARE_METATYPE(SearchResult)
+
+// Stops the statement running on a connection from another thread:
+// KILL QUERY through a connection of the cancelling thread on MySQL,
+// sqlite3_interrupt() on SQLite (needs CONFIG+=qtcredit_sqlite3, see
+// QTcredit.pro). Row loops stop at their next batch through isCancelled()
+// in any case.
+class QueryCancel
+{
+public:
+    // In the thread owning db, once it is open; control is an open
+    // connection of the cancelling thread on the same MySQL server
+    void attach(const QSqlDatabase &db, const QSqlDatabase &control);
+    // Around each request; cancel() only reaches the serial running
+    void begin(int serial);
+    void end();
+    void cancel(int serial);
+    bool isCancelled() const { return m_cancelled.loadAcquire(); }
+
+private:
+    struct MySqlConnection {
+        qint64 id;            // CONNECTION_ID()
+        QSqlDatabase control;
+    };
+
+    QMutex m_mutex;
+    int m_running = 0;
+    QAtomicInteger<bool> m_cancelled = false;
+    QList<MySqlConnection> m_mysql;
+    QList<void *> m_sqlite;       // sqlite3 handles
+};
+
+class SearchRunner;
+
+// Runs in the search thread with its own connection
+class SearchWorker : public QObject
+{
+    Q_OBJECT
+public:
+    SearchWorker(const DatabaseConfig &databaseConfig, const ReplicaConfig &replicaConfig,
+                 const LocalReplica *replica, SearchRunner *runner);
+
+    // Queued from SearchRunner::run()
+    void run(const SearchRequest &request);
+
+public slots:
+    void start();
+
+signals:
+    void finished(const SearchResult &result);
+
+private:
+    DatabaseConfig m_databaseConfig;
+    ReplicaConfig m_replicaConfig;
+    const LocalReplica *m_replica;
+    SearchRunner *m_runner;
+    DatabaseManager *m_db = nullptr;
+};
+
+// Keeps the list queries off the GUI thread so they can be cancelled: a
+// new search or cancel() stops the running one at once, and a search
+// running past its timeout is cancelled too. Only the result of the
+// latest request is reported.
+class SearchRunner : public QObject
+{
+    Q_OBJECT
+public:
+    // The search connections mirror gui's: local replica shared, read
+    // replica attached; gui's connections send KILL QUERY on MySQL
+    SearchRunner(const QString &name, const DatabaseManager &gui, const ReplicaConfig &replicaConfig,
+                 QObject *parent = nullptr);
+    ~SearchRunner();
+
+    void start();
+    // Returns the serial of the request, the running one is cancelled
+    int run(SearchRequest request);
+    void cancel();
+    bool isBusy() const { return m_busy; }
+
+signals:
+    void finished(const SearchResult &result);
+    void busyChanged(bool busy);
+
+private:
+    friend class SearchWorker;
+    bool isLatest(int serial) const { return m_latest.loadAcquire() == serial; }
+    void workerFinished(const SearchResult &result);
+
+    QThread m_thread;
+    SearchWorker *m_worker;
+    QSqlDatabase m_control;
+    QSqlDatabase m_readControl;
+    QueryCancel m_cancel;
+    QTimer m_timeout;
+    QAtomicInteger<int> m_latest = 0;
+    int m_timedOut = 0;   // serial cancelled by m_timeout
+    bool m_busy = false;
+};
+
+#endif // SEARCHRUNNER_H
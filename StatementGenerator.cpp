@@ -0,0 +1,210 @@
+#include "StatementGenerator.h"
+#include "DatabaseManager.h"
+#include "ReportGenerator.h"
+#include <QAtomicInt>
+#include <QDir>
+#include <QRegularExpression>
+#include <QtConcurrent>
+
+namespace {
+// With order shards: the orders merged from the shards by client then date,
+// the emails read from client afterwards
+bool loadShardedStatements(DatabaseManager &db, const QDate &fromDate, const QDate &toDate,
+                           QVector<ClientStatement> &outStatements, QString *error)
+{
+    RowCursor<CommandeRow> cursor = db.commandesCursor(QString(), QString(), fromDate, toDate, "client_date");
+    if (!cursor.isActive()) {
+        if (error)
+            *error = "Impossible de récupérer les commandes: " + cursor.lastError().text();
+        return false;
+    }
+
+    outStatements.clear();
+    QHash<int, int> positions; // client -> index in outStatements
+    CommandeRow row;
+    while (cursor.next(row)) {
+        if (outStatements.isEmpty() || outStatements.last().idClient != row.idClient) {
+            ClientStatement statement;
+            statement.idClient = row.idClient;
+            statement.nom = row.nom;
+            statement.prenom = row.prenom;
+            positions.insert(row.idClient, outStatements.size());
+            outStatements.append(statement);
+        }
+
+        StatementOrder order;
+        order.idCommande = row.idCommande;
+        order.date = row.dateCommande;
+        order.statut = row.statut;
+        order.montant = row.montantTotal;
+        order.moyenPaiement = row.moyenPaiement;
+        order.remarque = row.remarque;
+        outStatements.last().orders.append(order);
+    }
+
+    const QList<int> ids = positions.keys();
+    for (int start = 0; start < ids.size(); start += DatabaseManager::BulkChunkSize) {
+        QSqlQuery query = db.getClientsByIds(ids.mid(start, DatabaseManager::BulkChunkSize));
+        if (!query.isActive()) {
+            if (error)
+                *error = "Impossible de récupérer les clients: " + query.lastError().text();
+            return false;
+        }
+        while (query.next())
+            outStatements[positions.value(query.value("id_client").toInt())].email = query.value("email").toString();
+    }
+    return true;
+}
+}
+
+double ClientStatement::total() const
+{
+    double sum = 0.0;
+    for (const StatementOrder &order : orders)
+        sum += order.montant;
+    return sum;
+}
+
+bool StatementGenerator::loadStatements(DatabaseManager &db, const QDate &fromDate, const QDate &toDate,
+                                        QVector<ClientStatement> &outStatements, QString *error)
+{
+    if (db.orderShards())
+        return loadShardedStatements(db, fromDate, toDate, outStatements, error);
+
+    QSqlQuery query = db.getOrdersByClient(fromDate, toDate);
+    if (!query.isActive()) {
+        if (error)
+            *error = "Impossible de récupérer les commandes: " + query.lastError().text();
+        return false;
+    }
+
+    // Column positions resolved once, rows arrive grouped by client
+    const QSqlRecord record = query.record();
+    const int iClient = record.indexOf("id_client");
+    const int iNom = record.indexOf("nom");
+    const int iPrenom = record.indexOf("prenom");
+    const int iEmail = record.indexOf("email");
+    const int iCommande = record.indexOf("id_commande");
+    const int iDate = record.indexOf("date_commande");
+    const int iStatut = record.indexOf("statut");
+    const int iMontant = record.indexOf("montant_total");
+    const int iPaiement = record.indexOf("moyen_paiement");
+    const int iRemarque = record.indexOf("remarque");
+
+    outStatements.clear();
+    while (query.next()) {
+        const int idClient = query.value(iClient).toInt();
+        if (outStatements.isEmpty() || outStatements.last().idClient != idClient) {
+            ClientStatement statement;
+            statement.idClient = idClient;
+            statement.nom = query.value(iNom).toString();
+            statement.prenom = query.value(iPrenom).toString();
+            statement.email = query.value(iEmail).toString();
+            outStatements.append(statement);
+        }
+
+        StatementOrder order;
+        order.idCommande = query.value(iCommande).toInt();
+        order.date = query.value(iDate).toDateTime();
+        order.statut = query.value(iStatut).toString();
+        order.montant = query.value(iMontant).toDouble();
+        order.moyenPaiement = query.value(iPaiement).toString();
+        order.remarque = query.value(iRemarque).toString();
+        outStatements.last().orders.append(order);
+    }
+    return true;
+}
+
+QString StatementGenerator::statementHtml(const ClientStatement &statement, const QDate &fromDate, const QDate &toDate)
+{
+    const double total = statement.total();
+    const int count = statement.orders.size();
+
+    QString html;
+    html += "<html><head><style>" + ReportGenerator::reportStyle() + "</style></head><body>";
+
+    // Header
+    html += "<h1>Relevé Client - " + statement.prenom + " " + statement.nom + "</h1>";
+    html += "<p>Période: du " + fromDate.toString("dd/MM/yyyy") + " au " + toDate.toString("dd/MM/yyyy") + "<br>";
+    html += "Client n° " + QString::number(statement.idClient) + " - " + statement.email + "<br>";
+    html += "Généré le: " + QDateTime::currentDateTime().toString("dd/MM/yyyy à HH:mm") + "</p>";
+
+    // Summary
+    html += "<div class='summary'>";
+    html += "<h2>Résumé</h2>";
+    html += "<p>Nombre de commandes: <span class='total'>" + QString::number(count) + "</span></p>";
+    html += "<p>Chiffre d'affaires total: <span class='total'>" + QString::number(total, 'f', 2) + " €</span></p>";
+    html += "<p>Moyenne par commande: <span class='total'>" + QString::number(count > 0 ? total / count : 0.0, 'f', 2) + " €</span></p>";
+    html += "</div>";
+
+    // Table
+    html += "<h2>Détail des Commandes</h2>";
+    html += "<table>";
+    html += "<tr><th>ID</th><th>Date</th><th>Statut</th><th>Montant</th><th>Paiement</th><th>Remarque</th></tr>";
+    for (const StatementOrder &order : statement.orders) {
+        html += "<tr>";
+        html += "<td>" + QString::number(order.idCommande) + "</td>";
+        html += "<td>" + order.date.toString("dd/MM/yyyy HH:mm") + "</td>";
+        html += "<td>" + order.statut + "</td>";
+        html += "<td>" + QString::number(order.montant, 'f', 2) + " €</td>";
+        html += "<td>" + order.moyenPaiement + "</td>";
+        html += "<td>" + order.remarque + "</td>";
+        html += "</tr>";
+    }
+    html += "</table>";
+    html += "</body></html>";
+    return html;
+}
+
+QString StatementGenerator::statementFileName(const QString &outDir, const ClientStatement &statement, const QDate &fromDate)
+{
+    // Keep names filesystem-safe whatever the client name contains
+    QString name = statement.nom + "_" + statement.prenom;
+    name.replace(QRegularExpression("[^A-Za-z0-9_-]"), "_");
+    return QDir(outDir).filePath(QString("releve_%1_%2_%3.pdf")
+                                     .arg(fromDate.toString("yyyy-MM"))
+                                     .arg(statement.idClient)
+                                     .arg(name));
+}
+
+bool StatementGenerator::renderStatement(const ClientStatement &statement, const QDate &fromDate, const QDate &toDate,
+                                         const QString &outDir)
+{
+    return ReportGenerator::generatePDF(statementFileName(outDir, statement, fromDate),
+                                        statementHtml(statement, fromDate, toDate));
+}
+
+StatementGenerator::Summary StatementGenerator::generate(DatabaseManager &db, const QDate &fromDate, const QDate &toDate,
+                                                         const QString &outDir, const ProgressCallback &progress)
+{
+    Summary summary;
+    QVector<ClientStatement> statements;
+    if (!loadStatements(db, fromDate, toDate, statements, &summary.error))
+        return summary;
+
+    if (!QDir().mkpath(outDir)) {
+        summary.error = "Impossible de créer le dossier " + outDir;
+        return summary;
+    }
+
+    summary.clients = statements.size();
+    for (const ClientStatement &statement : statements)
+        summary.orders += statement.orders.size();
+
+    QAtomicInt done = 0;
+    QAtomicInt failures = 0;
+    const int total = statements.size();
+    QtConcurrent::blockingMap(statements, [&](const ClientStatement &statement) {
+        if (!renderStatement(statement, fromDate, toDate, outDir))
+            failures.fetchAndAddRelaxed(1);
+        const int finished = done.fetchAndAddRelaxed(1) + 1;
+        if (progress)
+            progress(finished, total);
+    });
+
+    summary.failures = failures.loadRelaxed();
+    summary.ok = summary.failures == 0;
+    if (!summary.ok)
+        summary.error = QString("%1 relevé(s) n'ont pas pu être écrits").arg(summary.failures);
+    return summary;
+}
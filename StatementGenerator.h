@@ -0,0 +1,63 @@
+#ifndef STATEMENTGENERATOR_H
+#define STATEMENTGENERATOR_H
+
+#include <QString>
+#include <QVector>
+#include <QDate>
+#include <QDateTime>
+#include <functional>
+
+class DatabaseManager;
+
+struct StatementOrder
+{
+    int idCommande = 0;
+    QDateTime date;
+    QString statut;
+    double montant = 0.0;
+    QString moyenPaiement;
+    QString remarque;
+};
+
+struct ClientStatement
+{
+    int idClient = 0;
+    QString nom;
+    QString prenom;
+    QString email;
+    QVector<StatementOrder> orders;
+
+    double total() const;
+};
+
+// Month-end statements, one PDF per client.
+// The orders come from a single sorted streaming query (merged from the
+// order shards when attached) and are split by client; rendering then runs
+// on all cores with no database access.
+class StatementGenerator
+{
+public:
+    struct Summary {
+        bool ok = false;
+        int clients = 0;
+        int orders = 0;
+        int failures = 0;
+        QString error;
+    };
+
+    // done/total, called from worker threads
+    using ProgressCallback = std::function<void(int done, int total)>;
+
+    static bool loadStatements(DatabaseManager &db, const QDate &fromDate, const QDate &toDate,
+                               QVector<ClientStatement> &outStatements, QString *error = nullptr);
+    static QString statementHtml(const ClientStatement &statement, const QDate &fromDate, const QDate &toDate);
+    static QString statementFileName(const QString &outDir, const ClientStatement &statement, const QDate &fromDate);
+    static bool renderStatement(const ClientStatement &statement, const QDate &fromDate, const QDate &toDate,
+                                const QString &outDir);
+
+    // Blocking: load, then render in parallel on the global thread pool
+    static Summary generate(DatabaseManager &db, const QDate &fromDate, const QDate &toDate,
+                            const QString &outDir, const ProgressCallback &progress = ProgressCallback());
+};
+
+#endif // STATEMENTGENERATOR_H
@@ -0,0 +1,269 @@
+#include "StatusRules.h"
+#include "AppSettings.h"
+#include "OrderCodes.h"
+#include "OrderShards.h"
+#include <QDebug>
+#include <QSettings>
+
+StatusRulesConfig StatusRulesConfig::load(const QString &group)
+{
+    StatusRulesConfig config;
+    QSettings settings(AppSettings::filePath(), QSettings::IniFormat);
+    settings.beginGroup(group);
+    config.enabled = settings.value("enabled", config.enabled).toBool();
+    config.intervalMinutes = settings.value("interval_min", config.intervalMinutes).toInt();
+    config.chunkSize = qMax(1, settings.value("chunk_size", config.chunkSize).toInt());
+
+    const int count = settings.beginReadArray("rules");
+    for (int i = 0; i < count; ++i) {
+        settings.setArrayIndex(i);
+        StatusRule rule;
+        rule.name = settings.value("name", QString("Règle %1").arg(i + 1)).toString();
+        const QString from = settings.value("from", rule.fromStatut).toString();
+        const QString paiement = settings.value("paiement").toString();
+        const QString to = settings.value("to").toString();
+        rule.minAgeDays = settings.value("min_age_days", rule.minAgeDays).toInt();
+        rule.minAmount = settings.value("min_amount", rule.minAmount).toDouble();
+        rule.maxAmount = settings.value("max_amount", rule.maxAmount).toDouble();
+        if (to.isEmpty()) {
+            qWarning() << "Status rule without target statut ignored:" << rule.name;
+            continue;
+        }
+        // Stored codes, whatever the ini spells ("📄 Chèque", "livre")
+        rule.fromStatut = OrderCodes::statut(from);
+        rule.moyenPaiement = OrderCodes::paiement(paiement);
+        rule.targetStatut = OrderCodes::statut(to);
+        if ((!from.isEmpty() && rule.fromStatut.isEmpty()) || (!paiement.isEmpty() && rule.moyenPaiement.isEmpty())
+            || rule.targetStatut.isEmpty()) {
+            qWarning() << "Status rule with an unknown statut or paiement ignored:" << rule.name;
+            continue;
+        }
+        config.rules << rule;
+    }
+    settings.endArray();
+    settings.endGroup();
+    return config;
+}
+
+// ---- StatusRulesEngine ----
+QString StatusRulesEngine::whereClause(const StatusRule &rule, QVariantList &binds)
+{
+    // Rows already at the target never match, so repeated runs converge
+    QStringList conditions{"statut <> ?"};
+    binds << rule.targetStatut;
+
+    if (!rule.fromStatut.isEmpty()) {
+        conditions << "statut = ?";
+        binds << rule.fromStatut;
+    }
+    if (rule.minAgeDays > 0) {
+        conditions << "date_commande < ?";
+        binds << QDateTime::currentDateTime().addDays(-rule.minAgeDays);
+    }
+    if (rule.minAmount >= 0) {
+        conditions << "montant_total >= ?";
+        binds << rule.minAmount;
+    }
+    if (rule.maxAmount >= 0) {
+        conditions << "montant_total <= ?";
+        binds << rule.maxAmount;
+    }
+    if (!rule.moyenPaiement.isEmpty()) {
+        conditions << "moyen_paiement = ?";
+        binds << rule.moyenPaiement;
+    }
+    return conditions.join(" AND ");
+}
+
+// With order shards, each shard counts and updates its own orders
+int StatusRulesEngine::countMatches(DatabaseManager &db, const StatusRule &rule, bool *ok)
+{
+    QVariantList binds;
+    const QString sql = "SELECT COUNT(*) FROM commande WHERE " + whereClause(rule, binds);
+    auto count = [&sql, &binds](QSqlDatabase connection, int &matched) {
+        QSqlQuery q(connection);
+        q.prepare(sql);
+        for (const QVariant &value : binds)
+            q.addBindValue(value);
+        if (!q.exec() || !q.next())
+            return q.lastError().isValid() ? q.lastError()
+                                           : QSqlError(QString(), "COUNT(*) without row", QSqlError::UnknownError);
+        matched = q.value(0).toInt();
+        return QSqlError();
+    };
+
+    QVector<int> counts(1, 0);
+    QVector<QSqlError> errors(1);
+    if (OrderShards *shards = db.orderShards()) {
+        counts.fill(0, shards->count());
+        errors.resize(shards->count());
+        shards->scatter([&count, &counts, &errors](int shard, QSqlDatabase connection) {
+            errors[shard] = count(connection, counts[shard]);
+        });
+    } else {
+        errors[0] = count(db.getDatabase(), counts[0]);
+    }
+
+    int matched = 0;
+    bool success = true;
+    for (int i = 0; i < counts.size(); ++i) {
+        if (errors.at(i).isValid()) {
+            qWarning() << "countMatches failed:" << rule.name << errors.at(i).text();
+            success = false;
+        }
+        matched += counts.at(i);
+    }
+    if (ok)
+        *ok = success;
+    return success ? matched : 0;
+}
+
+int StatusRulesEngine::applyRule(DatabaseManager &db, const StatusRule &rule, int chunkSize, bool *ok)
+{
+    OrderShards *shards = db.orderShards();
+    if (!shards)
+        return applyChunks(db.getDatabase(), rule, chunkSize, ok);
+
+    QVector<int> updated(shards->count(), 0);
+    QVector<char> applied(shards->count(), false);
+    shards->scatter([&rule, chunkSize, &updated, &applied](int shard, QSqlDatabase connection) {
+        bool shardOk = false;
+        updated[shard] = applyChunks(connection, rule, chunkSize, &shardOk);
+        applied[shard] = shardOk;
+    });
+
+    int total = 0;
+    bool success = true;
+    for (int shard = 0; shard < shards->count(); ++shard) {
+        total += updated.at(shard);
+        success = success && applied.at(shard);
+    }
+    if (ok)
+        *ok = success;
+    return total;
+}
+
+int StatusRulesEngine::applyChunks(QSqlDatabase sql, const StatusRule &rule, int chunkSize, bool *ok)
+{
+    int updated = 0;
+    if (ok)
+        *ok = true;
+
+    // Short transactions of at most chunkSize orders. The rule is part of
+    // the UPDATE, so an order changed since countMatches() is checked again.
+    // MySQL limits the UPDATE itself; SQLite has no UPDATE ... LIMIT by
+    // default and picks the chunk in a subquery of the same statement.
+    const bool sqlite = sql.driverName() == "QSQLITE";
+    while (true) {
+        QVariantList binds{rule.targetStatut};
+        const QString where = whereClause(rule, binds);
+        const QString statement = sqlite
+            ? QString("UPDATE commande SET statut = ? WHERE id_commande IN "
+                      "(SELECT id_commande FROM commande WHERE %1 ORDER BY id_commande LIMIT %2)")
+            : QString("UPDATE commande SET statut = ? WHERE %1 ORDER BY id_commande LIMIT %2");
+
+        sql.transaction();
+        QSqlQuery q(sql);
+        q.prepare(statement.arg(where).arg(chunkSize));
+        for (const QVariant &value : binds)
+            q.addBindValue(value);
+        if (!q.exec() || !sql.commit()) {
+            qWarning() << "applyRule failed:" << rule.name << q.lastError().text() << sql.lastError().text();
+            sql.rollback();
+            if (ok)
+                *ok = false;
+            break;
+        }
+
+        const int rows = q.numRowsAffected();
+        updated += qMax(0, rows);
+        if (rows < chunkSize)
+            break;
+    }
+    return updated;
+}
+
+QList<StatusRulesEngine::Outcome> StatusRulesEngine::run(DatabaseManager &db, const StatusRulesConfig &config,
+                                                         bool dryRun)
+{
+    QList<Outcome> outcomes;
+    for (const StatusRule &rule : config.rules) {
+        Outcome outcome;
+        outcome.rule = rule.name;
+        outcome.matched = countMatches(db, rule, &outcome.ok);
+        if (outcome.ok && !dryRun && outcome.matched > 0)
+            outcome.updated = applyRule(db, rule, config.chunkSize, &outcome.ok);
+        outcomes << outcome;
+    }
+    return outcomes;
+}
+
+// ---- StatusRulesWorker ----
+StatusRulesWorker::StatusRulesWorker(const DatabaseConfig &databaseConfig, const StatusRulesConfig &rulesConfig)
+    : m_databaseConfig(databaseConfig), m_rulesConfig(rulesConfig)
+{
+    m_databaseConfig.connectionName = "status_rules";
+    m_databaseConfig.manageSchema = false;
+}
+
+void StatusRulesWorker::start()
+{
+    // The connection is created here so it belongs to the rules thread
+    m_db = new DatabaseManager(m_databaseConfig, this);
+    if (!m_db->open()) {
+        emit failed("Connexion des règles de statut impossible");
+        return;
+    }
+    const ShardConfig shardConfig = ShardConfig::load();
+    if (shardConfig.enabled && !m_db->attachShards(shardConfig)) {
+        emit failed("Connexion des règles de statut aux partitions de commandes impossible");
+        return;
+    }
+
+    m_timer = new QTimer(this);
+    m_timer->setInterval(qMax(1, m_rulesConfig.intervalMinutes) * 60 * 1000);
+    connect(m_timer, &QTimer::timeout, this, &StatusRulesWorker::runOnce);
+    m_timer->start();
+    runOnce();
+}
+
+void StatusRulesWorker::runOnce()
+{
+    int updated = 0;
+    bool ok = true;
+    for (const StatusRulesEngine::Outcome &outcome : StatusRulesEngine::run(*m_db, m_rulesConfig, false)) {
+        updated += outcome.updated;
+        ok = ok && outcome.ok;
+    }
+
+    if (!ok)
+        emit failed("Application des règles de statut interrompue");
+    if (updated > 0)
+        emit applied(updated);
+}
+
+// ---- StatusRulesScheduler ----
+StatusRulesScheduler::StatusRulesScheduler(const DatabaseConfig &databaseConfig, const StatusRulesConfig &rulesConfig,
+                                           QObject *parent)
+    : QObject(parent),
+    m_worker(new StatusRulesWorker(databaseConfig, rulesConfig))
+{
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::started, m_worker, &StatusRulesWorker::start);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    connect(m_worker, &StatusRulesWorker::applied, this, &StatusRulesScheduler::applied);
+    connect(m_worker, &StatusRulesWorker::failed, this, [](const QString &error) {
+        qWarning() << "Status rules:" << error;
+    });
+}
+
+StatusRulesScheduler::~StatusRulesScheduler()
+{
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void StatusRulesScheduler::start()
+{
+    m_thread.start();
+}
@@ -0,0 +1,101 @@
+#ifndef STATUSRULES_H
+#define STATUSRULES_H
+
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QList>
+#include "DatabaseManager.h"
+
+// One transition: orders matching every criterion that is set move to
+// targetStatut. Statuts and paiement are OrderCodes codes.
+struct StatusRule
+{
+    QString name;
+    QString fromStatut = "EN_COURS"; // empty = any statut
+    int minAgeDays = 0;              // 0 = no age condition
+    double minAmount = -1.0;         // < 0 = no lower bound
+    double maxAmount = -1.0;         // < 0 = no upper bound
+    QString moyenPaiement;           // empty = any
+    QString targetStatut;
+};
+
+// Settings of the [status_rules] group of QTcredit.ini
+struct StatusRulesConfig
+{
+    bool enabled = false;     // run in the background
+    int intervalMinutes = 60;
+    int chunkSize = 500;      // orders per transaction
+    QList<StatusRule> rules;
+
+    static StatusRulesConfig load(const QString &group = "status_rules");
+};
+
+// Set-based evaluation of the rules against the primary database, or
+// against every order shard when db has them attached
+class StatusRulesEngine
+{
+public:
+    struct Outcome {
+        QString rule;
+        int matched = 0;  // orders matching before the run
+        int updated = 0;  // 0 in dry-run
+        bool ok = true;
+    };
+
+    // Every rule in order; dryRun only counts
+    static QList<Outcome> run(DatabaseManager &db, const StatusRulesConfig &config, bool dryRun);
+
+    static int countMatches(DatabaseManager &db, const StatusRule &rule, bool *ok = nullptr);
+    // One set-based UPDATE of at most chunkSize matching orders per commit;
+    // returns the rows the statements changed
+    static int applyRule(DatabaseManager &db, const StatusRule &rule, int chunkSize, bool *ok = nullptr);
+
+private:
+    static QString whereClause(const StatusRule &rule, QVariantList &binds);
+    // The chunked UPDATEs of applyRule() on one connection
+    static int applyChunks(QSqlDatabase sql, const StatusRule &rule, int chunkSize, bool *ok);
+};
+
+// Runs in the rules thread with its own connection
+class StatusRulesWorker : public QObject
+{
+    Q_OBJECT
+public:
+    StatusRulesWorker(const DatabaseConfig &databaseConfig, const StatusRulesConfig &rulesConfig);
+
+public slots:
+    void start();
+    void runOnce();
+
+signals:
+    void applied(int updated);
+    void failed(const QString &error);
+
+private:
+    DatabaseConfig m_databaseConfig;
+    StatusRulesConfig m_rulesConfig;
+    DatabaseManager *m_db = nullptr;
+    QTimer *m_timer = nullptr;
+};
+
+// Applies the rules on a timer in a background thread
+class StatusRulesScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    StatusRulesScheduler(const DatabaseConfig &databaseConfig, const StatusRulesConfig &rulesConfig,
+                         QObject *parent = nullptr);
+    ~StatusRulesScheduler();
+
+    void start();
+
+signals:
+    void applied(int updated);
+
+private:
+    QThread m_thread;
+    StatusRulesWorker *m_worker;
+};
+
+#endif // STATUSRULES_H
@@ -0,0 +1,92 @@
+#include "TableRowDelegate.h"
+#include <QPainter>
+
+TableRowDelegate::TableRowDelegate(const QFont &font, QObject *parent)
+    : QStyledItemDelegate(parent),
+    m_font(font),
+    m_metrics(font),
+    m_borderPen(QColor("#333333"), 1),
+    m_base("#1e1e1e"),
+    m_alternate("#252525"),
+    m_hover("#2d2d2d"),
+    m_selected("#2a7fff"),
+    m_text("#e0e0e0"),
+    m_selectedText(Qt::white),
+    m_elided(4096)
+{
+    m_rowHeight = m_metrics.height() + 2 * m_padding;
+}
+
+void TableRowDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    if (index.data(Qt::DecorationRole).isValid() || index.data(Qt::CheckStateRole).isValid()) {
+        QStyledItemDelegate::paint(painter, option, index);
+        return;
+    }
+
+    const QRect rect = option.rect;
+    const bool selected = option.state & QStyle::State_Selected;
+    const bool alternate = option.features & QStyleOptionViewItem::Alternate;
+    painter->save();
+
+    const QVariant background = index.data(Qt::BackgroundRole);
+    if (selected) {
+        painter->fillRect(rect, alternate ? m_alternate : m_base);
+        painter->setRenderHint(QPainter::Antialiasing, true);
+        painter->setPen(Qt::NoPen);
+        painter->setBrush(m_selected);
+        painter->drawRoundedRect(rect, 4, 4);
+        painter->setRenderHint(QPainter::Antialiasing, false);
+    } else if (background.canConvert<QBrush>()) {
+        painter->fillRect(rect, background.value<QBrush>());
+    } else if (option.state & QStyle::State_MouseOver) {
+        painter->fillRect(rect, m_hover);
+    } else {
+        painter->fillRect(rect, alternate ? m_alternate : m_base);
+    }
+    painter->setPen(m_borderPen);
+    painter->drawLine(rect.bottomLeft(), rect.bottomRight());
+
+    const QString text = displayText(index.data(Qt::DisplayRole), option.locale);
+    if (!text.isEmpty()) {
+        const QRect textRect = rect.adjusted(m_padding, 0, -m_padding, 0);
+        Qt::Alignment alignment = Qt::AlignLeft;
+        const QVariant aligned = index.data(Qt::TextAlignmentRole);
+        if (aligned.isValid())
+            alignment = Qt::Alignment(aligned.toInt());
+        if (!(alignment & Qt::AlignVertical_Mask))
+            alignment |= Qt::AlignVCenter;
+
+        QColor color = selected ? m_selectedText : m_text;
+        const QVariant foreground = index.data(Qt::ForegroundRole);
+        if (!selected && foreground.canConvert<QBrush>())
+            color = foreground.value<QBrush>().color();
+        painter->setPen(color);
+        painter->setFont(m_font);
+        painter->drawText(textRect, int(alignment),
+                          text.contains(QChar::LineSeparator) ? text : elided(text, textRect.width()));
+    }
+    painter->restore();
+}
+
+QSize TableRowDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    // displayText() turns line breaks into QChar::LineSeparator
+    QString text = displayText(index.data(Qt::DisplayRole), option.locale);
+    if (!text.contains(QChar::LineSeparator))
+        return QSize(m_metrics.horizontalAdvance(text) + 2 * m_padding, m_rowHeight);
+    const QSize size = m_metrics.size(0, text.replace(QChar::LineSeparator, '\n'));
+    return QSize(size.width() + 2 * m_padding, size.height() + 2 * m_padding);
+}
+
+// Visible cells are painted again on every scroll step with the same widths
+QString TableRowDelegate::elided(const QString &text, int width) const
+{
+    if (const Elided *cached = m_elided.object(text)) {
+        if (cached->width == width)
+            return cached->text;
+    }
+    const QString result = m_metrics.elidedText(text, Qt::ElideRight, width);
+    m_elided.insert(text, new Elided{width, result});
+    return result;
+}
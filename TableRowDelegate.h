@@ -0,0 +1,52 @@
+#ifndef TABLEROWDELEGATE_H
+#define TABLEROWDELEGATE_H
+
+#include <QStyledItemDelegate>
+#include <QFont>
+#include <QFontMetrics>
+#include <QPen>
+#include <QCache>
+
+// Paints the cells of the dark tables (see MainWindow::applyModernTableStyle)
+// with the look of the former QTableView::item style rules, without going
+// through the style sheet: colors, pen, font and metrics are built once,
+// elided texts are cached, and every row has the same height so the view
+// never measures rows (multi-line texts are only measured when the table
+// asks for resizeRowsToContents()). Cells with an icon or a check box keep
+// the default painting.
+class TableRowDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+public:
+    explicit TableRowDelegate(const QFont &font, QObject *parent = nullptr);
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+
+    // Height of every row: one line of text plus the padding
+    int rowHeight() const { return m_rowHeight; }
+
+private:
+    // text cut with "…" to width pixels
+    QString elided(const QString &text, int width) const;
+
+    struct Elided {
+        int width;
+        QString text;
+    };
+
+    QFont m_font;
+    QFontMetrics m_metrics;
+    QPen m_borderPen;
+    QColor m_base;
+    QColor m_alternate;
+    QColor m_hover;
+    QColor m_selected;
+    QColor m_text;
+    QColor m_selectedText;
+    int m_padding = 10;
+    int m_rowHeight;
+    mutable QCache<QString, Elided> m_elided;
+};
+
+#endif // TABLEROWDELEGATE_H
@@ -0,0 +1,292 @@
+#include "WriteQueue.h"
+#include "AppSettings.h"
+#include "OrderShards.h"
+#include <QDebug>
+#include <QMutexLocker>
+#include <QSettings>
+#include <QTimer>
+
+WriteQueueConfig WriteQueueConfig::load(const QString &group)
+{
+    WriteQueueConfig config;
+    QSettings settings(AppSettings::filePath(), QSettings::IniFormat);
+    settings.beginGroup(group);
+    config.enabled = settings.value("enabled", config.enabled).toBool();
+    config.delayMs = qMax(0, settings.value("delay_ms", config.delayMs).toInt());
+    config.batchSize = qMax(1, settings.value("batch_size", config.batchSize).toInt());
+    settings.endGroup();
+    return config;
+}
+
+// ---- WriteQueueWorker ----
+WriteQueueWorker::WriteQueueWorker(const DatabaseConfig &databaseConfig, WriteQueue *queue)
+    : m_databaseConfig(databaseConfig), m_queue(queue)
+{
+    m_databaseConfig.connectionName = "write_queue";
+    m_databaseConfig.manageSchema = false;
+}
+
+void WriteQueueWorker::start()
+{
+    // The connection is created here so it belongs to the writer thread
+    m_db = new DatabaseManager(m_databaseConfig, this);
+    if (!m_db->open()) {
+        qWarning() << "Write queue: connexion à la base de données impossible";
+        return;
+    }
+    // Orders must not land on the primary while the shards are unreachable
+    const ShardConfig shardConfig = ShardConfig::load();
+    if (shardConfig.enabled && !m_db->attachShards(shardConfig)) {
+        qWarning() << "Write queue: connexion aux partitions de commandes impossible";
+        delete m_db;
+        m_db = nullptr;
+    }
+}
+
+void WriteQueueWorker::drain()
+{
+    while (true) {
+        const QList<PendingWrite> writes = m_queue->takeBatch();
+        if (writes.isEmpty())
+            return;
+
+        WriteBatch batch;
+        batch.results = write(writes);
+        m_queue->batchDone(batch.results);
+        readBack(batch);
+        emit written(batch);
+    }
+}
+
+// One transaction for the batch; if it fails, each save is retried alone
+// so a single bad row does not take the others down with it. Orders the
+// shards already committed are not retried: they would be inserted twice.
+QList<WriteResult> WriteQueueWorker::write(const QList<PendingWrite> &writes)
+{
+    QList<Client> clients;
+    QList<Commande> commandes;
+    for (const PendingWrite &pending : writes) {
+        if (pending.kind == PendingWrite::ClientSave)
+            clients << pending.client;
+        else
+            commandes << pending.commande;
+    }
+
+    QList<WriteResult> results;
+    bool commandesWritten = false;
+    const bool ok = m_db && m_db->saveBatch(clients, commandes, &commandesWritten);
+    if (!ok && !commandesWritten && writes.size() > 1) {
+        for (const PendingWrite &pending : writes)
+            results += write({pending});
+        return results;
+    }
+
+    int client = 0;
+    int commande = 0;
+    for (const PendingWrite &pending : writes) {
+        WriteResult result;
+        result.kind = pending.kind;
+        result.queuedId = pending.id;
+        result.ok = ok || (pending.kind == PendingWrite::CommandeSave && commandesWritten);
+        if (pending.kind == PendingWrite::ClientSave) {
+            result.id = clients.at(client++).idClient;
+            if (!ok)
+                result.error = QString("Client %1 %2 non enregistré").arg(pending.client.prenom, pending.client.nom);
+        } else {
+            result.id = commandes.at(commande++).idCommande;
+            if (!result.ok)
+                result.error = QString("Commande de %1 € du %2 non enregistrée")
+                                   .arg(pending.commande.montantTotal, 0, 'f', 2)
+                                   .arg(pending.commande.dateCommande.toString("dd/MM/yyyy"));
+        }
+        results << result;
+    }
+    return results;
+}
+
+// The saved rows as stored, plus the clients whose counters moved
+void WriteQueueWorker::readBack(WriteBatch &batch)
+{
+    QList<int> clientIds;
+    QList<int> commandeIds;
+    for (const WriteResult &result : std::as_const(batch.results)) {
+        if (!result.ok)
+            continue;
+        if (result.kind == PendingWrite::ClientSave)
+            clientIds << int(result.id);
+        else
+            commandeIds << int(result.id);
+    }
+
+    for (int start = 0; start < commandeIds.size(); start += DatabaseManager::BulkChunkSize) {
+        RowCursor<CommandeRow> cursor = m_db->commandesByIdsCursor(commandeIds.mid(start, DatabaseManager::BulkChunkSize));
+        CommandeRow row;
+        while (cursor.next(row)) {
+            batch.commandes << row;
+            if (!clientIds.contains(row.idClient))
+                clientIds << row.idClient;
+        }
+    }
+    for (int start = 0; start < clientIds.size(); start += DatabaseManager::BulkChunkSize) {
+        RowCursor<ClientRow> cursor(m_db->getClientsByIds(clientIds.mid(start, DatabaseManager::BulkChunkSize)));
+        ClientRow row;
+        while (cursor.next(row))
+            batch.clients << row;
+    }
+}
+
+// ---- WriteQueue ----
+WriteQueue::WriteQueue(const DatabaseConfig &databaseConfig, const WriteQueueConfig &config, QObject *parent)
+    : QObject(parent), m_config(config),
+    m_worker(new WriteQueueWorker(databaseConfig, this))
+{
+    qRegisterMetaType<WriteBatch>();
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::started, m_worker, &WriteQueueWorker::start);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    connect(m_worker, &WriteQueueWorker::written, this, &WriteQueue::written);
+}
+
+WriteQueue::~WriteQueue()
+{
+    if (m_thread.isRunning())
+        QMetaObject::invokeMethod(m_worker, &WriteQueueWorker::drain, Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void WriteQueue::start()
+{
+    m_thread.start();
+}
+
+qint64 WriteQueue::saveClient(const Client &client)
+{
+    PendingWrite pending;
+    pending.kind = PendingWrite::ClientSave;
+    pending.id = client.idClient;
+    pending.client = client;
+    return enqueue(pending);
+}
+
+qint64 WriteQueue::saveCommande(const Commande &commande)
+{
+    PendingWrite pending;
+    pending.kind = PendingWrite::CommandeSave;
+    pending.id = commande.idCommande;
+    pending.commande = commande;
+    return enqueue(pending);
+}
+
+qint64 WriteQueue::enqueue(PendingWrite pending)
+{
+    QMutexLocker locker(&m_mutex);
+    if (pending.id == -1)
+        pending.id = m_nextTemporaryId--;
+
+    // Still queued: the new values replace the old ones, an insert stays an insert
+    bool coalesced = false;
+    for (PendingWrite &queued : m_queued) {
+        if (queued.kind == pending.kind && queued.id == pending.id) {
+            queued.client = pending.client;
+            queued.commande = pending.commande;
+            coalesced = true;
+            break;
+        }
+    }
+    if (!coalesced)
+        m_queued << pending;
+
+    if (!m_drainScheduled) {
+        m_drainScheduled = true;
+        QTimer::singleShot(m_config.delayMs, m_worker, &WriteQueueWorker::drain);
+    }
+    return pending.id;
+}
+
+qint64 WriteQueue::databaseId(qint64 id) const
+{
+    return m_inserted.value(id, id);
+}
+
+QList<PendingWrite> WriteQueue::takeBatch()
+{
+    QMutexLocker locker(&m_mutex);
+    QList<PendingWrite> batch = m_queued.mid(0, m_config.batchSize);
+    m_queued.remove(0, batch.size());
+    if (batch.isEmpty()) {
+        m_drainScheduled = false;
+        return batch;
+    }
+
+    // A row inserted by an earlier batch is updated under its real id
+    for (PendingWrite &pending : batch) {
+        if (pending.kind == PendingWrite::ClientSave)
+            pending.client.idClient = databaseId(pending.id);
+        else
+            pending.commande.idCommande = databaseId(pending.id);
+    }
+    m_writing = batch;
+    return batch;
+}
+
+void WriteQueue::batchDone(const QList<WriteResult> &results)
+{
+    QMutexLocker locker(&m_mutex);
+    m_writing.clear();
+    for (const WriteResult &result : results) {
+        if (result.queuedId >= 0)
+            continue;
+        if (result.ok) {
+            m_inserted.insert(result.queuedId, result.id);
+            continue;
+        }
+        // The row is gone from the UI: later saves of it are dropped too
+        for (int i = m_queued.size() - 1; i >= 0; --i) {
+            if (m_queued.at(i).kind == result.kind && m_queued.at(i).id == result.queuedId)
+                m_queued.removeAt(i);
+        }
+    }
+}
+
+bool WriteQueue::pendingClient(qint64 id, Client &out) const
+{
+    QMutexLocker locker(&m_mutex);
+    for (const QList<PendingWrite> *list : {&m_queued, &m_writing}) {
+        for (const PendingWrite &pending : *list) {
+            if (pending.kind == PendingWrite::ClientSave && pending.id == id) {
+                out = pending.client;
+                out.idClient = id;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool WriteQueue::pendingCommande(qint64 id, Commande &out) const
+{
+    QMutexLocker locker(&m_mutex);
+    for (const QList<PendingWrite> *list : {&m_queued, &m_writing}) {
+        for (const PendingWrite &pending : *list) {
+            if (pending.kind == PendingWrite::CommandeSave && pending.id == id) {
+                out = pending.commande;
+                out.idCommande = id;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool WriteQueue::isPending(PendingWrite::Kind kind, qint64 id) const
+{
+    QMutexLocker locker(&m_mutex);
+    for (const QList<PendingWrite> *list : {&m_queued, &m_writing}) {
+        for (const PendingWrite &pending : *list) {
+            if (pending.kind == kind && pending.id == id)
+                return true;
+        }
+    }
+    return false;
+}
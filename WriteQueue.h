@@ -0,0 +1,121 @@
+#ifndef WRITEQUEUE_H
+#define WRITEQUEUE_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QHash>
+#include "DatabaseManager.h"
+
+// Settings of the [write_queue] group of QTcredit.ini
+struct WriteQueueConfig
+{
+    bool enabled = true;
+    int delayMs = 150;   // wait before writing, so quick successive edits coalesce
+    int batchSize = 50;  // saves per transaction
+
+    static WriteQueueConfig load(const QString &group = "write_queue");
+};
+
+// One queued form save. id -1 (the entity default) asks for an insert and
+// is replaced by a temporary id, -2 and below, until the row is written.
+struct PendingWrite
+{
+    enum Kind { ClientSave, CommandeSave };
+    Kind kind = ClientSave;
+    qint64 id = -1;
+    Client client;
+    Commande commande;
+};
+
+struct WriteResult
+{
+    PendingWrite::Kind kind = PendingWrite::ClientSave;
+    qint64 queuedId = -1; // id the UI showed, temporary for inserts
+    qint64 id = -1;       // id in the database
+    bool ok = false;
+    QString error;
+};
+
+// Outcome of one batch, with the rows as stored (order counters included)
+struct WriteBatch
+{
+    QList<WriteResult> results;
+    QVector<ClientRow> clients;
+    QVector<CommandeRow> commandes;
+};
+Q_DECLARE_METATYPE(WriteBatch)
+
+class WriteQueue;
+
+// Runs in the writer thread with its own connection
+class WriteQueueWorker : public QObject
+{
+    Q_OBJECT
+public:
+    WriteQueueWorker(const DatabaseConfig &databaseConfig, WriteQueue *queue);
+
+public slots:
+    void start();
+    // Writes everything queued, batchSize saves per transaction
+    void drain();
+
+signals:
+    void written(const WriteBatch &batch);
+
+private:
+    QList<WriteResult> write(const QList<PendingWrite> &writes);
+    void readBack(WriteBatch &batch);
+
+    DatabaseConfig m_databaseConfig;
+    WriteQueue *m_queue;
+    DatabaseManager *m_db = nullptr;
+};
+
+// Write-behind queue for the client and order forms. save*() returns at
+// once with the id to show; the writer thread commits after delayMs, and
+// reports every save through written(), failures included, so the UI can
+// confirm or roll back its optimistic row. A save of a row that is still
+// queued replaces the queued one.
+class WriteQueue : public QObject
+{
+    Q_OBJECT
+public:
+    WriteQueue(const DatabaseConfig &databaseConfig, const WriteQueueConfig &config, QObject *parent = nullptr);
+    // Writes what is still queued before returning
+    ~WriteQueue();
+
+    void start();
+
+    qint64 saveClient(const Client &client);
+    qint64 saveCommande(const Commande &commande);
+
+    // Latest version of a row waiting to be written
+    bool pendingClient(qint64 id, Client &out) const;
+    bool pendingCommande(qint64 id, Commande &out) const;
+    // Queued or being written
+    bool isPending(PendingWrite::Kind kind, qint64 id) const;
+
+signals:
+    void written(const WriteBatch &batch);
+
+private:
+    friend class WriteQueueWorker;
+    qint64 enqueue(PendingWrite write);
+    QList<PendingWrite> takeBatch();
+    void batchDone(const QList<WriteResult> &results);
+    qint64 databaseId(qint64 id) const;
+
+    WriteQueueConfig m_config;
+    QThread m_thread;
+    WriteQueueWorker *m_worker;
+
+    mutable QMutex m_mutex;
+    QList<PendingWrite> m_queued;
+    QList<PendingWrite> m_writing;
+    QHash<qint64, qint64> m_inserted; // temporary id -> database id
+    qint64 m_nextTemporaryId = -2;
+    bool m_drainScheduled = false;
+};
+
+#endif // WRITEQUEUE_H
@@ -1,10 +1,20 @@
 #include <QApplication>
+#include <QGuiApplication>
 #include <QMessageBox>
 #include "mainwindow.h"
 #include "DatabaseManager.h"
+#include "BatchRunner.h"
 
 int main(int argc, char *argv[])
 {
+    // Headless mode: reports from the command line, no window
+    if (BatchRunner::isBatchInvocation(argc, argv)) {
+        if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        QGuiApplication app(argc, argv);
+        return BatchRunner::run(app.arguments().mid(1));
+    }
+
     QApplication a(argc, argv);
 
     // Test database connection first
@@ -12,7 +22,8 @@ int main(int argc, char *argv[])
     if (!db.open()) {
         QMessageBox::critical(nullptr, "Erreur",
                               "Impossible de se connecter à la base de données.\n"
-                              "Vérifiez que MySQL est démarré et que la base 'credit_db' existe.");
+                              "Vérifiez que MySQL est démarré et que la base 'credit_db' existe,\n"
+                              "ou configurez une base SQLite locale dans QTcredit.ini.");
         return -1;
     }
 
@@ -1,5 +1,22 @@
 #include "mainwindow.h"
 #include "DatabaseManager.h"
+#include "PerfMonitor.h"
+#include "LocalReplica.h"
+#include "OrderShards.h"
+#include "ReportGenerator.h"
+#include "StatementGenerator.h"
+#include "CsvExporter.h"
+#include "StatusRules.h"
+#include "OrderArchive.h"
+#include "ChangeFeed.h"
+#include "WriteQueue.h"
+#include "ClientAnalytics.h"
+#include "CohortAnalysis.h"
+#include "RowTableModel.h"
+#include "TableRowDelegate.h"
+#include "SearchKey.h"
+#include "OrderCodes.h"
+#include <QSet>
 #include <QSqlRecord>
 #include <QSqlQuery>
 #include <QDebug>
@@ -18,6 +35,12 @@
 #include <QFileDialog>
 #include <QDesktopServices>
 #include <QTextStream>
+#include <QElapsedTimer>
+#include <QInputDialog>
+#include <QProgressDialog>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+#include <QApplication>
 
 // QtCharts includes
 #include <QBarSet>
@@ -25,6 +48,12 @@
 #include <QValueAxis>
 #include <QBarCategoryAxis>
 
+namespace {
+// Client names on the items of cmbClient, for the rows of queued orders
+const int NomRole = Qt::UserRole + 1;
+const int PrenomRole = Qt::UserRole + 2;
+}
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent),
     dbManager(nullptr),
@@ -39,21 +68,97 @@ MainWindow::MainWindow(QWidget *parent)
         return;
     }
 
+    // Branch offices: read from a local copy, write to the central database
+    const ReplicaConfig replicaConfig = ReplicaConfig::load();
+    dbManager->attachLocalReplica(replicaConfig);
+    // Lists, statistics and exports read from a replicated server if configured
+    dbManager->attachReadReplica(ReadReplicaConfig::load());
+    // Orders split over several databases by client
+    const ShardConfig shardConfig = ShardConfig::load();
+    QString shardError;
+    if (shardConfig.enabled && !dbManager->attachShards(shardConfig, &shardError)) {
+        QMessageBox::critical(this, "Erreur", "Partitions de commandes: " + shardError);
+        return;
+    }
+
+    // The lists load in the background; a search can be cancelled or paged
+    searchConfig = SearchConfig::load();
+    clientSearch = new SearchRunner("search_clients", *dbManager, replicaConfig, this);
+    commandeSearch = new SearchRunner("search_commandes", *dbManager, replicaConfig, this);
+    connect(clientSearch, &SearchRunner::finished, this, &MainWindow::applySearchResult);
+    connect(commandeSearch, &SearchRunner::finished, this, &MainWindow::applySearchResult);
+    clientSearch->start();
+    commandeSearch->start();
+
+    // Loaded on first use, then kept up to date from dbManager's writes
+    clientAnalytics = new ClientAnalytics(dbManager, this);
+    cohortAnalysis = new CohortAnalysis(dbManager->config());
+
     setupUI();
     loadClientsTable();
     loadCommandesTable();
     updateStatisticsCharts();
+
+    // Scheduled status transitions, on their own connection and thread
+    const StatusRulesConfig rulesConfig = StatusRulesConfig::load();
+    if (rulesConfig.enabled && !rulesConfig.rules.isEmpty()) {
+        statusRules = new StatusRulesScheduler(dbManager->config(), rulesConfig, this);
+        connect(statusRules, &StatusRulesScheduler::applied, this, [this]() {
+            if (stackedWidget->currentWidget() == commandeWidget)
+                searchCommandes();
+        });
+        statusRules->start();
+    }
+
+    // Orders past the horizon move to commande_archive in the background
+    const ArchiveConfig archiveConfig = ArchiveConfig::load();
+    if (archiveConfig.enabled) {
+        orderArchive = new ArchiveScheduler(dbManager->config(), archiveConfig, this);
+        connect(orderArchive, &ArchiveScheduler::archived, this, [this]() {
+            if (stackedWidget->currentWidget() == commandeWidget)
+                searchCommandes();
+        });
+        orderArchive->start();
+    }
+
+    // Form saves return at once, the writer thread commits them
+    const WriteQueueConfig writeConfig = WriteQueueConfig::load();
+    if (writeConfig.enabled) {
+        writeQueue = new WriteQueue(dbManager->config(), writeConfig, this);
+        connect(writeQueue, &WriteQueue::written, this, [this](const WriteBatch &batch) {
+            applyWriteResults(batch);
+        });
+        writeQueue->start();
+    }
+
+    // Other cashiers' writes show up without "Actualiser"
+    const ChangeFeedConfig feedConfig = ChangeFeedConfig::load();
+    if (feedConfig.enabled) {
+        changeFeed = new ChangeFeed(dbManager->config(), feedConfig, this);
+        connect(changeFeed, &ChangeFeed::changed, this, [this](const ChangeSet &changes) {
+            applyExternalChanges(changes);
+        });
+        changeFeed->start();
+    }
 }
 
 MainWindow::~MainWindow()
 {
-    // dbManager is deleted automatically as child
+    // dbManager is deleted automatically as child; the searches read
+    // through its replica, so they stop first
+    delete clientSearch;
+    delete commandeSearch;
+    if (cohortWatcher)
+        cohortWatcher->waitForFinished();
+    delete cohortAnalysis;
 }
 
-void MainWindow::applyModernTableStyle(QTableWidget *table)
+// The cells are painted by TableRowDelegate: QTableView::item rules would
+// make the style sheet resolve per cell on every repaint
+void MainWindow::applyModernTableStyle(QTableView *table)
 {
     table->setStyleSheet(R"(
-        QTableWidget {
+        QTableView {
             background-color: #1e1e1e;
             alternate-background-color: #252525;
             selection-background-color: #2a7fff;
@@ -64,18 +169,6 @@ void MainWindow::applyModernTableStyle(QTableWidget *table)
             color: #e0e0e0;
             font-size: 12px;
         }
-        QTableWidget::item {
-            padding: 10px;
-            border-bottom: 1px solid #333333;
-        }
-        QTableWidget::item:selected {
-            background-color: #2a7fff;
-            color: white;
-            border-radius: 4px;
-        }
-        QTableWidget::item:hover {
-            background-color: #2d2d2d;
-        }
         QHeaderView::section {
             background-color: #2d2d2d;
             color: #ffffff;
@@ -85,26 +178,331 @@ void MainWindow::applyModernTableStyle(QTableWidget *table)
             font-size: 13px;
             border-bottom: 2px solid #2a7fff;
         }
-        QTableWidget QScrollBar:vertical {
+        QTableView QScrollBar:vertical {
             background: #2d2d2d;
             width: 12px;
             margin: 0px;
         }
-        QTableWidget QScrollBar::handle:vertical {
+        QTableView QScrollBar::handle:vertical {
             background: #404040;
             border-radius: 6px;
             min-height: 20px;
         }
-        QTableWidget QScrollBar::handle:vertical:hover {
+        QTableView QScrollBar::handle:vertical:hover {
             background: #4a4a4a;
         }
     )");
 
     table->setAlternatingRowColors(true);
     table->setSelectionBehavior(QAbstractItemView::SelectRows);
-    table->setSelectionMode(QAbstractItemView::SingleSelection);
+    // Ctrl/Shift-click selects several rows for the bulk actions
+    table->setSelectionMode(QAbstractItemView::ExtendedSelection);
     table->horizontalHeader()->setStretchLastSection(true);
     table->verticalHeader()->setVisible(false);
+
+    QFont font = table->font();
+    font.setPixelSize(12);
+    TableRowDelegate *delegate = new TableRowDelegate(font, table);
+    table->setItemDelegate(delegate);
+    table->setWordWrap(false);
+    // Uniform rows: the view never asks the delegate for row heights
+    table->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    table->verticalHeader()->setDefaultSectionSize(delegate->rowHeight());
+    // Hover highlight without a :hover rule
+    table->viewport()->setAttribute(Qt::WA_Hover);
+}
+
+QList<int> MainWindow::selectedIds(QTableView *table) const
+{
+    QList<int> ids;
+    const QModelIndexList rows = table->selectionModel()->selectedRows(0);
+    ids.reserve(rows.size());
+    for (const QModelIndex &index : rows)
+        ids << index.data(Qt::UserRole).toInt();
+    return ids;
+}
+
+int MainWindow::firstSelectedRow(QTableView *table) const
+{
+    const QModelIndexList rows = table->selectionModel()->selectedRows(0);
+    return rows.isEmpty() ? -1 : rows.first().row();
+}
+
+void MainWindow::selectIds(QTableView *table, const QList<int> &ids)
+{
+    if (ids.isEmpty())
+        return;
+    const QSet<int> wanted(ids.cbegin(), ids.cend());
+    QItemSelection selection;
+    QAbstractItemModel *model = table->model();
+    for (int row = 0; row < model->rowCount(); ++row) {
+        if (wanted.contains(model->index(row, 0).data(Qt::UserRole).toInt()))
+            selection.select(model->index(row, 0), model->index(row, model->columnCount() - 1));
+    }
+    table->selectionModel()->select(selection, QItemSelectionModel::ClearAndSelect);
+}
+
+void MainWindow::setClientChoice(const ClientRow &client)
+{
+    const QString clientInfo = QString("%1 %2 (ID: %3)").arg(client.prenom, client.nom, QString::number(client.idClient));
+    int index = cmbClient->findData(client.idClient);
+    if (index < 0) {
+        cmbClient->addItem(clientInfo, client.idClient);
+        index = cmbClient->count() - 1;
+    } else {
+        cmbClient->setItemText(index, clientInfo);
+    }
+    cmbClient->setItemData(index, client.nom, NomRole);
+    cmbClient->setItemData(index, client.prenom, PrenomRole);
+}
+
+// Rows changed elsewhere are merged if they match the current search, and
+// dropped from the view if they no longer do
+void MainWindow::applyExternalChanges(const ChangeSet &changes)
+{
+    if (changes.reloadAll) {
+        searchClients();
+        loadCommandesTable();
+        if (clientAnalytics->isLoaded())
+            clientAnalytics->refresh();
+        return;
+    }
+
+    // Same accent- and case-insensitive match as searchClients()
+    const QString clientSearch = SearchKey::normalize(txtSearchClient->text().trimmed());
+    const bool domainSearch = clientSearch.startsWith('@');
+    QVector<ClientRow> clientUpserts;
+    QList<int> clientRemovals = changes.deletedClients;
+    for (const ClientRow &row : changes.clients) {
+        if (clientSearch.isEmpty() || (domainSearch && SearchKey::normalize(row.email).contains(clientSearch))
+            || (!domainSearch && (SearchKey::normalize(row.nom).startsWith(clientSearch)
+                                  || SearchKey::normalize(row.prenom).startsWith(clientSearch)
+                                  || SearchKey::normalize(row.email).startsWith(clientSearch))))
+            clientUpserts << row;
+        else
+            clientRemovals << row.idClient;
+    }
+    if (!clientUpserts.isEmpty() || !clientRemovals.isEmpty()) {
+        const QList<int> selected = selectedIds(clientsTable);
+        clientModel->mergeRows(clientUpserts, clientRemovals);
+        selectIds(clientsTable, selected);
+    }
+
+    // Client choices of the order form
+    for (const ClientRow &row : changes.clients)
+        setClientChoice(row);
+    for (int id : changes.deletedClients) {
+        const int index = cmbClient->findData(id);
+        if (index >= 0)
+            cmbClient->removeItem(index);
+    }
+
+    // The query of the rows shown decides in memory which changed orders stay
+    QVector<CommandeRow> commandeUpserts;
+    QList<int> commandeRemovals = changes.deletedCommandes;
+    const QVector<int> matching = commandeRequest.query.select(changes.commandes);
+    for (int i = 0, next = 0; i < changes.commandes.size(); ++i) {
+        if (next < matching.size() && matching.at(next) == i) {
+            commandeUpserts << changes.commandes.at(i);
+            ++next;
+        } else {
+            commandeRemovals << changes.commandes.at(i).idCommande;
+        }
+    }
+    if (!commandeUpserts.isEmpty() || !commandeRemovals.isEmpty() || !changes.deletedClients.isEmpty()) {
+        const QList<int> selected = selectedIds(commandesTable);
+        commandeModel->mergeRows(commandeUpserts, commandeRemovals, changes.deletedClients);
+        selectIds(commandesTable, selected);
+    }
+
+    clientAnalytics->reloadClients(changes.clientIds() + changes.deletedClients);
+}
+
+bool MainWindow::rejectPendingRows(const QList<int> &ids)
+{
+    for (int id : ids) {
+        if (id < 0) {
+            QMessageBox::warning(this, "Attention", "Enregistrement en cours, réessayez dans un instant");
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MainWindow::rejectArchivedRows(const QList<int> &ids)
+{
+    bool ok = false;
+    const QList<int> archived = dbManager->archivedCommandes(ids, &ok);
+    if (!ok) {
+        QMessageBox::critical(this, "Erreur", "Impossible de vérifier l'archive des commandes");
+        return true;
+    }
+    if (archived.isEmpty())
+        return false;
+    QMessageBox::warning(this, "Commande archivée",
+                         archived.size() == 1
+                             ? QString("Commande archivée: lecture seule")
+                             : QString("%1 commandes sélectionnées sont archivées: lecture seule").arg(archived.size()));
+    return true;
+}
+
+// Saved rows come back as stored and replace the optimistic ones (a new
+// row trades its temporary id for the real one); failed saves put the
+// previous row back
+void MainWindow::applyWriteResults(const WriteBatch &batch)
+{
+    ChangeSet changes;
+    QSet<int> stillQueuedClients;
+    QSet<int> stillQueuedCommandes;
+    QStringList errors;
+    for (const WriteResult &result : batch.results) {
+        const bool isClient = result.kind == PendingWrite::ClientSave;
+        if (writeQueue->isPending(result.kind, result.queuedId)) {
+            // A later save of the row is queued: keep showing that one
+            (isClient ? stillQueuedClients : stillQueuedCommandes).insert(int(result.id));
+            if (!result.ok)
+                errors << result.error;
+            continue;
+        }
+
+        if (result.ok) {
+            if (result.queuedId != result.id)
+                (isClient ? changes.deletedClients : changes.deletedCommandes) << int(result.queuedId);
+            if (isClient)
+                clientRollback.remove(result.queuedId);
+            else
+                commandeRollback.remove(result.queuedId);
+            continue;
+        }
+
+        errors << result.error;
+        if (isClient) {
+            const ClientRow previous = clientRollback.take(result.queuedId);
+            if (previous.idClient == 0)
+                clientModel->mergeRows({}, {int(result.queuedId)});
+            else
+                clientModel->mergeRows({previous}, {});
+        } else {
+            const CommandeRow previous = commandeRollback.take(result.queuedId);
+            if (previous.idCommande == 0)
+                commandeModel->mergeRows({}, {int(result.queuedId)});
+            else
+                commandeModel->mergeRows({previous}, {});
+        }
+    }
+
+    for (const ClientRow &row : batch.clients) {
+        if (!stillQueuedClients.contains(row.idClient))
+            changes.clients << row;
+    }
+    for (const CommandeRow &row : batch.commandes) {
+        if (!stillQueuedCommandes.contains(row.idCommande))
+            changes.commandes << row;
+    }
+    applyExternalChanges(changes);
+    if (!errors.isEmpty())
+        QMessageBox::critical(this, "Erreur", "Enregistrement annulé:\n" + errors.join("\n"));
+}
+
+QHBoxLayout *MainWindow::createQuickFilter(RowTableModel *model)
+{
+    QComboBox *column = new QComboBox(this);
+    column->addItem("Toutes les colonnes", -1);
+    const QStringList headers = model->headers();
+    for (int i = 0; i < headers.size(); ++i)
+        column->addItem(headers.at(i), i);
+    QLineEdit *text = new QLineEdit(this);
+    text->setPlaceholderText("⚡ Filtre rapide sur les lignes affichées...");
+    text->setClearButtonEnabled(true);
+    const QString style = "color: #ffffff; background-color: #2a2a3a; border: 1px solid #404040; "
+                          "border-radius: 6px; padding: 4px 8px; font-size: 12px;";
+    column->setStyleSheet(style);
+    text->setStyleSheet(style);
+
+    auto apply = [model, column, text]() { model->setFilter(column->currentData().toInt(), text->text()); };
+    connect(text, &QLineEdit::textChanged, this, apply);
+    connect(column, &QComboBox::currentIndexChanged, this, apply);
+
+    QHBoxLayout *layout = new QHBoxLayout();
+    layout->addWidget(column);
+    layout->addWidget(text, 1);
+    return layout;
+}
+
+QHBoxLayout *MainWindow::createSearchBar(SearchRunner *runner, QPushButton *&more, QLabel *&status)
+{
+    status = new QLabel(this);
+    status->setStyleSheet("color: #a0a0b0; font-size: 12px;");
+    more = new QPushButton("⏬ Charger plus", this);
+    more->setEnabled(false);
+    QPushButton *cancel = new QPushButton("⛔ Annuler", this);
+    cancel->setEnabled(false);
+    applyModernButtonStyle(more, "#2a7fff");
+    applyModernButtonStyle(cancel, "#ff4757");
+
+    // The next page re-runs the last request from the key it left
+    const bool clients = runner == clientSearch;
+    connect(more, &QPushButton::clicked, this, [this, runner, clients]() {
+        runner->run(clients ? clientRequest : commandeRequest);
+    });
+    connect(cancel, &QPushButton::clicked, runner, &SearchRunner::cancel);
+    connect(runner, &SearchRunner::busyChanged, this, [more, cancel, status](bool busy) {
+        cancel->setEnabled(busy);
+        if (busy) {
+            more->setEnabled(false);
+            status->setText("⏳ Recherche en cours...");
+        }
+    });
+
+    QHBoxLayout *layout = new QHBoxLayout();
+    layout->addWidget(status, 1);
+    layout->addWidget(more);
+    layout->addWidget(cancel);
+    return layout;
+}
+
+void MainWindow::applySearchResult(const SearchResult &result)
+{
+    const bool clients = result.kind == SearchRequest::Clients;
+    SearchRequest &request = clients ? clientRequest : commandeRequest;
+    QLabel *status = clients ? lblClientsStatus : lblCommandesStatus;
+    QPushButton *more = clients ? btnMoreClients : btnMoreCommandes;
+
+    // The rows shown stay; a cancelled "Charger plus" can be tried again
+    if (result.status != SearchResult::Done) {
+        more->setEnabled(!request.after.isEmpty());
+        if (result.status == SearchResult::Cancelled)
+            status->setText("⛔ Recherche annulée");
+        else if (result.status == SearchResult::TimedOut)
+            status->setText(QString("⏱️ Recherche arrêtée après %1 s, précisez les filtres")
+                                .arg(request.timeoutMs / 1000));
+        else
+            status->setText("❌ Erreur de recherche: " + result.error);
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    int shown = 0;
+    if (clients) {
+        if (result.append)
+            clientModel->appendRows(result.clients);
+        else
+            clientModel->setRows(result.clients);
+        shown = clientModel->totalRows();
+    } else {
+        if (result.append)
+            commandeModel->appendRows(result.commandes);
+        else
+            commandeModel->setRows(result.commandes);
+        shown = commandeModel->totalRows();
+    }
+    PerfMonitor::record(request.screen, PerfMonitor::Populate, timer.nsecsElapsed());
+
+    request.after = result.next;
+    more->setEnabled(!result.next.isEmpty());
+    status->setText(result.next.isEmpty() ? QString("%1 ligne(s)").arg(shown)
+                                          : QString("%1 premières lignes, d'autres suivent").arg(shown));
 }
 
 void MainWindow::applyModernButtonStyle(QPushButton *button, const QString &color)
@@ -219,12 +617,17 @@ void MainWindow::setupUI()
     setupClientSection();
     setupCommandeSection();
     setupStatisticsSection();
+    setupDiagnosticsSection();
 
     // Connect header buttons
     connect(btnClients, &QPushButton::clicked, this, &MainWindow::showClientSection);
     connect(btnCommandes, &QPushButton::clicked, this, &MainWindow::showCommandeSection);
     connect(btnStatistics, &QPushButton::clicked, this, &MainWindow::showStatisticsSection);
 
+    // Hidden diagnostics panel for support staff
+    QShortcut *diagShortcut = new QShortcut(QKeySequence("Ctrl+Shift+D"), this);
+    connect(diagShortcut, &QShortcut::activated, this, &MainWindow::toggleDiagnostics);
+
     // Start with client section
     showClientSection();
 }
@@ -256,6 +659,8 @@ void MainWindow::setupClientSection()
     btnExportClientsPDF = new QPushButton("📄 PDF Clients", this);
     btnClientAnalytics = new QPushButton("📊 Analytics", this);
     btnClientDetails = new QPushButton("👁️ Détails", this);
+    btnClientStatements = new QPushButton("🧾 Relevés", this);
+    btnExportClientsCSV = new QPushButton("📑 CSV Clients", this);
 
     applyModernButtonStyle(btnAddClient, "#00d4aa");
     applyModernButtonStyle(btnEditClient, "#2a7fff");
@@ -264,6 +669,8 @@ void MainWindow::setupClientSection()
     applyModernButtonStyle(btnExportClientsPDF, "#ff6b35");
     applyModernButtonStyle(btnClientAnalytics, "#a55eea");
     applyModernButtonStyle(btnClientDetails, "#00d4aa");
+    applyModernButtonStyle(btnClientStatements, "#ff6b35");
+    applyModernButtonStyle(btnExportClientsCSV, "#ff6b35");
 
     clientButtonLayout->addWidget(btnAddClient);
     clientButtonLayout->addWidget(btnEditClient);
@@ -271,7 +678,9 @@ void MainWindow::setupClientSection()
     clientButtonLayout->addWidget(btnClientDetails);
     clientButtonLayout->addWidget(btnClientAnalytics);
     clientButtonLayout->addStretch();
+    clientButtonLayout->addWidget(btnClientStatements);
     clientButtonLayout->addWidget(btnExportClientsPDF);
+    clientButtonLayout->addWidget(btnExportClientsCSV);
     clientButtonLayout->addWidget(btnRefreshClients);
 
     // Client Search Frame
@@ -287,7 +696,7 @@ void MainWindow::setupClientSection()
     clientSearchLayout = new QHBoxLayout(clientSearchFrame);
 
     txtSearchClient = new QLineEdit(this);
-    txtSearchClient->setPlaceholderText("🔍 Rechercher par nom, prénom ou email...");
+    txtSearchClient->setPlaceholderText("🔍 Début du nom, prénom ou email... ou @domaine");
     txtSearchClient->setStyleSheet(R"(
         QLineEdit {
             background-color: #2d2d3d;
@@ -337,11 +746,16 @@ void MainWindow::setupClientSection()
     )");
 
     QVBoxLayout *tableLayout = new QVBoxLayout(clientTableGroup);
-    clientsTable = new QTableWidget(this);
-    clientsTable->setColumnCount(7); // Added command count column
-    clientsTable->setHorizontalHeaderLabels({"ID", "Nom", "Prénom", "Email", "Téléphone", "Adresse", "Nb Commandes"});
+    clientModel = new ClientTableModel(this);
+    clientsTable = new QTableView(this);
+    clientsTable->setModel(clientModel);
     applyModernTableStyle(clientsTable);
+    // Header clicks sort the loaded rows; no indicator keeps the query order
+    clientsTable->horizontalHeader()->setSortIndicator(-1, Qt::AscendingOrder);
+    clientsTable->setSortingEnabled(true);
+    tableLayout->addLayout(createQuickFilter(clientModel));
     tableLayout->addWidget(clientsTable);
+    tableLayout->addLayout(createSearchBar(clientSearch, btnMoreClients, lblClientsStatus));
 
     // Client Form Group (initially hidden)
     clientFormGroup = new QGroupBox("📝 Formulaire Client", this);
@@ -467,6 +881,8 @@ void MainWindow::setupClientSection()
     connect(btnExportClientsPDF, &QPushButton::clicked, this, &MainWindow::exportClientsPDF);
     connect(btnClientAnalytics, &QPushButton::clicked, this, &MainWindow::showClientAnalytics);
     connect(btnClientDetails, &QPushButton::clicked, this, &MainWindow::showClientDetails);
+    connect(btnClientStatements, &QPushButton::clicked, this, &MainWindow::generateClientStatements);
+    connect(btnExportClientsCSV, &QPushButton::clicked, this, &MainWindow::exportClientsCSV);
 
     stackedWidget->addWidget(clientWidget);
 }
@@ -494,20 +910,32 @@ void MainWindow::setupCommandeSection()
     btnAddCommande = new QPushButton("➕ Nouvelle Commande", this);
     btnEditCommande = new QPushButton("✏️ Modifier", this);
     btnDeleteCommande = new QPushButton("🗑️ Supprimer", this);
+    btnBulkStatut = new QPushButton("🏷️ Statut", this);
+    btnBulkPaiement = new QPushButton("💳 Paiement", this);
+    btnStatusRules = new QPushButton("⚙️ Règles", this);
     btnRefreshCommandes = new QPushButton("🔄 Actualiser", this);
     btnExportPDF = new QPushButton("📄 PDF Ce Mois", this);
+    btnExportCommandesCSV = new QPushButton("📑 CSV Filtré", this);
 
     applyModernButtonStyle(btnAddCommande, "#00d4aa");
     applyModernButtonStyle(btnEditCommande, "#2a7fff");
     applyModernButtonStyle(btnDeleteCommande, "#ff4757");
+    applyModernButtonStyle(btnBulkStatut, "#a55eea");
+    applyModernButtonStyle(btnBulkPaiement, "#a55eea");
+    applyModernButtonStyle(btnStatusRules, "#6c757d");
     applyModernButtonStyle(btnRefreshCommandes, "#6c757d");
     applyModernButtonStyle(btnExportPDF, "#ff6b35");
+    applyModernButtonStyle(btnExportCommandesCSV, "#ff6b35");
 
     commandeButtonLayout->addWidget(btnAddCommande);
     commandeButtonLayout->addWidget(btnEditCommande);
     commandeButtonLayout->addWidget(btnDeleteCommande);
+    commandeButtonLayout->addWidget(btnBulkStatut);
+    commandeButtonLayout->addWidget(btnBulkPaiement);
     commandeButtonLayout->addStretch();
     commandeButtonLayout->addWidget(btnExportPDF);
+    commandeButtonLayout->addWidget(btnExportCommandesCSV);
+    commandeButtonLayout->addWidget(btnStatusRules);
     commandeButtonLayout->addWidget(btnRefreshCommandes);
 
     // Commande Search Group
@@ -552,14 +980,17 @@ void MainWindow::setupCommandeSection()
     )";
 
     txtSearchCommande = new QLineEdit(this);
-    txtSearchCommande->setPlaceholderText("Nom client...");
+    txtSearchCommande->setPlaceholderText("Nom client... ou statut:LIVRE montant>500 paiement:Virement date:2025-01..2025-03");
+    txtSearchCommande->setToolTip("Champs: client, statut, paiement, montant, date\n"
+                                  "Début du nom par défaut, n'importe où avec *: client:*ali\n"
+                                  "Comparaisons: montant>500, date<=2025-03, montant:100..500\n"
+                                  "Plusieurs valeurs: statut:LIVRE,ANNULE; espaces entre guillemets: paiement:\"Carte Bancaire\"");
     txtSearchCommande->setStyleSheet(filterStyle);
 
     cmbStatutFilter = new QComboBox(this);
     cmbStatutFilter->addItem("📋 Tous les statuts", "");
-    cmbStatutFilter->addItem("🟡 EN_COURS", "EN_COURS");
-    cmbStatutFilter->addItem("🟢 LIVRE", "LIVRE");
-    cmbStatutFilter->addItem("🔴 ANNULE", "ANNULE");
+    for (const QString &code : OrderCodes::statuts())
+        cmbStatutFilter->addItem(OrderCodes::label(code), code);
     cmbStatutFilter->setStyleSheet(filterStyle);
 
     dateFromFilter = new QDateEdit(this);
@@ -624,11 +1055,15 @@ void MainWindow::setupCommandeSection()
     )");
 
     QVBoxLayout *commandeTableLayout = new QVBoxLayout(commandeTableGroup);
-    commandesTable = new QTableWidget(this);
-    commandesTable->setColumnCount(7);
-    commandesTable->setHorizontalHeaderLabels({"ID", "Client", "Date", "Statut", "Montant", "Paiement", "Remarque"});
+    commandeModel = new CommandeTableModel(this);
+    commandesTable = new QTableView(this);
+    commandesTable->setModel(commandeModel);
     applyModernTableStyle(commandesTable);
+    commandesTable->horizontalHeader()->setSortIndicator(-1, Qt::AscendingOrder);
+    commandesTable->setSortingEnabled(true);
+    commandeTableLayout->addLayout(createQuickFilter(commandeModel));
     commandeTableLayout->addWidget(commandesTable);
+    commandeTableLayout->addLayout(createSearchBar(commandeSearch, btnMoreCommandes, lblCommandesStatus));
 
     // Commande Form Group (initially hidden)
     commandeFormGroup = new QGroupBox("📝 Formulaire Commande", this);
@@ -684,18 +1119,16 @@ void MainWindow::setupCommandeSection()
     dateCommande->setDate(QDate::currentDate());
     dateCommande->setCalendarPopup(true);
 
+    // Labels shown, codes stored (see OrderCodes.h)
     cmbStatut = new QComboBox(this);
-    cmbStatut->addItem("🟡 EN_COURS");
-    cmbStatut->addItem("🟢 LIVRE");
-    cmbStatut->addItem("🔴 ANNULE");
+    for (const QString &code : OrderCodes::statuts())
+        cmbStatut->addItem(OrderCodes::label(code), code);
 
     txtMontant = new QLineEdit(this);
 
     cmbMoyenPaiement = new QComboBox(this);
-    cmbMoyenPaiement->addItem("💳 Carte Bancaire");
-    cmbMoyenPaiement->addItem("💵 Espèces");
-    cmbMoyenPaiement->addItem("📄 Chèque");
-    cmbMoyenPaiement->addItem("🏦 Virement");
+    for (const QString &code : OrderCodes::paiements())
+        cmbMoyenPaiement->addItem(OrderCodes::label(code), code);
 
     txtRemarque = new QTextEdit(this);
 
@@ -754,6 +1187,9 @@ void MainWindow::setupCommandeSection()
     connect(btnAddCommande, &QPushButton::clicked, this, &MainWindow::addNewCommande);
     connect(btnEditCommande, &QPushButton::clicked, this, &MainWindow::editSelectedCommande);
     connect(btnDeleteCommande, &QPushButton::clicked, this, &MainWindow::deleteSelectedCommande);
+    connect(btnBulkStatut, &QPushButton::clicked, this, &MainWindow::changeSelectedCommandesStatut);
+    connect(btnBulkPaiement, &QPushButton::clicked, this, &MainWindow::changeSelectedCommandesPaiement);
+    connect(btnStatusRules, &QPushButton::clicked, this, &MainWindow::reviewStatusRules);
     connect(btnSearchCommande, &QPushButton::clicked, this, &MainWindow::searchCommandes);
     connect(btnClearFilter, &QPushButton::clicked, this, [this]() {
         txtSearchCommande->clear();
@@ -766,6 +1202,7 @@ void MainWindow::setupCommandeSection()
     connect(btnSaveCommande, &QPushButton::clicked, this, &MainWindow::saveCommande);
     connect(btnCancelCommande, &QPushButton::clicked, this, &MainWindow::cancelCommandeEdit);
     connect(btnExportPDF, &QPushButton::clicked, this, &MainWindow::exportCommandesPDF);
+    connect(btnExportCommandesCSV, &QPushButton::clicked, this, &MainWindow::exportCommandesCSV);
 
     stackedWidget->addWidget(commandeWidget);
 }
@@ -870,18 +1307,376 @@ void MainWindow::setupStatisticsSection()
     chartsLayout->addWidget(ordersChartGroup);
     chartsLayout->addWidget(revenueChartGroup);
 
+    // Clients leaderboard
+    QGroupBox *leaderboardGroup = new QGroupBox("🏆 Classement Clients", this);
+    leaderboardGroup->setStyleSheet(ordersChartGroup->styleSheet());
+    QVBoxLayout *leaderboardLayout = new QVBoxLayout(leaderboardGroup);
+
+    const QString controlStyle = "color: #ffffff; background-color: #2a2a3a; border: 1px solid #404040; "
+                                 "border-radius: 6px; padding: 4px 8px;";
+    cmbLeaderboardMetric = new QComboBox(this);
+    for (ClientAnalytics::Metric metric : {ClientAnalytics::Metric::Revenue, ClientAnalytics::Metric::OrderCount,
+                                           ClientAnalytics::Metric::AverageBasket, ClientAnalytics::Metric::LastOrder,
+                                           ClientAnalytics::Metric::Rfm})
+        cmbLeaderboardMetric->addItem(ClientAnalytics::metricName(metric), static_cast<int>(metric));
+    cmbLeaderboardOrder = new QComboBox(this);
+    cmbLeaderboardOrder->addItem("⬆️ Meilleurs", true);
+    cmbLeaderboardOrder->addItem("⬇️ Moins bons", false);
+    spinLeaderboardSize = new QSpinBox(this);
+    spinLeaderboardSize->setRange(1, 1000);
+    spinLeaderboardSize->setValue(20);
+    cmbLeaderboardMetric->setStyleSheet(controlStyle);
+    cmbLeaderboardOrder->setStyleSheet(controlStyle);
+    spinLeaderboardSize->setStyleSheet(controlStyle);
+
+    QHBoxLayout *leaderboardControls = new QHBoxLayout();
+    leaderboardControls->addWidget(cmbLeaderboardMetric);
+    leaderboardControls->addWidget(cmbLeaderboardOrder);
+    leaderboardControls->addWidget(spinLeaderboardSize);
+    leaderboardControls->addStretch();
+    leaderboardLayout->addLayout(leaderboardControls);
+
+    leaderboardTable = new QTableWidget(this);
+    leaderboardTable->setColumnCount(8);
+    leaderboardTable->setHorizontalHeaderLabels({"ID", "Client", "Commandes", "CA (€)", "Panier moyen (€)",
+                                                 "Première", "Dernière", "RFM"});
+    leaderboardTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    applyModernTableStyle(leaderboardTable);
+    leaderboardLayout->addWidget(leaderboardTable);
+
+    connect(cmbLeaderboardMetric, &QComboBox::currentIndexChanged, this, &MainWindow::refreshLeaderboard);
+    connect(cmbLeaderboardOrder, &QComboBox::currentIndexChanged, this, &MainWindow::refreshLeaderboard);
+    connect(spinLeaderboardSize, &QSpinBox::valueChanged, this, &MainWindow::refreshLeaderboard);
+    connect(clientAnalytics, &ClientAnalytics::updated, this, [this]() {
+        if (stackedWidget->currentWidget() == statisticsWidget)
+            refreshLeaderboard();
+    });
+
+    // Cohort heatmap: retention or lifetime value by month of first order
+    QGroupBox *cohortGroup = new QGroupBox("📅 Cohortes Clients", this);
+    cohortGroup->setStyleSheet(ordersChartGroup->styleSheet());
+    QVBoxLayout *cohortLayout = new QVBoxLayout(cohortGroup);
+
+    cmbCohortView = new QComboBox(this);
+    cmbCohortView->addItem("📈 Rétention (%)");
+    cmbCohortView->addItem("💶 Valeur vie client (€)");
+    cmbCohortView->setStyleSheet(controlStyle);
+    btnCohortRefresh = new QPushButton("🔄 Cohortes", this);
+    btnCohortRefresh->setStyleSheet("QPushButton { background-color: #a55eea; color: white; border: none; padding: 6px 14px; border-radius: 6px; font-weight: 600; }");
+    lblCohortStatus = new QLabel(this);
+    lblCohortStatus->setStyleSheet("color: #b0b0b0; font-size: 12px;");
+
+    QHBoxLayout *cohortControls = new QHBoxLayout();
+    cohortControls->addWidget(cmbCohortView);
+    cohortControls->addWidget(btnCohortRefresh);
+    cohortControls->addWidget(lblCohortStatus);
+    cohortControls->addStretch();
+    cohortLayout->addLayout(cohortControls);
+
+    cohortTable = new QTableWidget(this);
+    cohortTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    applyModernTableStyle(cohortTable);
+    cohortTable->setSelectionMode(QAbstractItemView::NoSelection);
+    cohortLayout->addWidget(cohortTable);
+
+    cohortWatcher = new QFutureWatcher<bool>(this);
+    connect(cohortWatcher, &QFutureWatcher<bool>::finished, this, &MainWindow::renderCohorts);
+    connect(btnCohortRefresh, &QPushButton::clicked, this, &MainWindow::refreshCohorts);
+    connect(cmbCohortView, &QComboBox::currentIndexChanged, this, &MainWindow::renderCohorts);
+
     // Add all to statistics layout
     statisticsLayout->addWidget(statsHeader);
     statisticsLayout->addWidget(statsSummary);
     statisticsLayout->addLayout(chartsLayout);
+    statisticsLayout->addWidget(leaderboardGroup);
+    statisticsLayout->addWidget(cohortGroup);
 
     stackedWidget->addWidget(statisticsWidget);
 }
 
+void MainWindow::setupDiagnosticsSection()
+{
+    diagnosticsWidget = new QWidget();
+    diagnosticsWidget->setStyleSheet("background: transparent;");
+    QVBoxLayout *diagLayout = new QVBoxLayout(diagnosticsWidget);
+    diagLayout->setSpacing(20);
+    diagLayout->setContentsMargins(0, 0, 0, 0);
+
+    QLabel *diagHeader = new QLabel("🩺 Diagnostics de Performance", this);
+    diagHeader->setStyleSheet(R"(
+        QLabel {
+            color: #ffffff;
+            font-size: 24px;
+            font-weight: bold;
+            padding: 15px;
+            background: qlineargradient(x1:0, y1:0, x2:1, y2:0,
+                                      stop:0 #1a1a2e, stop:1 #16213e);
+            border-radius: 12px;
+            border: 1px solid #2a2a4a;
+        }
+    )");
+    diagHeader->setAlignment(Qt::AlignCenter);
+
+    diagMemoryLabel = new QLabel(this);
+    diagMemoryLabel->setStyleSheet(R"(
+        QLabel {
+            color: #e0e0e0;
+            font-size: 14px;
+            padding: 12px;
+            background-color: #1e1e2e;
+            border-radius: 12px;
+            border: 1px solid #2a2a3a;
+        }
+    )");
+
+    // One row per screen, last / average / max per phase
+    diagTimingsTable = new QTableWidget(this);
+    diagTimingsTable->setColumnCount(6);
+    diagTimingsTable->setHorizontalHeaderLabels({"Écran", "Requête (ms)", "Lecture/conversion (ms)",
+                                                 "Remplissage (ms)", "Graphiques (ms)", "Échantillons"});
+    diagTimingsTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    applyModernTableStyle(diagTimingsTable);
+
+    diagCacheTable = new QTableWidget(this);
+    diagCacheTable->setColumnCount(4);
+    diagCacheTable->setHorizontalHeaderLabels({"Cache", "Hits", "Misses", "Taux de hit"});
+    diagCacheTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    applyModernTableStyle(diagCacheTable);
+
+    // Plan of each key query as last run (EXPLAIN), while the capture is on
+    diagPlansTable = new QTableWidget(this);
+    diagPlansTable->setColumnCount(3);
+    diagPlansTable->setHorizontalHeaderLabels({"Requête", "Plan d'exécution", "Parcours complets"});
+    diagPlansTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    applyModernTableStyle(diagPlansTable);
+    diagPlansTable->setVisible(false);
+
+    QPushButton *btnResetDiag = new QPushButton("🔄 Réinitialiser", this);
+    applyModernButtonStyle(btnResetDiag, "#6c757d");
+    btnCapturePlans = new QPushButton("🔎 Capturer les plans", this);
+    btnCapturePlans->setCheckable(true);
+    applyModernButtonStyle(btnCapturePlans, "#6c757d");
+    QHBoxLayout *diagButtons = new QHBoxLayout();
+    diagButtons->addWidget(diagMemoryLabel, 1);
+    diagButtons->addWidget(btnCapturePlans);
+    diagButtons->addWidget(btnResetDiag);
+
+    diagLayout->addWidget(diagHeader);
+    diagLayout->addLayout(diagButtons);
+    diagLayout->addWidget(diagTimingsTable, 2);
+    diagLayout->addWidget(diagCacheTable, 1);
+    diagLayout->addWidget(diagPlansTable, 2);
+
+    diagRefreshTimer = new QTimer(this);
+    diagRefreshTimer->setInterval(1000);
+    connect(diagRefreshTimer, &QTimer::timeout, this, &MainWindow::refreshDiagnostics);
+    connect(btnResetDiag, &QPushButton::clicked, this, [this]() {
+        PerfMonitor::reset();
+        dbManager->clearCapturedPlans();
+        refreshDiagnostics();
+    });
+    connect(btnCapturePlans, &QPushButton::toggled, this, [this](bool enabled) {
+        dbManager->setPlanCapture(enabled);
+        diagPlansTable->setVisible(enabled);
+        refreshDiagnostics();
+    });
+
+    sectionBeforeDiagnostics = nullptr;
+    stackedWidget->addWidget(diagnosticsWidget);
+
+    // Refreshes only while the page is shown, whatever navigated away from it
+    connect(stackedWidget, &QStackedWidget::currentChanged, this, [this]() {
+        if (stackedWidget->currentWidget() == diagnosticsWidget)
+            diagRefreshTimer->start();
+        else
+            diagRefreshTimer->stop();
+    });
+}
+
+void MainWindow::toggleDiagnostics()
+{
+    if (stackedWidget->currentWidget() == diagnosticsWidget) {
+        stackedWidget->setCurrentWidget(sectionBeforeDiagnostics ? sectionBeforeDiagnostics : clientWidget);
+        return;
+    }
+
+    sectionBeforeDiagnostics = stackedWidget->currentWidget();
+    refreshDiagnostics();
+    stackedWidget->setCurrentWidget(diagnosticsWidget);
+}
+
+void MainWindow::refreshDiagnostics()
+{
+    auto formatTiming = [](const PerfMonitor::Timing &t) {
+        if (t.samples == 0) return QString("-");
+        return QString("%1 (moy %2, max %3)")
+            .arg(QString::number(t.lastMs(), 'f', 2),
+                 QString::number(t.avgMs(), 'f', 2),
+                 QString::number(t.maxMs(), 'f', 2));
+    };
+
+    const QMap<QString, QMap<QString, PerfMonitor::Timing>> timings = PerfMonitor::timings();
+    const QStringList phases = PerfMonitor::phases();
+    diagTimingsTable->setRowCount(timings.size());
+    int row = 0;
+    for (auto it = timings.cbegin(); it != timings.cend(); ++it, ++row) {
+        int samples = 0;
+        diagTimingsTable->setItem(row, 0, new QTableWidgetItem(it.key()));
+        for (int p = 0; p < phases.size(); ++p) {
+            const PerfMonitor::Timing t = it.value().value(phases.at(p));
+            samples = qMax(samples, t.samples);
+            diagTimingsTable->setItem(row, p + 1, new QTableWidgetItem(formatTiming(t)));
+        }
+        diagTimingsTable->setItem(row, 5, new QTableWidgetItem(QString::number(samples)));
+    }
+
+    const QMap<QString, PerfMonitor::CacheStats> caches = PerfMonitor::cacheStats();
+    diagCacheTable->setRowCount(caches.size());
+    row = 0;
+    for (auto it = caches.cbegin(); it != caches.cend(); ++it, ++row) {
+        diagCacheTable->setItem(row, 0, new QTableWidgetItem(it.key()));
+        diagCacheTable->setItem(row, 1, new QTableWidgetItem(QString::number(it.value().hits)));
+        diagCacheTable->setItem(row, 2, new QTableWidgetItem(QString::number(it.value().misses)));
+        diagCacheTable->setItem(row, 3, new QTableWidgetItem(
+                                             QString::number(it.value().hitRate() * 100.0, 'f', 1) + " %"));
+    }
+
+    if (dbManager->planCapture()) {
+        const QMap<QString, QStringList> plans = dbManager->capturedPlans();
+        diagPlansTable->setRowCount(plans.size());
+        row = 0;
+        for (auto it = plans.cbegin(); it != plans.cend(); ++it, ++row) {
+            const QStringList scans = DatabaseManager::fullScans(it.value());
+            diagPlansTable->setItem(row, 0, new QTableWidgetItem(it.key()));
+            diagPlansTable->setItem(row, 1, new QTableWidgetItem(it.value().join("\n")));
+            diagPlansTable->setItem(row, 2, new QTableWidgetItem(scans.isEmpty() ? QString("-") : "⚠️ " + scans.join(", ")));
+        }
+        diagPlansTable->resizeRowsToContents();
+    }
+
+    const qint64 rss = PerfMonitor::residentMemoryBytes();
+    diagMemoryLabel->setText(rss >= 0
+                                 ? QString("💾 Mémoire du processus: %1 Mo").arg(QString::number(rss / (1024.0 * 1024.0), 'f', 1))
+                                 : QString("💾 Mémoire du processus: N/A"));
+}
+
+void MainWindow::refreshLeaderboard()
+{
+    const auto metric = static_cast<ClientAnalytics::Metric>(cmbLeaderboardMetric->currentData().toInt());
+    const int size = spinLeaderboardSize->value();
+    const QList<ClientMetrics> ranking = cmbLeaderboardOrder->currentData().toBool()
+                                             ? clientAnalytics->top(size, metric)
+                                             : clientAnalytics->bottom(size, metric);
+
+    // Numbers are stored as numbers so the header sort is numeric
+    auto numberItem = [](double value, int decimals) {
+        QTableWidgetItem *item = new QTableWidgetItem();
+        item->setData(Qt::DisplayRole, decimals > 0 ? QVariant(QString::number(value, 'f', decimals).toDouble())
+                                                    : QVariant(qint64(value)));
+        return item;
+    };
+
+    leaderboardTable->setSortingEnabled(false);
+    leaderboardTable->setRowCount(ranking.size());
+    for (int row = 0; row < ranking.size(); ++row) {
+        const ClientMetrics &m = ranking.at(row);
+        leaderboardTable->setItem(row, 0, numberItem(m.idClient, 0));
+        leaderboardTable->setItem(row, 1, new QTableWidgetItem(m.prenom + " " + m.nom));
+        leaderboardTable->setItem(row, 2, numberItem(m.orderCount, 0));
+        leaderboardTable->setItem(row, 3, numberItem(m.revenue, 2));
+        leaderboardTable->setItem(row, 4, numberItem(m.averageBasket(), 2));
+        leaderboardTable->setItem(row, 5, new QTableWidgetItem(m.firstOrder.toString("yyyy-MM-dd")));
+        leaderboardTable->setItem(row, 6, new QTableWidgetItem(m.lastOrder.toString("yyyy-MM-dd")));
+        leaderboardTable->setItem(row, 7, new QTableWidgetItem(m.rfm()));
+    }
+    leaderboardTable->setSortingEnabled(true);
+}
+
+void MainWindow::refreshCohorts()
+{
+    if (cohortWatcher->isRunning())
+        return;
+
+    btnCohortRefresh->setEnabled(false);
+    lblCohortStatus->setText("⏳ Calcul des cohortes...");
+    CohortAnalysis *analysis = cohortAnalysis;
+    cohortWatcher->setFuture(QtConcurrent::run([analysis]() {
+        QString error;
+        const bool ok = analysis->compute(&error);
+        if (!ok)
+            qWarning() << "Cohort analysis failed:" << error;
+        return ok;
+    }));
+}
+
+void MainWindow::renderCohorts()
+{
+    btnCohortRefresh->setEnabled(!cohortWatcher->isRunning());
+    if (!cohortWatcher->isRunning() && cohortWatcher->future().resultCount() > 0 && !cohortWatcher->result()) {
+        lblCohortStatus->setText("❌ Calcul des cohortes impossible");
+        return;
+    }
+
+    const CohortMatrix matrix = cohortAnalysis->matrix();
+    if (matrix.isEmpty()) {
+        cohortTable->clear();
+        return;
+    }
+    lblCohortStatus->setText(QString("%1 commandes lues (%2)")
+                                 .arg(cohortAnalysis->lastRunOrders())
+                                 .arg(cohortAnalysis->lastRunIncremental() ? "mois courant" : "calcul complet"));
+
+    const bool lifetimeValue = cmbCohortView->currentIndex() == 1;
+    double maxValue = 0.0;
+    if (lifetimeValue) {
+        for (int cohort = 0; cohort < matrix.months; ++cohort)
+            maxValue = qMax(maxValue, matrix.lifetimeValue(cohort, matrix.offsets(cohort) - 1));
+    }
+
+    QStringList columns{"Clients"};
+    for (int offset = 0; offset < matrix.months; ++offset)
+        columns << QString("M%1").arg(offset);
+    QStringList rows;
+    for (int cohort = 0; cohort < matrix.months; ++cohort)
+        rows << matrix.cohortDate(cohort).toString("yyyy-MM");
+
+    cohortTable->clear();
+    cohortTable->setColumnCount(columns.size());
+    cohortTable->setRowCount(rows.size());
+    cohortTable->setHorizontalHeaderLabels(columns);
+    cohortTable->setVerticalHeaderLabels(rows);
+
+    const QColor low("#1e1e1e");
+    const QColor high("#a55eea");
+    for (int cohort = 0; cohort < matrix.months; ++cohort) {
+        cohortTable->setItem(cohort, 0, new QTableWidgetItem(QString::number(matrix.cohortSize.at(cohort))));
+        if (matrix.cohortSize.at(cohort) == 0)
+            continue;
+        for (int offset = 0; offset < matrix.offsets(cohort); ++offset) {
+            const double value = lifetimeValue ? matrix.lifetimeValue(cohort, offset) : matrix.retention(cohort, offset);
+            const double shade = lifetimeValue ? (maxValue > 0 ? value / maxValue : 0.0) : value;
+            QTableWidgetItem *item = new QTableWidgetItem(lifetimeValue ? QString::number(value, 'f', 0)
+                                                                        : QString::number(value * 100.0, 'f', 1));
+            item->setTextAlignment(Qt::AlignCenter);
+            item->setBackground(QColor(low.red() + int((high.red() - low.red()) * shade),
+                                       low.green() + int((high.green() - low.green()) * shade),
+                                       low.blue() + int((high.blue() - low.blue()) * shade)));
+            cohortTable->setItem(cohort, offset + 1, item);
+        }
+    }
+    cohortTable->resizeColumnsToContents();
+}
+
 void MainWindow::updateStatisticsCharts()
 {
+    const QString screen = "updateStatisticsCharts";
+    QElapsedTimer timer;
+    timer.start();
     int currentYear = QDate::currentDate().year();
-    QSqlQuery stats = dbManager->ordersPerMonth(currentYear);
+    MonthlyStats monthly;
+    MonthlyStats::load(*dbManager, currentYear, monthly);
+    PerfMonitor::record(screen, PerfMonitor::Query, timer.nsecsElapsed());
+    timer.restart();
 
     // Prepare data
     QBarSet *ordersSet = new QBarSet("Commandes");
@@ -891,29 +1686,16 @@ void MainWindow::updateStatisticsCharts()
     months << "Jan" << "Fév" << "Mar" << "Avr" << "Mai" << "Jun"
            << "Jul" << "Aoû" << "Sep" << "Oct" << "Nov" << "Déc";
 
-    QVector<int> ordersData(12, 0);
-    QVector<double> revenueData(12, 0.0);
+    const int totalOrders = monthly.totalOrders;
+    const double totalRevenue = monthly.totalRevenue;
 
-    int totalOrders = 0;
-    double totalRevenue = 0.0;
-
-    while (stats.next()) {
-        int mois = stats.value("mois").toInt() - 1; // Convert to 0-based index
-        int nbCommandes = stats.value("total").toInt();
-        double ca = stats.value("chiffre").toDouble();
-
-        if (mois >= 0 && mois < 12) {
-            ordersData[mois] = nbCommandes;
-            revenueData[mois] = ca;
-            totalOrders += nbCommandes;
-            totalRevenue += ca;
-        }
-    }
+    PerfMonitor::record(screen, PerfMonitor::Fetch, timer.nsecsElapsed());
+    timer.restart();
 
     // Populate barsets
     for (int i = 0; i < 12; ++i) {
-        *ordersSet << ordersData[i];
-        *revenueSet << revenueData[i];
+        *ordersSet << monthly.orders[i];
+        *revenueSet << monthly.revenue[i];
     }
 
     // Style the barsets
@@ -979,6 +1761,8 @@ void MainWindow::updateStatisticsCharts()
     revenueSeries->attachAxis(axisYRevenue);
 
     chartViewRevenue->setChart(revenueChart);
+    PerfMonitor::record(screen, PerfMonitor::Chart, timer.nsecsElapsed());
+    timer.restart();
 
     // Update summary
     QString summaryText = QString("📊 Résumé Annuel %1\n\n"
@@ -991,6 +1775,7 @@ void MainWindow::updateStatisticsCharts()
                                    totalOrders > 0 ? QString::number(totalRevenue / totalOrders, 'f', 2) : "0.00");
 
     statsSummary->setText(summaryText);
+    PerfMonitor::record(screen, PerfMonitor::Populate, timer.nsecsElapsed());
 }
 
 void MainWindow::showClientSection()
@@ -1012,6 +1797,8 @@ void MainWindow::showCommandeSection()
 void MainWindow::showStatisticsSection()
 {
     updateStatisticsCharts();
+    refreshLeaderboard();
+    refreshCohorts();
     stackedWidget->setCurrentWidget(statisticsWidget);
     btnStatistics->setStyleSheet("QPushButton { background-color: #954dd6; color: white; border: none; padding: 10px 20px; border-radius: 8px; font-weight: 600; font-size: 13px; }");
     btnClients->setStyleSheet("QPushButton { background-color: #00d4aa; color: white; border: none; padding: 10px 20px; border-radius: 8px; font-weight: 600; font-size: 13px; }");
@@ -1021,21 +1808,19 @@ void MainWindow::showStatisticsSection()
 // Client methods
 void MainWindow::loadClientsTable()
 {
-    QSqlQuery query = dbManager->getClientsWithCommandCount();
-    clientsTable->setRowCount(0);
+    runClientSearch("loadClientsTable", QString());
+}
 
-    int row = 0;
-    while (query.next()) {
-        clientsTable->insertRow(row);
-        clientsTable->setItem(row, 0, new QTableWidgetItem(query.value("id_client").toString()));
-        clientsTable->setItem(row, 1, new QTableWidgetItem(query.value("nom").toString()));
-        clientsTable->setItem(row, 2, new QTableWidgetItem(query.value("prenom").toString()));
-        clientsTable->setItem(row, 3, new QTableWidgetItem(query.value("email").toString()));
-        clientsTable->setItem(row, 4, new QTableWidgetItem(query.value("telephone").toString()));
-        clientsTable->setItem(row, 5, new QTableWidgetItem(query.value("adresse").toString()));
-        clientsTable->setItem(row, 6, new QTableWidgetItem(query.value("nb_commandes").toString()));
-        row++;
-    }
+// First page only; applySearchResult() fills the table
+void MainWindow::runClientSearch(const QString &screen, const QString &textLike)
+{
+    clientRequest = SearchRequest();
+    clientRequest.kind = SearchRequest::Clients;
+    clientRequest.screen = screen;
+    clientRequest.textLike = textLike;
+    clientRequest.limit = searchConfig.pageSize;
+    clientRequest.timeoutMs = searchConfig.timeoutMs;
+    clientSearch->run(clientRequest);
 }
 
 void MainWindow::addNewClient()
@@ -1048,18 +1833,19 @@ void MainWindow::addNewClient()
 
 void MainWindow::editSelectedClient()
 {
-    QList<QTableWidgetItem*> selected = clientsTable->selectedItems();
-    if (selected.isEmpty()) {
+    const int row = firstSelectedRow(clientsTable);
+    if (row < 0) {
         QMessageBox::warning(this, "Attention", "Veuillez sélectionner un client à modifier");
         return;
     }
 
-    int row = selected.first()->row();
-    currentClientId = clientsTable->item(row, 0)->text().toInt();
+    currentClientId = clientModel->rowAt(row).idClient;
 
-    QSqlRecord record;
-    if (dbManager->getClient(currentClientId, record)) {
-        populateClientForm(record);
+    // A queued save is newer than the database
+    Client client;
+    if ((writeQueue && writeQueue->pendingClient(currentClientId, client))
+        || dbManager->getClient(currentClientId, client)) {
+        populateClientForm(client);
         clientFormGroup->setVisible(true);
         isEditingClient = true;
     } else {
@@ -1069,23 +1855,32 @@ void MainWindow::editSelectedClient()
 
 void MainWindow::deleteSelectedClient()
 {
-    QList<QTableWidgetItem*> selected = clientsTable->selectedItems();
-    if (selected.isEmpty()) {
+    const QList<int> ids = selectedIds(clientsTable);
+    if (ids.isEmpty()) {
         QMessageBox::warning(this, "Attention", "Veuillez sélectionner un client à supprimer");
         return;
     }
+    if (rejectPendingRows(ids))
+        return;
 
-    int row = selected.first()->row();
-    int clientId = clientsTable->item(row, 0)->text().toInt();
-    QString clientName = clientsTable->item(row, 1)->text() + " " + clientsTable->item(row, 2)->text();
+    QString question;
+    if (ids.size() == 1) {
+        const ClientRow &client = clientModel->rowAt(firstSelectedRow(clientsTable));
+        QString clientName = client.nom + " " + client.prenom;
+        question = QString("Êtes-vous sûr de vouloir supprimer le client '%1' ?").arg(clientName);
+    } else {
+        question = QString("Êtes-vous sûr de vouloir supprimer les %1 clients sélectionnés et leurs commandes ?").arg(ids.size());
+    }
 
-    QMessageBox::StandardButton reply = QMessageBox::question(this, "Confirmation",
-                                                              QString("Êtes-vous sûr de vouloir supprimer le client '%1' ?").arg(clientName),
+    QMessageBox::StandardButton reply = QMessageBox::question(this, "Confirmation", question,
                                                               QMessageBox::Yes | QMessageBox::No);
 
     if (reply == QMessageBox::Yes) {
-        if (dbManager->deleteClient(clientId)) {
-            QMessageBox::information(this, "Succès", "Client supprimé avec succès");
+        const bool success = ids.size() == 1 ? dbManager->deleteClient(ids.first()) : dbManager->deleteClients(ids);
+        if (success) {
+            QMessageBox::information(this, "Succès",
+                                     ids.size() == 1 ? QString("Client supprimé avec succès")
+                                                     : QString("%1 clients supprimés avec succès").arg(ids.size()));
             loadClientsTable();
         } else {
             QMessageBox::critical(this, "Erreur", "Erreur lors de la suppression du client");
@@ -1095,34 +1890,14 @@ void MainWindow::deleteSelectedClient()
 
 void MainWindow::searchClients()
 {
+    // A prefix, so the search can seek idx_client_*_key; "@domaine" looks
+    // after the @ of the emails instead (full scan)
     QString searchText = txtSearchClient->text().trimmed();
-    QString filter = searchText.isEmpty() ? "" : "%" + searchText + "%";
-
-    QString sql = "SELECT c.*, COUNT(co.id_commande) as nb_commandes FROM client c LEFT JOIN commande co ON c.id_client = co.id_client "
-                  "WHERE c.nom LIKE ? OR c.prenom LIKE ? OR c.email LIKE ? "
-                  "GROUP BY c.id_client, c.nom, c.prenom, c.email, c.telephone, c.adresse "
-                  "ORDER BY c.nom, c.prenom";
-    QSqlQuery query(dbManager->getDatabase());
-    query.prepare(sql);
-    query.addBindValue(filter.isEmpty() ? "%" : filter);
-    query.addBindValue(filter.isEmpty() ? "%" : filter);
-    query.addBindValue(filter.isEmpty() ? "%" : filter);
-
-    if (query.exec()) {
-        clientsTable->setRowCount(0);
-        int row = 0;
-        while (query.next()) {
-            clientsTable->insertRow(row);
-            clientsTable->setItem(row, 0, new QTableWidgetItem(query.value("id_client").toString()));
-            clientsTable->setItem(row, 1, new QTableWidgetItem(query.value("nom").toString()));
-            clientsTable->setItem(row, 2, new QTableWidgetItem(query.value("prenom").toString()));
-            clientsTable->setItem(row, 3, new QTableWidgetItem(query.value("email").toString()));
-            clientsTable->setItem(row, 4, new QTableWidgetItem(query.value("telephone").toString()));
-            clientsTable->setItem(row, 5, new QTableWidgetItem(query.value("adresse").toString()));
-            clientsTable->setItem(row, 6, new QTableWidgetItem(query.value("nb_commandes").toString()));
-            row++;
-        }
-    }
+    QString filter = searchText.isEmpty() ? "%"
+                     : searchText.startsWith('@') ? "%" + searchText + "%"
+                     : searchText + "%";
+
+    runClientSearch("searchClients", filter);
 }
 
 void MainWindow::saveClient()
@@ -1136,17 +1911,39 @@ void MainWindow::saveClient()
         return;
     }
 
-    bool success = false;
-    qint64 newId;
+    Client client;
+    client.nom = nom;
+    client.prenom = prenom;
+    client.email = email;
+    client.telephone = txtClientTelephone->text().trimmed();
+    client.adresse = txtClientAdresse->toPlainText().trimmed();
+
+    // Queued: the row shows right away, applyWriteResults() confirms it
+    if (writeQueue) {
+        if (isEditingClient)
+            client.idClient = currentClientId;
+        ClientRow row;
+        const bool known = clientModel->rowById(int(client.idClient), row);
+        const qint64 id = writeQueue->saveClient(client);
+        if (!clientRollback.contains(id))
+            clientRollback.insert(id, known ? row : ClientRow());
+        row.idClient = int(id);
+        row.nom = client.nom;
+        row.prenom = client.prenom;
+        row.email = client.email;
+        row.telephone = client.telephone;
+        row.adresse = client.adresse;
+        clientModel->mergeRows({row}, {});
+        clientFormGroup->setVisible(false);
+        return;
+    }
 
+    bool success = false;
     if (isEditingClient) {
-        success = dbManager->updateClient(currentClientId, nom, prenom, email,
-                                          txtClientTelephone->text().trimmed(),
-                                          txtClientAdresse->toPlainText().trimmed());
+        client.idClient = currentClientId;
+        success = dbManager->updateClient(client);
     } else {
-        success = dbManager->addClient(nom, prenom, email,
-                                       txtClientTelephone->text().trimmed(),
-                                       txtClientAdresse->toPlainText().trimmed(), newId);
+        success = dbManager->addClient(client);
     }
 
     if (success) {
@@ -1172,25 +1969,18 @@ void MainWindow::clearClientForm()
     txtClientAdresse->clear();
 }
 
-void MainWindow::populateClientForm(const QSqlRecord &record)
+void MainWindow::populateClientForm(const Client &client)
 {
-    txtClientNom->setText(record.value("nom").toString());
-    txtClientPrenom->setText(record.value("prenom").toString());
-    txtClientEmail->setText(record.value("email").toString());
-    txtClientTelephone->setText(record.value("telephone").toString());
-    txtClientAdresse->setText(record.value("adresse").toString());
+    txtClientNom->setText(client.nom);
+    txtClientPrenom->setText(client.prenom);
+    txtClientEmail->setText(client.email);
+    txtClientTelephone->setText(client.telephone);
+    txtClientAdresse->setText(client.adresse);
 }
 
 // New client methods
 void MainWindow::exportClientsPDF()
 {
-    QSqlQuery query = dbManager->getClientsWithCommandCount();
-
-    if (!query.isActive()) {
-        QMessageBox::critical(this, "Erreur", "Impossible de récupérer les clients: " + query.lastError().text());
-        return;
-    }
-
     // Ask for save location
     QString fileName = QFileDialog::getSaveFileName(this, "Exporter PDF Clients",
                                                     "liste_clients.pdf",
@@ -1200,125 +1990,68 @@ void MainWindow::exportClientsPDF()
         return;
     }
 
-    // Create HTML content
-    QString html;
-    html += "<html><head><style>";
-    html += "body { font-family: Arial, sans-serif; margin: 20px; }";
-    html += "h1 { color: #2a7fff; text-align: center; }";
-    html += "h2 { color: #333; border-bottom: 2px solid #2a7fff; padding-bottom: 5px; }";
-    html += "table { width: 100%; border-collapse: collapse; margin: 20px 0; }";
-    html += "th { background-color: #2a7fff; color: white; padding: 10px; text-align: left; }";
-    html += "td { padding: 8px; border: 1px solid #ddd; }";
-    html += "tr:nth-child(even) { background-color: #f2f2f2; }";
-    html += ".summary { background-color: #e8f4ff; padding: 15px; border-radius: 5px; margin: 20px 0; }";
-    html += ".total { font-weight: bold; color: #2a7fff; }";
-    html += "</style></head><body>";
-
-    // Header
-    html += "<h1>Liste des Clients</h1>";
-    html += "<p>Généré le: " + QDateTime::currentDateTime().toString("dd/MM/yyyy à HH:mm") + "</p>";
-
-    // Summary
-    int totalClients = 0;
-    int totalCommands = 0;
-
-    // First pass to calculate totals
-    QSqlQuery countQuery = dbManager->getClientsWithCommandCount();
-    while (countQuery.next()) {
-        totalClients++;
-        totalCommands += countQuery.value("nb_commandes").toInt();
-    }
-
-    html += "<div class='summary'>";
-    html += "<h2>Résumé</h2>";
-    html += "<p>Total des clients: <span class='total'>" + QString::number(totalClients) + "</span></p>";
-    html += "<p>Total des commandes: <span class='total'>" + QString::number(totalCommands) + "</span></p>";
-    html += "<p>Moyenne par client: <span class='total'>" + (totalClients > 0 ? QString::number(static_cast<double>(totalCommands) / totalClients, 'f', 1) : "0") + "</span></p>";
-    html += "</div>";
-
-    // Table header
-    html += "<h2>Détail des Clients</h2>";
-    html += "<table>";
-    html += "<tr>";
-    html += "<th>ID</th>";
-    html += "<th>Nom</th>";
-    html += "<th>Prénom</th>";
-    html += "<th>Email</th>";
-    html += "<th>Téléphone</th>";
-    html += "<th>Adresse</th>";
-    html += "<th>Nb Commandes</th>";
-    html += "</tr>";
-
-    // Table rows
-    while (query.next()) {
-        html += "<tr>";
-        html += "<td>" + query.value("id_client").toString() + "</td>";
-        html += "<td>" + query.value("nom").toString() + "</td>";
-        html += "<td>" + query.value("prenom").toString() + "</td>";
-        html += "<td>" + query.value("email").toString() + "</td>";
-        html += "<td>" + query.value("telephone").toString() + "</td>";
-        html += "<td>" + query.value("adresse").toString() + "</td>";
-        html += "<td>" + query.value("nb_commandes").toString() + "</td>";
-        html += "</tr>";
-    }
-
-    html += "</table>";
-    html += "</body></html>";
-
-    // Generate PDF
-    generatePDF(fileName, html);
+    ReportGenerator::Result result = ReportGenerator::exportClientsPDF(*dbManager, fileName);
+    if (!result.ok) {
+        QMessageBox::critical(this, "Erreur", result.error);
+        return;
+    }
 
     QMessageBox::information(this, "Succès",
                              QString("PDF généré avec succès!\n"
                                      "Clients exportés: %1\n"
                                      "Fichier: %2")
-                                 .arg(QString::number(totalClients),
+                                 .arg(QString::number(result.rows),
                                       fileName));
 }
 
 void MainWindow::showClientAnalytics()
 {
-    QList<QTableWidgetItem*> selected = clientsTable->selectedItems();
-    if (selected.isEmpty()) {
+    const int row = firstSelectedRow(clientsTable);
+    if (row < 0) {
         QMessageBox::warning(this, "Attention", "Veuillez sélectionner un client");
         return;
     }
 
-    int row = selected.first()->row();
-    int clientId = clientsTable->item(row, 0)->text().toInt();
-    QString clientName = clientsTable->item(row, 1)->text() + " " + clientsTable->item(row, 2)->text();
+    const ClientRow &selected = clientModel->rowAt(row);
+    int clientId = selected.idClient;
+    QString clientName = selected.nom + " " + selected.prenom;
 
-    int commandCount = dbManager->getClientCommandCount(clientId);
-    double totalRevenue = dbManager->getTotalRevenueFromClient(clientId);
-    double averageOrder = commandCount > 0 ? totalRevenue / commandCount : 0;
+    const ClientMetrics *metrics = clientAnalytics->metrics(clientId);
+    if (!metrics) {
+        QMessageBox::critical(this, "Erreur", "Impossible de charger les statistiques du client");
+        return;
+    }
 
     QString analytics = QString("📊 Analytics Client: %1\n\n"
                                 "• Nombre de commandes: %2\n"
                                 "• Chiffre d'affaires total: %3 €\n"
                                 "• Moyenne par commande: %4 €\n"
-                                "• Client depuis: %5")
+                                "• Client depuis: %5\n"
+                                "• Dernière commande: %6\n"
+                                "• Score RFM: %7")
                             .arg(clientName,
-                                 QString::number(commandCount),
-                                 QString::number(totalRevenue, 'f', 2),
-                                 QString::number(averageOrder, 'f', 2),
-                                 "N/A"); // You could add creation date to client table
+                                 QString::number(metrics->orderCount),
+                                 QString::number(metrics->revenue, 'f', 2),
+                                 QString::number(metrics->averageBasket(), 'f', 2),
+                                 metrics->firstOrder.isValid() ? metrics->firstOrder.toString("dd/MM/yyyy") : "N/A",
+                                 metrics->lastOrder.isValid() ? metrics->lastOrder.toString("dd/MM/yyyy") : "N/A",
+                                 metrics->rfm());
 
     QMessageBox::information(this, "Analytics Client", analytics);
 }
 
 void MainWindow::showClientDetails()
 {
-    QList<QTableWidgetItem*> selected = clientsTable->selectedItems();
-    if (selected.isEmpty()) {
+    const int row = firstSelectedRow(clientsTable);
+    if (row < 0) {
         QMessageBox::warning(this, "Attention", "Veuillez sélectionner un client");
         return;
     }
 
-    int row = selected.first()->row();
-    int clientId = clientsTable->item(row, 0)->text().toInt();
+    int clientId = clientModel->rowAt(row).idClient;
 
-    QSqlRecord record;
-    if (dbManager->getClient(clientId, record)) {
+    Client client;
+    if (dbManager->getClient(clientId, client)) {
         QString details = QString("👤 Détails Client\n\n"
                                   "ID: %1\n"
                                   "Nom: %2\n"
@@ -1326,28 +2059,97 @@ void MainWindow::showClientDetails()
                                   "Email: %4\n"
                                   "Téléphone: %5\n"
                                   "Adresse: %6")
-                              .arg(record.value("id_client").toString(),
-                                   record.value("nom").toString(),
-                                   record.value("prenom").toString(),
-                                   record.value("email").toString(),
-                                   record.value("telephone").toString(),
-                                   record.value("adresse").toString());
+                              .arg(QString::number(client.idClient),
+                                   client.nom,
+                                   client.prenom,
+                                   client.email,
+                                   client.telephone,
+                                   client.adresse);
 
         QMessageBox::information(this, "Détails Client", details);
     }
 }
 
+void MainWindow::generateClientStatements()
+{
+    bool ok = false;
+    const QString monthText = QInputDialog::getText(this, "Relevés Clients", "Mois (aaaa-mm):",
+                                                    QLineEdit::Normal,
+                                                    QDate::currentDate().toString("yyyy-MM"), &ok);
+    if (!ok)
+        return;
+
+    const QDate fromDate = QDate::fromString(monthText.trimmed() + "-01", "yyyy-MM-dd");
+    if (!fromDate.isValid()) {
+        QMessageBox::warning(this, "Attention", "Mois invalide, format attendu: aaaa-mm");
+        return;
+    }
+    const QDate toDate = fromDate.addMonths(1).addDays(-1);
+
+    const QString outDir = QFileDialog::getExistingDirectory(this, "Dossier des relevés");
+    if (outDir.isEmpty())
+        return;
+
+    // One streaming query, then rendering on all cores without database access
+    QVector<ClientStatement> statements;
+    QString error;
+    if (!StatementGenerator::loadStatements(*dbManager, fromDate, toDate, statements, &error)) {
+        QMessageBox::critical(this, "Erreur", error);
+        return;
+    }
+    if (statements.isEmpty()) {
+        QMessageBox::information(this, "Relevés Clients", "Aucune commande sur cette période");
+        return;
+    }
+
+    QProgressDialog *progress = new QProgressDialog("Génération des relevés...", "Annuler", 0, statements.size(), this);
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setMinimumDuration(0);
+
+    auto *watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::progressValueChanged, progress, &QProgressDialog::setValue);
+    connect(progress, &QProgressDialog::canceled, watcher, &QFutureWatcher<bool>::cancel);
+    connect(watcher, &QFutureWatcher<bool>::finished, this, [this, watcher, progress, outDir]() {
+        progress->close();
+        progress->deleteLater();
+        watcher->deleteLater();
+
+        const QFuture<bool> future = watcher->future();
+        if (future.isCanceled()) {
+            QMessageBox::information(this, "Relevés Clients", "Génération annulée");
+            return;
+        }
+        int written = 0;
+        for (bool result : future.results())
+            written += result ? 1 : 0;
+        QMessageBox::information(this, "Relevés Clients",
+                                 QString("Relevés générés: %1 / %2\nDossier: %3")
+                                     .arg(written)
+                                     .arg(future.resultCount())
+                                     .arg(outDir));
+    });
+
+    watcher->setFuture(QtConcurrent::mapped(std::move(statements),
+                                            [fromDate, toDate, outDir](const ClientStatement &statement) {
+                                                return StatementGenerator::renderStatement(statement, fromDate, toDate, outDir);
+                                            }));
+}
+
 // Commande methods
 void MainWindow::loadCommandesTable()
 {
     // Load clients for combobox
     cmbClient->clear();
-    QSqlQuery clientQuery("SELECT id_client, nom, prenom FROM client ORDER BY nom, prenom", dbManager->getDatabase());
-    while (clientQuery.next()) {
-        QString clientInfo = QString("%1 %2 (ID: %3)").arg(clientQuery.value("prenom").toString(),
-                                                           clientQuery.value("nom").toString(),
-                                                           clientQuery.value("id_client").toString());
-        cmbClient->addItem(clientInfo, clientQuery.value("id_client"));
+    QSqlQuery clientQuery(dbManager->getReadDatabase());
+    clientQuery.setForwardOnly(true);
+    clientQuery.exec("SELECT id_client, nom, prenom FROM client ORDER BY nom, prenom");
+    RowCursor<ClientRow> cursor(std::move(clientQuery));
+    ClientRow client;
+    while (cursor.next(client)) {
+        QString clientInfo = QString("%1 %2 (ID: %3)").arg(client.prenom, client.nom, QString::number(client.idClient));
+        cmbClient->addItem(clientInfo, client.idClient);
+        cmbClient->setItemData(cmbClient->count() - 1, client.nom, NomRole);
+        cmbClient->setItemData(cmbClient->count() - 1, client.prenom, PrenomRole);
     }
 
     // Load commandes
@@ -1365,18 +2167,20 @@ void MainWindow::addNewCommande()
 
 void MainWindow::editSelectedCommande()
 {
-    QList<QTableWidgetItem*> selected = commandesTable->selectedItems();
-    if (selected.isEmpty()) {
+    const int row = firstSelectedRow(commandesTable);
+    if (row < 0) {
         QMessageBox::warning(this, "Attention", "Veuillez sélectionner une commande à modifier");
         return;
     }
 
-    int row = selected.first()->row();
-    currentCommandeId = commandesTable->item(row, 0)->text().toInt();
+    currentCommandeId = commandeModel->rowAt(row).idCommande;
+    if (currentCommandeId >= 0 && rejectArchivedRows({currentCommandeId}))
+        return;
 
-    QSqlRecord record;
-    if (dbManager->getCommande(currentCommandeId, record)) {
-        populateCommandeForm(record);
+    Commande commande;
+    if ((writeQueue && writeQueue->pendingCommande(currentCommandeId, commande))
+        || dbManager->getCommande(currentCommandeId, commande)) {
+        populateCommandeForm(commande);
         commandeFormGroup->setVisible(true);
         isEditingCommande = true;
     } else {
@@ -1386,22 +2190,26 @@ void MainWindow::editSelectedCommande()
 
 void MainWindow::deleteSelectedCommande()
 {
-    QList<QTableWidgetItem*> selected = commandesTable->selectedItems();
-    if (selected.isEmpty()) {
+    const QList<int> ids = selectedIds(commandesTable);
+    if (ids.isEmpty()) {
         QMessageBox::warning(this, "Attention", "Veuillez sélectionner une commande à supprimer");
         return;
     }
+    if (rejectPendingRows(ids) || rejectArchivedRows(ids))
+        return;
 
-    int row = selected.first()->row();
-    int commandeId = commandesTable->item(row, 0)->text().toInt();
-
-    QMessageBox::StandardButton reply = QMessageBox::question(this, "Confirmation",
-                                                              "Êtes-vous sûr de vouloir supprimer cette commande ?",
+    const QString question = ids.size() == 1
+                                 ? QString("Êtes-vous sûr de vouloir supprimer cette commande ?")
+                                 : QString("Êtes-vous sûr de vouloir supprimer les %1 commandes sélectionnées ?").arg(ids.size());
+    QMessageBox::StandardButton reply = QMessageBox::question(this, "Confirmation", question,
                                                               QMessageBox::Yes | QMessageBox::No);
 
     if (reply == QMessageBox::Yes) {
-        if (dbManager->deleteCommande(commandeId)) {
-            QMessageBox::information(this, "Succès", "Commande supprimée avec succès");
+        const bool success = ids.size() == 1 ? dbManager->deleteCommande(ids.first()) : dbManager->deleteCommandes(ids);
+        if (success) {
+            QMessageBox::information(this, "Succès",
+                                     ids.size() == 1 ? QString("Commande supprimée avec succès")
+                                                     : QString("%1 commandes supprimées avec succès").arg(ids.size()));
             loadCommandesTable();
         } else {
             QMessageBox::critical(this, "Erreur", "Erreur lors de la suppression de la commande");
@@ -1409,46 +2217,133 @@ void MainWindow::deleteSelectedCommande()
     }
 }
 
-void MainWindow::searchCommandes()
+void MainWindow::changeSelectedCommandesStatut()
 {
-    QString clientFilter = txtSearchCommande->text().trimmed();
-    QString statutFilter = cmbStatutFilter->currentData().toString();
-    QDate fromDate = dateFromFilter->date();
-    QDate toDate = dateToFilter->date();
+    const QList<int> ids = selectedIds(commandesTable);
+    if (ids.isEmpty()) {
+        QMessageBox::warning(this, "Attention", "Veuillez sélectionner une ou plusieurs commandes");
+        return;
+    }
+    if (rejectPendingRows(ids) || rejectArchivedRows(ids))
+        return;
 
-    QString clientNameLike = clientFilter.isEmpty() ? "%" : "%" + clientFilter + "%";
+    // Same values as the order form
+    QStringList statuts;
+    for (int i = 0; i < cmbStatut->count(); ++i)
+        statuts << cmbStatut->itemText(i);
 
-    QSqlQuery query = dbManager->searchCommandes(clientNameLike, statutFilter, fromDate, toDate, "date_desc");
+    bool ok = false;
+    const QString statut = QInputDialog::getItem(this, "Changer le statut",
+                                                 QString("Nouveau statut pour %1 commande(s):").arg(ids.size()),
+                                                 statuts, 0, false, &ok);
+    if (!ok)
+        return;
 
-    commandesTable->setRowCount(0);
-    int row = 0;
-    while (query.next()) {
-        commandesTable->insertRow(row);
-        commandesTable->setItem(row, 0, new QTableWidgetItem(query.value("id_commande").toString()));
-        commandesTable->setItem(row, 1, new QTableWidgetItem(
-                                            query.value("prenom").toString() + " " + query.value("nom").toString()));
-        commandesTable->setItem(row, 2, new QTableWidgetItem(
-                                            query.value("date_commande").toDateTime().toString("dd/MM/yyyy hh:mm")));
-        commandesTable->setItem(row, 3, new QTableWidgetItem(query.value("statut").toString()));
-        commandesTable->setItem(row, 4, new QTableWidgetItem(
-                                            QString::number(query.value("montant_total").toDouble(), 'f', 2) + " €"));
-        // FIXED: Add moyen_paiement and remarque to the table
-        commandesTable->setItem(row, 5, new QTableWidgetItem(query.value("moyen_paiement").toString()));
-        commandesTable->setItem(row, 6, new QTableWidgetItem(query.value("remarque").toString()));
-        row++;
+    if (dbManager->updateCommandesStatut(ids, OrderCodes::statut(statut))) {
+        searchCommandes();
+    } else {
+        QMessageBox::critical(this, "Erreur", "Erreur lors de la mise à jour des commandes");
     }
 }
 
-void MainWindow::exportCommandesPDF()
+void MainWindow::changeSelectedCommandesPaiement()
 {
-    // Get commands for current month
-    QSqlQuery query = dbManager->getCommandesThisMonth();
+    const QList<int> ids = selectedIds(commandesTable);
+    if (ids.isEmpty()) {
+        QMessageBox::warning(this, "Attention", "Veuillez sélectionner une ou plusieurs commandes");
+        return;
+    }
+    if (rejectPendingRows(ids) || rejectArchivedRows(ids))
+        return;
+
+    QStringList paiements;
+    for (int i = 0; i < cmbMoyenPaiement->count(); ++i)
+        paiements << cmbMoyenPaiement->itemText(i);
 
-    if (!query.isActive()) {
-        QMessageBox::critical(this, "Erreur", "Impossible de récupérer les commandes du mois: " + query.lastError().text());
+    bool ok = false;
+    const QString paiement = QInputDialog::getItem(this, "Changer le moyen de paiement",
+                                                   QString("Moyen de paiement pour %1 commande(s):").arg(ids.size()),
+                                                   paiements, 0, false, &ok);
+    if (!ok)
+        return;
+
+    if (dbManager->updateCommandesPaiement(ids, OrderCodes::paiement(paiement))) {
+        searchCommandes();
+    } else {
+        QMessageBox::critical(this, "Erreur", "Erreur lors de la mise à jour des commandes");
+    }
+}
+
+void MainWindow::reviewStatusRules()
+{
+    const StatusRulesConfig config = StatusRulesConfig::load();
+    if (config.rules.isEmpty()) {
+        QMessageBox::information(this, "Règles de statut",
+                                 "Aucune règle définie (section [status_rules] de QTcredit.ini)");
+        return;
+    }
+
+    // Dry run first: show what each rule would change
+    QString report = "Commandes concernées:\n\n";
+    int total = 0;
+    for (const StatusRulesEngine::Outcome &outcome : StatusRulesEngine::run(*dbManager, config, true)) {
+        report += QString("• %1: %2\n").arg(outcome.rule, outcome.ok ? QString::number(outcome.matched) : "erreur");
+        total += outcome.matched;
+    }
+    if (total == 0) {
+        QMessageBox::information(this, "Règles de statut", report + "\nAucune commande à modifier");
         return;
     }
 
+    QMessageBox::StandardButton reply = QMessageBox::question(this, "Règles de statut",
+                                                              report + "\nAppliquer maintenant ?",
+                                                              QMessageBox::Yes | QMessageBox::No);
+    if (reply != QMessageBox::Yes)
+        return;
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    int updated = 0;
+    for (const StatusRulesEngine::Outcome &outcome : StatusRulesEngine::run(*dbManager, config, false))
+        updated += outcome.updated;
+    QApplication::restoreOverrideCursor();
+
+    QMessageBox::information(this, "Règles de statut", QString("%1 commande(s) mises à jour").arg(updated));
+    searchCommandes();
+}
+
+bool MainWindow::commandeQuery(OrderQuery &query, QString &error) const
+{
+    if (!OrderQuery::parse(txtSearchCommande->text().trimmed(), query, &error))
+        return false;
+    const QString statutFilter = cmbStatutFilter->currentData().toString();
+    if (!statutFilter.isEmpty() && !query.has(OrderQuery::Statut))
+        query.add({OrderQuery::Statut, OrderQuery::Equal, {statutFilter}});
+    if (!query.has(OrderQuery::Date))
+        query.add(OrderQuery::period(dateFromFilter->date(), dateToFilter->date()));
+    return true;
+}
+
+void MainWindow::searchCommandes()
+{
+    OrderQuery query;
+    QString error;
+    if (!commandeQuery(query, error)) {
+        lblCommandesStatus->setText("❌ Expression invalide: " + error);
+        return;
+    }
+
+    // Newest first, by pages; the header sort, if any, is re-applied by the model
+    commandeRequest = SearchRequest();
+    commandeRequest.kind = SearchRequest::Commandes;
+    commandeRequest.screen = "searchCommandes";
+    commandeRequest.query = query;
+    commandeRequest.limit = searchConfig.pageSize;
+    commandeRequest.timeoutMs = searchConfig.timeoutMs;
+    commandeSearch->run(commandeRequest);
+}
+
+void MainWindow::exportCommandesPDF()
+{
     // Ask for save location
     QString fileName = QFileDialog::getSaveFileName(this, "Exporter PDF",
                                                     QString("commandes_%1_%2.pdf")
@@ -1460,99 +2355,81 @@ void MainWindow::exportCommandesPDF()
         return;
     }
 
-    // Create HTML content
-    QString html;
-    html += "<html><head><style>";
-    html += "body { font-family: Arial, sans-serif; margin: 20px; }";
-    html += "h1 { color: #2a7fff; text-align: center; }";
-    html += "h2 { color: #333; border-bottom: 2px solid #2a7fff; padding-bottom: 5px; }";
-    html += "table { width: 100%; border-collapse: collapse; margin: 20px 0; }";
-    html += "th { background-color: #2a7fff; color: white; padding: 10px; text-align: left; }";
-    html += "td { padding: 8px; border: 1px solid #ddd; }";
-    html += "tr:nth-child(even) { background-color: #f2f2f2; }";
-    html += ".summary { background-color: #e8f4ff; padding: 15px; border-radius: 5px; margin: 20px 0; }";
-    html += ".total { font-weight: bold; color: #2a7fff; }";
-    html += "</style></head><body>";
-
-    // Header
-    html += "<h1>Rapport des Commandes - " + QDate::currentDate().toString("MMMM yyyy") + "</h1>";
-    html += "<p>Généré le: " + QDateTime::currentDateTime().toString("dd/MM/yyyy à HH:mm") + "</p>";
-
-    // Summary
-    int totalCommandes = 0;
-    double totalMontant = 0.0;
-    QMap<QString, int> statutsCount;
-
-    // First pass to calculate totals
-    QSqlQuery countQuery = dbManager->getCommandesThisMonth();
-    while (countQuery.next()) {
-        totalCommandes++;
-        totalMontant += countQuery.value("montant_total").toDouble();
-        QString statut = countQuery.value("statut").toString();
-        statutsCount[statut]++;
-    }
-
-    html += "<div class='summary'>";
-    html += "<h2>Résumé</h2>";
-    html += "<p>Total des commandes: <span class='total'>" + QString::number(totalCommandes) + "</span></p>";
-    html += "<p>Chiffre d'affaires total: <span class='total'>" + QString::number(totalMontant, 'f', 2) + " €</span></p>";
-    html += "<p>Répartition par statut:</p><ul>";
-    for (auto it = statutsCount.begin(); it != statutsCount.end(); ++it) {
-        html += "<li>" + it.key() + ": " + QString::number(it.value()) + "</li>";
-    }
-    html += "</ul></div>";
-
-    // Table header
-    html += "<h2>Détail des Commandes</h2>";
-    html += "<table>";
-    html += "<tr>";
-    html += "<th>ID</th>";
-    html += "<th>Client</th>";
-    html += "<th>Date</th>";
-    html += "<th>Statut</th>";
-    html += "<th>Montant</th>";
-    html += "<th>Paiement</th>";
-    html += "<th>Remarque</th>";
-    html += "</tr>";
-
-    // Table rows
-    while (query.next()) {
-        html += "<tr>";
-        html += "<td>" + query.value("id_commande").toString() + "</td>";
-        html += "<td>" + query.value("prenom").toString() + " " + query.value("nom").toString() + "</td>";
-        html += "<td>" + query.value("date_commande").toDateTime().toString("dd/MM/yyyy HH:mm") + "</td>";
-        html += "<td>" + query.value("statut").toString() + "</td>";
-        html += "<td>" + QString::number(query.value("montant_total").toDouble(), 'f', 2) + " €</td>";
-        html += "<td>" + query.value("moyen_paiement").toString() + "</td>";
-        html += "<td>" + query.value("remarque").toString() + "</td>";
-        html += "</tr>";
-    }
-
-    html += "</table>";
-    html += "</body></html>";
-
-    // Generate PDF
-    generatePDF(fileName, html);
+    // Commands of the current month
+    ReportGenerator::Result result = ReportGenerator::exportCommandesMonthPDF(*dbManager, QDate::currentDate(), fileName);
+    if (!result.ok) {
+        QMessageBox::critical(this, "Erreur", result.error);
+        return;
+    }
 
     QMessageBox::information(this, "Succès",
                              QString("PDF généré avec succès!\n"
                                      "Commandes exportées: %1\n"
                                      "Fichier: %2")
-                                 .arg(QString::number(totalCommandes),
+                                 .arg(QString::number(result.rows),
                                       fileName));
 }
 
-void MainWindow::generatePDF(const QString &fileName, const QString &htmlContent)
+QString MainWindow::askCsvFileName(const QString &title, const QString &defaultName)
 {
-    QPrinter printer(QPrinter::HighResolution);
-    printer.setOutputFormat(QPrinter::PdfFormat);
-    printer.setOutputFileName(fileName);
-    printer.setPageSize(QPageSize(QPageSize::A4));
-    printer.setPageOrientation(QPageLayout::Portrait);
-
-    QTextDocument document;
-    document.setHtml(htmlContent);
-    document.print(&printer);
+    QString filters = "Fichiers CSV (*.csv);;Fichiers TSV (*.tsv)";
+    if (CsvExporter::gzipAvailable())
+        filters += ";;CSV compressé (*.csv.gz);;TSV compressé (*.tsv.gz)";
+    return QFileDialog::getSaveFileName(this, title, defaultName, filters);
+}
+
+void MainWindow::exportClientsCSV()
+{
+    QString fileName = askCsvFileName("Exporter CSV Clients", "liste_clients.csv");
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    CsvExporter::Result result = CsvExporter::exportClients(*dbManager, fileName, CsvExporter::optionsForFile(fileName));
+    QApplication::restoreOverrideCursor();
+
+    if (!result.ok) {
+        QMessageBox::critical(this, "Erreur", result.error);
+        return;
+    }
+    QMessageBox::information(this, "Succès",
+                             QString("Export terminé!\nClients exportés: %1\nFichier: %2")
+                                 .arg(QString::number(result.rows), fileName));
+}
+
+void MainWindow::exportCommandesCSV()
+{
+    // Same filters as the search panel, over any date range
+    CommandeFilter filter;
+    QString error;
+    if (!commandeQuery(filter.query, error)) {
+        QMessageBox::warning(this, "Attention", "Expression de recherche invalide: " + error);
+        return;
+    }
+    QDate fromDate;
+    QDate toDate;
+    filter.query.narrowDates(fromDate, toDate);
+
+    QString fileName = askCsvFileName("Exporter CSV Commandes",
+                                      QString("commandes_%1_%2.csv")
+                                          .arg(fromDate.toString("yyyyMMdd"), toDate.toString("yyyyMMdd")));
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    CsvExporter::Result result = CsvExporter::exportCommandes(*dbManager, filter, fileName,
+                                                              CsvExporter::optionsForFile(fileName));
+    QApplication::restoreOverrideCursor();
+
+    if (!result.ok) {
+        QMessageBox::critical(this, "Erreur", result.error);
+        return;
+    }
+    QMessageBox::information(this, "Succès",
+                             QString("Export terminé!\nCommandes exportées: %1\nFichier: %2")
+                                 .arg(QString::number(result.rows), fileName));
 }
 
 void MainWindow::showStatistics()
@@ -1568,7 +2445,7 @@ void MainWindow::saveCommande()
     }
 
     int clientId = cmbClient->currentData().toInt();
-    QString statut = cmbStatut->currentText();
+    QString statut = cmbStatut->currentData().toString();
     bool ok;
     double montant = txtMontant->text().toDouble(&ok);
 
@@ -1577,19 +2454,45 @@ void MainWindow::saveCommande()
         return;
     }
 
-    bool success = false;
-    qint64 newId;
-
-    QDateTime dateTimeCommande = QDateTime(dateCommande->date(), QTime::currentTime());
+    Commande commande;
+    commande.idClient = clientId;
+    commande.dateCommande = QDateTime(dateCommande->date(), QTime::currentTime());
+    commande.statut = statut;
+    commande.montantTotal = montant;
+    commande.moyenPaiement = cmbMoyenPaiement->currentData().toString();
+    commande.remarque = txtRemarque->toPlainText().trimmed();
+
+    if (writeQueue) {
+        if (isEditingCommande)
+            commande.idCommande = currentCommandeId;
+        CommandeRow row;
+        const bool known = commandeModel->rowById(int(commande.idCommande), row);
+        const qint64 id = writeQueue->saveCommande(commande);
+        if (!commandeRollback.contains(id))
+            commandeRollback.insert(id, known ? row : CommandeRow());
+        if (!known) {
+            // The client of an existing order is not updatable
+            row.idClient = clientId;
+            row.nom = cmbClient->currentData(NomRole).toString();
+            row.prenom = cmbClient->currentData(PrenomRole).toString();
+        }
+        row.idCommande = int(id);
+        row.dateCommande = commande.dateCommande;
+        row.statut = commande.statut;
+        row.montantTotal = commande.montantTotal;
+        row.moyenPaiement = commande.moyenPaiement;
+        row.remarque = commande.remarque;
+        commandeModel->mergeRows({row}, {});
+        commandeFormGroup->setVisible(false);
+        return;
+    }
 
+    bool success = false;
     if (isEditingCommande) {
-        success = dbManager->updateCommande(currentCommandeId, statut, montant,
-                                            cmbMoyenPaiement->currentText(),
-                                            txtRemarque->toPlainText().trimmed());
+        commande.idCommande = currentCommandeId;
+        success = dbManager->updateCommande(commande);
     } else {
-        success = dbManager->addCommande(clientId, dateTimeCommande, statut, montant,
-                                         cmbMoyenPaiement->currentText(),
-                                         txtRemarque->toPlainText().trimmed(), newId);
+        success = dbManager->addCommande(commande);
     }
 
     if (success) {
@@ -1614,29 +2517,27 @@ void MainWindow::clearCommandeForm()
     txtRemarque->clear();
 }
 
-void MainWindow::populateCommandeForm(const QSqlRecord &record)
+void MainWindow::populateCommandeForm(const Commande &commande)
 {
-    int clientId = record.value("id_client").toInt();
+    const qint64 clientId = commande.idClient;
 
     // Find and select the client in combobox
     for (int i = 0; i < cmbClient->count(); ++i) {
-        if (cmbClient->itemData(i).toInt() == clientId) {
+        if (cmbClient->itemData(i).toLongLong() == clientId) {
             cmbClient->setCurrentIndex(i);
             break;
         }
     }
 
-    dateCommande->setDate(record.value("date_commande").toDateTime().date());
+    dateCommande->setDate(commande.dateCommande.date());
 
-    QString statut = record.value("statut").toString();
-    int statutIndex = cmbStatut->findText(statut);
+    int statutIndex = cmbStatut->findData(OrderCodes::statut(commande.statut));
     if (statutIndex >= 0) cmbStatut->setCurrentIndex(statutIndex);
 
-    txtMontant->setText(QString::number(record.value("montant_total").toDouble(), 'f', 2));
+    txtMontant->setText(QString::number(commande.montantTotal, 'f', 2));
 
-    QString paiement = record.value("moyen_paiement").toString();
-    int paiementIndex = cmbMoyenPaiement->findText(paiement);
+    int paiementIndex = cmbMoyenPaiement->findData(OrderCodes::paiement(commande.moyenPaiement));
     if (paiementIndex >= 0) cmbMoyenPaiement->setCurrentIndex(paiementIndex);
 
-    txtRemarque->setText(record.value("remarque").toString());
+    txtRemarque->setText(commande.remarque);
 }
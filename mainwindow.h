@@ -8,6 +8,7 @@
 #include <QPushButton>
 #include <QListWidget>
 #include <QTableWidget>
+#include <QTableView>
 #include <QLineEdit>
 #include <QTextEdit>
 #include <QComboBox>
@@ -23,6 +24,12 @@
 #include <QSpacerItem>
 #include <QPrinter>
 #include <QTextDocument>
+#include <QShortcut>
+#include <QTimer>
+#include <QSpinBox>
+#include <QFutureWatcher>
+#include "RowCursor.h"
+#include "SearchRunner.h"
 
 // QtCharts includes
 #include <QtCharts>
@@ -34,6 +41,19 @@
 
 // Forward declaration
 class DatabaseManager;
+class StatusRulesScheduler;
+class ArchiveScheduler;
+class ChangeFeed;
+struct ChangeSet;
+class WriteQueue;
+struct WriteBatch;
+class ClientAnalytics;
+class CohortAnalysis;
+class RowTableModel;
+class ClientTableModel;
+class CommandeTableModel;
+struct Client;
+struct Commande;
 
 class MainWindow : public QMainWindow
 {
@@ -57,8 +77,10 @@ private slots:
     void saveClient();
     void cancelClientEdit();
     void exportClientsPDF(); // New PDF export for clients
+    void exportClientsCSV();
     void showClientAnalytics(); // New client analytics
     void showClientDetails(); // New client details
+    void generateClientStatements(); // Month-end PDF statement per client
 
     // Commande slots
     void addNewCommande();
@@ -66,24 +88,60 @@ private slots:
     void loadCommandesTable();
     void editSelectedCommande();
     void deleteSelectedCommande();
+    void changeSelectedCommandesStatut();   // bulk, whole selection
+    void changeSelectedCommandesPaiement(); // bulk, whole selection
+    void reviewStatusRules(); // dry-run of the status rules, then apply on demand
     void saveCommande();
     void cancelCommandeEdit();
     void exportCommandesPDF(); // PDF export for commands
+    void exportCommandesCSV(); // CSV/TSV export with the search filters
     void showStatistics();
+    void refreshLeaderboard();
+    void refreshCohorts(); // recompute in the background, then renderCohorts()
+    void renderCohorts();
+
+    // Diagnostics (hidden, Ctrl+Shift+D)
+    void toggleDiagnostics();
+    void refreshDiagnostics();
 
 private:
     void setupUI();
     void setupClientSection();
     void setupCommandeSection();
     void setupStatisticsSection();
+    void setupDiagnosticsSection();
     void clearClientForm();
     void clearCommandeForm();
-    void populateClientForm(const QSqlRecord &record);
-    void populateCommandeForm(const QSqlRecord &record);
-    void applyModernTableStyle(QTableWidget *table);
+    void populateClientForm(const Client &client);
+    void populateCommandeForm(const Commande &commande);
+    void applyModernTableStyle(QTableView *table);
+    QList<int> selectedIds(QTableView *table) const; // column 0 of the selected rows
+    int firstSelectedRow(QTableView *table) const;   // -1 if nothing is selected
+    void selectIds(QTableView *table, const QList<int> &ids);
+    // Writes of the other instances, merged into the loaded rows
+    void applyExternalChanges(const ChangeSet &changes);
+    // Adds or renames the client in the order form's combo box
+    void setClientChoice(const ClientRow &client);
+    // Confirms or rolls back the optimistic rows of the form saves
+    void applyWriteResults(const WriteBatch &batch);
+    // Warns and returns true if a row is still in the write queue
+    bool rejectPendingRows(const QList<int> &ids);
+    // Same for archived orders, listed but read-only
+    bool rejectArchivedRows(const QList<int> &ids);
+    // Column chooser + text field filtering the loaded rows of model
+    QHBoxLayout *createQuickFilter(RowTableModel *model);
+    // Row count, "Charger plus" and "Annuler" under a list fed by runner
+    QHBoxLayout *createSearchBar(SearchRunner *runner, QPushButton *&more, QLabel *&status);
+    void runClientSearch(const QString &screen, const QString &textLike);
+    // The order filters as one query: the expression of the client field,
+    // plus the statut and period fields unless it sets them; false and
+    // error set if the expression is invalid
+    bool commandeQuery(OrderQuery &query, QString &error) const;
+    // Shows a page of clientSearch / commandeSearch
+    void applySearchResult(const SearchResult &result);
     void applyModernButtonStyle(QPushButton *button, const QString &color = "#0078D4");
+    QString askCsvFileName(const QString &title, const QString &defaultName);
     void updateStatisticsCharts();
-    void generatePDF(const QString &fileName, const QString &htmlContent); // New PDF generation method
 
     // Main widgets
     QWidget *centralWidget;
@@ -114,6 +172,8 @@ private:
     QPushButton *btnExportClientsPDF; // New PDF button for clients
     QPushButton *btnClientAnalytics; // New analytics button
     QPushButton *btnClientDetails; // New details button
+    QPushButton *btnClientStatements;
+    QPushButton *btnExportClientsCSV;
 
     // Client search
     QFrame *clientSearchFrame;
@@ -123,7 +183,10 @@ private:
 
     // Clients table
     QGroupBox *clientTableGroup;
-    QTableWidget *clientsTable;
+    QTableView *clientsTable;
+    ClientTableModel *clientModel;
+    QPushButton *btnMoreClients;
+    QLabel *lblClientsStatus;
 
     // Client form widgets
     QGroupBox *clientFormGroup;
@@ -146,8 +209,12 @@ private:
     QPushButton *btnAddCommande;
     QPushButton *btnEditCommande;
     QPushButton *btnDeleteCommande;
+    QPushButton *btnBulkStatut;
+    QPushButton *btnBulkPaiement;
+    QPushButton *btnStatusRules;
     QPushButton *btnRefreshCommandes;
     QPushButton *btnExportPDF;
+    QPushButton *btnExportCommandesCSV;
 
     // Commande search
     QGroupBox *commandeSearchGroup;
@@ -161,7 +228,10 @@ private:
 
     // Commandes table
     QGroupBox *commandeTableGroup;
-    QTableWidget *commandesTable;
+    QTableView *commandesTable;
+    CommandeTableModel *commandeModel;
+    QPushButton *btnMoreCommandes;
+    QLabel *lblCommandesStatus;
 
     // Commande form widgets
     QGroupBox *commandeFormGroup;
@@ -181,8 +251,43 @@ private:
     QChartView *chartViewOrders;
     QChartView *chartViewRevenue;
     QLabel *statsSummary;
+    QTableWidget *leaderboardTable;
+    QComboBox *cmbLeaderboardMetric;
+    QComboBox *cmbLeaderboardOrder;
+    QSpinBox *spinLeaderboardSize;
+    QTableWidget *cohortTable;
+    QComboBox *cmbCohortView;
+    QPushButton *btnCohortRefresh;
+    QLabel *lblCohortStatus;
+
+    // Diagnostics section
+    QWidget *diagnosticsWidget;
+    QTableWidget *diagTimingsTable;
+    QTableWidget *diagCacheTable;
+    QTableWidget *diagPlansTable; // plans captured while the capture is on
+    QPushButton *btnCapturePlans;
+    QLabel *diagMemoryLabel;
+    QTimer *diagRefreshTimer;
+    QWidget *sectionBeforeDiagnostics;
 
     DatabaseManager *dbManager;
+    StatusRulesScheduler *statusRules = nullptr;
+    ArchiveScheduler *orderArchive = nullptr;
+    ChangeFeed *changeFeed = nullptr;
+    WriteQueue *writeQueue = nullptr;
+    // List queries, off the GUI thread so they can be cancelled; the
+    // requests keep the filters and the key of the next page
+    SearchConfig searchConfig;
+    SearchRunner *clientSearch = nullptr;
+    SearchRunner *commandeSearch = nullptr;
+    SearchRequest clientRequest;
+    SearchRequest commandeRequest;
+    // Rows as they were before a queued save, by the id shown (id 0 = new row)
+    QHash<qint64, ClientRow> clientRollback;
+    QHash<qint64, CommandeRow> commandeRollback;
+    ClientAnalytics *clientAnalytics = nullptr;
+    CohortAnalysis *cohortAnalysis = nullptr;
+    QFutureWatcher<bool> *cohortWatcher = nullptr;
     int currentClientId;
     int currentCommandeId;
     bool isEditingClient;